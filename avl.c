@@ -119,6 +119,20 @@ void *avl_first_item(struct avl_tree *tree)
 #endif
 }
 
+void *avl_last_item(struct avl_tree *tree)
+{
+#ifdef AVL_5XLINKED
+	return tree->last ? tree->last->item : NULL;
+#else
+	struct avl_node * an = tree->root;
+
+	while (an && an->down[1])
+		an = an->down[1];
+
+	return an ? an->item : NULL;
+#endif
+}
+
 /*
 struct avl_node *avl_iterate(struct avl_tree *tree, struct avl_node *an )
 {
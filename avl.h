@@ -100,6 +100,7 @@ void *avl_find_item(struct avl_tree *tree, void *key);
 void *avl_next_item(struct avl_tree *tree, void *key);
 void *avl_closest_item(struct avl_tree *tree, void *key);
 void *avl_first_item(struct avl_tree *tree);
+void *avl_last_item(struct avl_tree *tree);
 void *avl_iterate_item(struct avl_tree *tree, struct avl_node **it);
 void *_avl_find_item_by_field(struct avl_tree *tree, void *value, unsigned long offset, uint32_t size);
 #define          avl_find_item_by_field(tree,val,s,field) _avl_find_item_by_field( tree, val, (unsigned long)((&(((struct s*)0)->field))), sizeof(((struct s*)0)->field) )
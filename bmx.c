@@ -171,6 +171,8 @@ static void segmentation_fault(int32_t sig)
 		dbg(DBGL_SYS, DBGT_ERR, "Terminating with error code %d (%s-%s-rev%.7x)! Please notify a developer",
 			sig, BMX_BRANCH, BRANCH_VERSION, bmx_git_rev_u32);
 
+		dbg_ring_dump(NULL);
+
 		if (initializing) {
 			dbg_sys(DBGT_ERR,
 				"check up-to-dateness of bmx libs in default lib path %s or customized lib path defined by %s !",
@@ -725,6 +727,7 @@ struct bmx_status {
 	AGGREG_SQN_T aggSize;
 	AGGREG_SQN_T aggMax;
 	AGGREG_SQN_T aggSend;
+	char aggStats[4 * 11];
 	char *uptime;
 	char cpu[32];
 	char mem[32];
@@ -735,6 +738,10 @@ struct bmx_status {
 	uint32_t rts;
 	char nodes[24];
 	char descRefs[2 * 16];
+	char rtEvals[4 * 11];
+	char iids[5 * 11];
+	char ifEvents[3 * 11];
+	char ruleEvents[5 * 11];
 };
 
 static const struct field_format bmx_status_format[] = {
@@ -757,6 +764,7 @@ static const struct field_format bmx_status_format[] = {
         FIELD_FORMAT_INIT(FIELD_TYPE_UINT,              bmx_status, aggSize,       1, FIELD_RELEVANCE_MEDI),
         FIELD_FORMAT_INIT(FIELD_TYPE_UINT,              bmx_status, aggMax,        1, FIELD_RELEVANCE_MEDI),
         FIELD_FORMAT_INIT(FIELD_TYPE_UINT,              bmx_status, aggSend,       1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       bmx_status, aggStats,      1, FIELD_RELEVANCE_LOW),
 
         FIELD_FORMAT_INIT(FIELD_TYPE_POINTER_CHAR,      bmx_status, uptime,        1, FIELD_RELEVANCE_HIGH),
         FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       bmx_status, cpu,           1, FIELD_RELEVANCE_HIGH),
@@ -768,6 +776,10 @@ static const struct field_format bmx_status_format[] = {
         FIELD_FORMAT_INIT(FIELD_TYPE_UINT,              bmx_status, rts,           1, FIELD_RELEVANCE_HIGH),
         FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       bmx_status, nodes,         1, FIELD_RELEVANCE_HIGH),
         FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       bmx_status, descRefs,      1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       bmx_status, rtEvals,       1, FIELD_RELEVANCE_LOW),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       bmx_status, iids,          1, FIELD_RELEVANCE_LOW),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       bmx_status, ifEvents,      1, FIELD_RELEVANCE_LOW),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       bmx_status, ruleEvents,    1, FIELD_RELEVANCE_LOW),
 	FIELD_FORMAT_END
 };
 
@@ -798,6 +810,8 @@ static int32_t bmx_status_creator(struct status_handl *handl, void *data)
 	status->aggSize = ogm_aggreg_sqn_max_window_size;
 	status->aggMax = ogm_aggreg_sqn_max;
 	status->aggSend = ogm_aggreg_sqn_send;
+	snprintf(status->aggStats, sizeof(status->aggStats), "%u/%u/%u/%u",
+		ogm_aggreg_stats.aggregs, ogm_aggreg_stats.packets, ogm_backlog_items(), ogm_aggreg_stats.dropped);
 	status->uptime = get_human_uptime(0);
 	snprintf(status->cpu, sizeof(status->cpu), "%d.%1d", s_curr_avg_cpu_load / 10, s_curr_avg_cpu_load % 10);
 	snprintf(status->mem, sizeof(status->mem), "%juK", getProcMemory() / 1024);
@@ -808,6 +822,20 @@ static int32_t bmx_status_creator(struct status_handl *handl, void *data)
 	status->rts = totalOrigRoutes;
 	snprintf(status->nodes, sizeof(status->nodes), "%d/%d", orig_tree.items, key_tree.items);
 	snprintf(status->descRefs, sizeof(status->descRefs), "%d/%d", (content_tree.items - content_tree_unresolveds), content_tree.items);
+	struct route_eval_stats *res = get_route_eval_stats();
+	snprintf(status->rtEvals, sizeof(status->rtEvals), "%u/%u/%u/%u", res->evals, res->cached, res->algos, res->ranked);
+	struct neigh_node *nn;
+	struct avl_node *an = NULL;
+	uint32_t nbUsed = 0, nbSize = 0;
+	while ((nn = avl_iterate_item(&local_tree, &an))) {
+		nbUsed += nn->neighIID4x_repos.tot_used;
+		nbSize += nn->neighIID4x_repos.arr_size;
+	}
+	snprintf(status->iids, sizeof(status->iids), "%u/%u/%u/%u/%u",
+		my_iid_repos.tot_used, my_iid_repos.arr_size, nbUsed, nbSize, iid_repos_shrinks);
+	snprintf(status->ifEvents, sizeof(status->ifEvents), "%u/%u/%u", if_event_stats.events, if_event_stats.ignored, if_event_stats.dumps);
+	snprintf(status->ruleEvents, sizeof(status->ruleEvents), "%u/%u/%u/%u/%u", rule_event_stats.events,
+		rule_event_stats.checks, rule_event_stats.fixes, rule_event_stats.lastUs, rule_event_stats.maxUs);
 	return sizeof(struct bmx_status);
 }
 
@@ -1267,7 +1295,7 @@ static int32_t ref_status_creator(struct status_handl *handl, void *data)
 		allRefs += nn->neighIID4x_repos.tot_used;
 		IID_T iid;
 
-		for (iid = 0; (iid < nn->neighIID4x_repos.max_free && (ref = iid_get_node_by_neighIID4x(&nn->neighIID4x_repos, iid, NO))); iid++) {
+		for (iid = 0; ((iid = iid_next_used(&nn->neighIID4x_repos, iid + 1)) && (ref = iid_get_node_by_neighIID4x(&nn->neighIID4x_repos, iid, NO)));) {
 
 			if (ref->kn)
 				droppedDRefs++;
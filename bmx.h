@@ -200,6 +200,8 @@ typedef uint16_t AGGREG_SQN_T;
 #define AGGREG_SQN_CACHE_MASK  0xFF
 #define AGGREG_SQN_CACHE_RANGE (AGGREG_SQN_CACHE_MASK+1)
 
+#define WBITS_WORD_SIZE 64 // bits per word of sqn-window bit arrays, see wbits_*() in tools.c
+
 typedef uint16_t INT_NEIGH_ID_T;
 #define INT_NEIGH_ID_BIT_SIZE (12)
 
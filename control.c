@@ -18,6 +18,7 @@
 
 #define _GNU_SOURCE
 #include <stdio.h>
+#include <ctype.h>
 #include <stdarg.h>
 #include <syslog.h>
 #include <stdlib.h>
@@ -76,8 +77,17 @@ LIST_SIMPEL(ctrl_list, struct ctrl_node, list, list);
 struct bmx_list_head dbgl_clients[DBGL_MAX + 1];
 static struct dbg_histogram dbgl_history[2][DBG_HIST_SIZE];
 
+static int32_t dbg_ring_entries = DEF_DBG_RING;
+static int32_t dbg_ring_next = 0;
+static struct dbg_ring_entry *dbg_ring = NULL;
+
 static uint8_t debug_system_active = NO;
 
+static int32_t ctrl_high_water = DEF_CTRL_HIGH_WATER;
+
+uint8_t ctrl_events_subscribed = 0;
+static const char *ctrl_event_names[] = { "routes", "descriptions", "links", "devices" };
+
 
 
 static char *init_string = NULL;
@@ -93,6 +103,10 @@ struct opt_type Patch_opt;
 
 LIST_SIMPEL(opt_list, struct opt_data, list, list); // global opt_list
 
+// name and short-name hash index of opt_list and all childs_type_lists, keyed by (parent_opt, name)
+static struct opt_type *opt_name_index[OPT_INDEX_SIZE];
+static struct opt_type *opt_short_index[OPT_INDEX_SIZE];
+
 
 int32_t Client_mode = NO; //this one must be initialized manually!
 
@@ -145,6 +159,213 @@ void add_dbgl_node(struct ctrl_node *cn, int dbgl)
 
 }
 
+STATIC_FUNC
+void ctrl_event_update_subscribed(void)
+{
+	struct list_node *list_pos;
+
+	ctrl_events_subscribed = 0;
+
+	list_for_each(list_pos, &ctrl_list)
+	{
+		ctrl_events_subscribed |= list_entry(list_pos, struct ctrl_node, list)->events;
+	}
+}
+
+STATIC_FUNC
+void ctrl_event_unsubscribe(struct ctrl_node *cn)
+{
+	if (cn->events) {
+		cn->events = 0;
+		ctrl_event_update_subscribed();
+	}
+}
+
+STATIC_FUNC
+void ctrl_out_free(struct ctrl_node *cn)
+{
+	if (cn->outBuff)
+		debugFree(cn->outBuff, -300901);
+
+	cn->outBuff = NULL;
+	cn->outHead = 0;
+	cn->outLen = 0;
+	cn->outSize = 0;
+}
+
+STATIC_FUNC
+IDM_T ctrl_out_reserve(struct ctrl_node *cn, uint32_t len)
+{
+	uint32_t size = cn->outSize ? cn->outSize : CTRL_OUT_BUFF_MIN;
+	char *buff;
+
+	if (cn->outLen + len <= cn->outSize)
+		return SUCCESS;
+
+	if (cn->outLen + len > CTRL_OUT_BUFF_MAX)
+		return FAILURE;
+
+	while (size < cn->outLen + len)
+		size *= 2;
+
+	size = XMIN(size, CTRL_OUT_BUFF_MAX);
+	buff = debugMalloc(size, -300903);
+
+	if (cn->outLen) {
+		uint32_t first = XMIN(cn->outLen, cn->outSize - cn->outHead);
+		memcpy(buff, cn->outBuff + cn->outHead, first);
+		memcpy(buff + first, cn->outBuff, cn->outLen - first);
+	}
+
+	if (cn->outBuff)
+		debugFree(cn->outBuff, -300901);
+
+	cn->outBuff = buff;
+	cn->outSize = size;
+	cn->outHead = 0;
+
+	return SUCCESS;
+}
+
+STATIC_FUNC
+void ctrl_out_put(struct ctrl_node *cn, const char *data, uint32_t len)
+{
+	uint32_t tail = (cn->outHead + cn->outLen) % cn->outSize;
+	uint32_t first = XMIN(len, cn->outSize - tail);
+
+	assertion(-502818, (cn->outLen + len <= cn->outSize));
+
+	memcpy(cn->outBuff + tail, data, first);
+	memcpy(cn->outBuff, data + first, len - first);
+	cn->outLen += len;
+	cn->outPeak = XMAX(cn->outPeak, cn->outLen);
+}
+
+// returns FAILURE if the client is gone, otherwise SUCCESS (with or without output still pending)
+STATIC_FUNC
+IDM_T ctrl_out_flush(struct ctrl_node *cn)
+{
+	ssize_t w;
+
+	while (cn->outLen) {
+
+		uint32_t chunk = XMIN(cn->outLen, cn->outSize - cn->outHead);
+
+		if ((w = write(cn->fd, cn->outBuff + cn->outHead, chunk)) < 0) {
+
+			if (errno == EINTR)
+				continue;
+
+			return (errno == EAGAIN || errno == EWOULDBLOCK) ? SUCCESS : FAILURE;
+		}
+
+		cn->outHead = (cn->outHead + w) % cn->outSize;
+		cn->outLen -= w;
+
+		if ((uint32_t) w < chunk)
+			return SUCCESS;
+	}
+
+	cn->outHead = 0;
+	return SUCCESS;
+}
+
+/*
+ * Queue output for a buffered client and try to write it straight away if
+ * nothing else is pending. A slow client never blocks us: droppable (debug and
+ * event) output beyond ctrlHighWater is discarded and summarized by a notice in
+ * front of the next output that fits.
+ */
+STATIC_FUNC
+void ctrl_out_append(struct ctrl_node *cn, const char *data, uint32_t len, IDM_T droppable)
+{
+	char notice[96];
+	uint32_t notice_len = 0;
+	uint32_t pending = cn->outLen;
+
+	if (cn->outClose || !len)
+		return;
+
+	if (cn->outDroppedPending) {
+		if (cn->events)
+			notice_len = snprintf(notice, sizeof(notice), "%u dropped %u\n", bmx_time, cn->outDroppedPending);
+		else
+			notice_len = snprintf(notice, sizeof(notice), "[%d %8u] %sdropped %u bytes of debug output\n",
+				My_pid, bmx_time, "WARN  ", cn->outDroppedPending);
+	}
+
+	if ((droppable && cn->outLen + notice_len + len > (uint32_t) ctrl_high_water) ||
+		ctrl_out_reserve(cn, notice_len + len) == FAILURE) {
+
+		cn->outDroppedPending += len;
+		cn->outDropped += len;
+		return;
+	}
+
+	ctrl_out_put(cn, notice, notice_len);
+	ctrl_out_put(cn, data, len);
+	cn->outDroppedPending = 0;
+
+	// A failing client is closed by handle_ctrl_node_output() when select() reports its fd writable
+	if (!pending)
+		ctrl_out_flush(cn);
+}
+
+void handle_ctrl_node_output(struct ctrl_node *cn)
+{
+	if (ctrl_out_flush(cn) == FAILURE) {
+
+		dbgf_track(DBGT_WARN, "closing fd=%d with %d pending bytes: %s", cn->fd, cn->outLen, strerror(errno));
+		close_ctrl_node(CTRL_CLOSE_STRAIGHT, cn);
+
+	} else if (!cn->outLen && cn->outClose) {
+
+		close(cn->fd);
+		cn->fd = 0;
+		change_selects();
+	}
+}
+
+// queue (or write) a complete response which must not be dropped, returns FAILURE if it does not fit
+int8_t ctrl_out_write(struct ctrl_node *cn, const char *data, uint32_t len)
+{
+	if (!cn || cn->fd <= 0)
+		return FAILURE;
+
+	if (!cn->buffered)
+		return (write(cn->fd, data, len) == (ssize_t) len) ? SUCCESS : FAILURE;
+
+	if (cn->outClose || ctrl_out_reserve(cn, len) == FAILURE)
+		return FAILURE;
+
+	ctrl_out_append(cn, data, len, NO);
+	return SUCCESS;
+}
+
+void _ctrl_event(uint8_t class, char *last, ...)
+{
+	static char rec[MAX_DBG_STR_SIZE + 2];
+	struct list_node *list_pos;
+	va_list ap;
+	int len = snprintf(rec, MAX_DBG_STR_SIZE, "%u ", bmx_time);
+
+	va_start(ap, last);
+	len += vsnprintf(rec + len, MAX_DBG_STR_SIZE - len, last, ap);
+	va_end(ap);
+
+	len = XMIN(len, MAX_DBG_STR_SIZE - 1);
+	rec[len++] = '\n';
+	rec[len] = 0;
+
+	list_for_each(list_pos, &ctrl_list)
+	{
+		struct ctrl_node *cn = list_entry(list_pos, struct ctrl_node, list);
+
+		if ((cn->events & class) && cn->fd > 0)
+			ctrl_out_append(cn, rec, len, YES);
+	}
+}
+
 static int daemonize(void)
 {
 
@@ -283,18 +504,24 @@ void close_ctrl_node(uint8_t cmd, struct ctrl_node *cn)
 
 				cn_tmp->closing_stamp = XMAX(bmx_time, 1);
 				remove_dbgl_node(cn_tmp);
+				ctrl_event_unsubscribe(cn_tmp);
 
 				//leaving this after remove_dbgl_node() prevents debugging via broken -d4 pipe
 				dbgf_all(DBGT_INFO, "closed ctrl node fd %d with cmd %d", cn_tmp->fd, cmd);
 
 
-				if (cmd == CTRL_CLOSE_SUCCESS) {
+				if (cmd == CTRL_CLOSE_SUCCESS && cn_tmp->buffered) {
+					ctrl_out_append(cn_tmp, CONNECTION_END_STR, strlen(CONNECTION_END_STR), NO);
+				} else if (cmd == CTRL_CLOSE_SUCCESS) {
 					if (write(cn_tmp->fd, CONNECTION_END_STR, strlen(CONNECTION_END_STR)) < 0) {
 						dbgf_track(DBGT_WARN, "%s", strerror(errno));
 					}
 				}
 
-				if (cmd != CTRL_CLOSE_DELAY) {
+				if (cmd != CTRL_CLOSE_DELAY && cn_tmp->outLen) {
+					// let the event loop drain pending output first (at most CTRL_CLOSING_TIMEOUT)
+					cn_tmp->outClose = YES;
+				} else if (cmd != CTRL_CLOSE_DELAY) {
 					close(cn_tmp->fd);
 					cn_tmp->fd = 0;
 					change_selects();
@@ -307,7 +534,7 @@ void close_ctrl_node(uint8_t cmd, struct ctrl_node *cn)
 		} else if ((cmd == CTRL_CLOSE_STRAIGHT && cn_tmp == cn) ||
 			(cmd == CTRL_PURGE_ALL) ||
 			(cmd == CTRL_CLEANUP && cn_tmp->closing_stamp && /* cn_tmp->fd <= 0  && */
-			U32_GT(bmx_time, cn_tmp->closing_stamp + CTRL_CLOSING_TIMEOUT))) {
+			U32_GT(bmx_time, cn_tmp->closing_stamp + (cn_tmp->closing_timeout ? cn_tmp->closing_timeout : CTRL_CLOSING_TIMEOUT)))) {
 
 			if (cn_tmp->fd > 0 && cn_tmp->fd != STDOUT_FILENO) {
 				remove_dbgl_node(cn_tmp);
@@ -319,6 +546,8 @@ void close_ctrl_node(uint8_t cmd, struct ctrl_node *cn)
 				change_selects();
 			}
 
+			ctrl_event_unsubscribe(cn_tmp);
+			ctrl_out_free(cn_tmp);
 			list_del_next(&ctrl_list, list_prev);
 			debugFree(cn_tmp, -300050);
 
@@ -345,11 +574,11 @@ void accept_ctrl_node(void)
 		return;
 	}
 
-	// make unix socket non blocking:
-	// int32_t unix_opts = fcntl(fd, F_GETFL, 0);
-	// fcntl( fd, F_SETFL, unix_opts | O_NONBLOCK );
+	// make unix socket non blocking, output is queued and drained by the event loop:
+	int32_t unix_opts = fcntl(fd, F_GETFL, 0);
+	fcntl(fd, F_SETFL, unix_opts | O_NONBLOCK);
 
-	create_ctrl_node(fd, NULL, YES);
+	create_ctrl_node(fd, NULL, YES)->buffered = YES;
 
 	change_selects();
 
@@ -369,9 +598,16 @@ void handle_ctrl_node(struct ctrl_node *cn)
 	errno = 0;
 	int input = read(cn->fd, buff, MAX_UNIX_MSG_SIZE);
 
-	buff[input] = '\0';
+	if (input < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		return;
+
+	buff[XMAX(input, 0)] = '\0';
 
-	if (input > 0 && input < MAX_UNIX_MSG_SIZE) {
+	if (input > 0 && cn->outClose) {
+
+		dbgf_all(DBGT_INFO, "ignoring %d bytes from closing fd %d", input, cn->fd);
+
+	} else if (input > 0 && input < MAX_UNIX_MSG_SIZE) {
 
 		dbgf_all(DBGT_INFO, "rcvd ctrl stream via fd %d, %d bytes, auth %d: %s",
 			cn->fd, input, cn->authorized, buff);
@@ -407,92 +643,363 @@ void handle_ctrl_node(struct ctrl_node *cn)
 
 #ifndef TEST_DEBUG
 
+static char *dbgt2str[] = { "", "INFO  ", "WARN  ", "ERROR " };
+
+// this static array of char is used by all following dbg functions.
+static char dbg_string_out[ MAX_DBG_STR_SIZE + 1 ];
+
 // returns DBG_HIST_NEW, DBG_HIST_MUTING, or  DBG_HIST_MUTED
 
 STATIC_FUNC
-uint8_t check_dbg_history(int8_t dbgl, char *s, uint16_t check_len)
+uint32_t dbg_hist_hash(const char *s, uint32_t len)
 {
+	uint32_t hash = 2166136261U;
 
-	static int r = 0;
-	int i, unused_i, h;
+	while (len--)
+		hash = (hash ^ (uint8_t) *s++) * 16777619;
+
+	return hash;
+}
+
+STATIC_FUNC
+uint8_t check_dbg_history(int8_t dbgl, char *s, uint16_t check_len)
+{
+	struct dbg_histogram *set, *dh = NULL;
+	IDM_T dh_alive = YES;
+	uint32_t hash;
+	int i;
 
 	check_len = XMIN(check_len, DBG_HIST_TEXT_SIZE);
 
 	if (!strlen(s) || !dbg_mute_to || !check_len)
 		return DBG_HIST_NEW;
 
+	hash = dbg_hist_hash(s, XMIN(check_len, strlen(s)));
+
 	if (dbgl == DBGL_SYS)
-		h = 0;
+		set = dbgl_history[0];
 
 	else if (dbgl == DBGL_CHANGES)
-		h = 1;
+		set = dbgl_history[1];
 
 	else
 		return DBG_HIST_NEW;
 
+	set += ((hash % (DBG_HIST_SIZE / DBG_HIST_WAYS)) * DBG_HIST_WAYS);
 
-	unused_i = -1;
-	i = r = (r + 1) % DBG_HIST_SIZE;
+	for (i = 0; i < DBG_HIST_WAYS; i++) {
 
-	do {
+		IDM_T alive = set[i].catched && set[i].expire == dbg_mute_to &&
+			U32_LT(bmx_time, set[i].print_stamp + dbg_mute_to) && U32_GE(bmx_time, set[i].print_stamp);
 
-		if (dbgl_history[h][i].check_len == check_len &&
-			dbgl_history[h][i].expire == dbg_mute_to &&
-			!memcmp(s, dbgl_history[h][i].text, XMIN(check_len, strlen(s)))) {
+		if (alive && set[i].hash == hash && set[i].check_len == check_len) {
 
-			if (U32_LT(bmx_time, dbgl_history[h][i].print_stamp + dbg_mute_to) &&
-				U32_GE(bmx_time, dbgl_history[h][i].print_stamp)) {
+			set[i].catched++;
 
-				dbgl_history[h][i].catched++;
+			return (set[i].catched == 2) ? DBG_HIST_MUTING : DBG_HIST_MUTED;
+		}
 
-				if (dbgl_history[h][i].catched == 2)
-					return DBG_HIST_MUTING;
+		// reuse an expired entry, otherwise the one printed longest ago
+		if (!dh || (dh_alive && (!alive || U32_LT(set[i].print_stamp, dh->print_stamp)))) {
+			dh = &set[i];
+			dh_alive = alive;
+		}
+	}
 
-				else
-					return DBG_HIST_MUTED;
+	dh->hash = hash;
+	dh->check_len = check_len;
+	dh->expire = dbg_mute_to;
+	dh->print_stamp = bmx_time;
+	dh->catched = 1;
 
+	return DBG_HIST_NEW;
+}
+
+/*
+ * Parses the conversion spec starting at the '%' in p. Returns its length and
+ * sets the conversion char, the length modifier class, and the number of
+ * '*' width/precision arguments it consumes.
+ */
+STATIC_FUNC
+uint16_t dbg_ring_spec(const char *p, char *conv, uint8_t *lmod, uint8_t *stars)
+{
+	const char *q = p + 1;
+
+	*lmod = DBG_RING_LMOD_INT;
+	*stars = 0;
+
+	while (*q && strchr("-+ #0", *q))
+		q++;
+
+	for (; *q && (*q == '*' || *q == '.' || (*q >= '0' && *q <= '9')); q++) {
+		if (*q == '*')
+			(*stars)++;
+	}
+
+	for (; *q && strchr("hlLqjzt", *q); q++) {
+		if (*q == 'L')
+			*lmod = DBG_RING_LMOD_DOUBLE;
+		else if (*q == 'q' || *q == 'j' || (*q == 'l' && *lmod == DBG_RING_LMOD_LONG))
+			*lmod = DBG_RING_LMOD_LLONG;
+		else if (*q == 'l' || *q == 'z' || *q == 't')
+			*lmod = DBG_RING_LMOD_LONG;
+	}
+
+	*conv = *q;
+
+	return (q - p) + (*q ? 1 : 0);
+}
+
+STATIC_FUNC
+IDM_T dbg_ring_put(struct dbg_ring_entry *e, const void *data, uint32_t len)
+{
+	if (e->truncated || e->len + len > sizeof(e->data)) {
+		e->truncated = YES;
+		return FAILURE;
+	}
+
+	memcpy(e->data + e->len, data, len);
+	e->len += len;
+	return SUCCESS;
+}
+
+/*
+ * Stores the raw arguments of a debug call without formatting them. Strings are
+ * copied since they rarely outlive the call.
+ */
+STATIC_FUNC
+void dbg_ring_capture(struct dbg_ring_entry *e, int8_t dbgl, int8_t dbgt, const char *f, char *fmt, va_list ap)
+{
+	const char *p;
+
+	e->fmt = fmt;
+	e->func = f;
+	e->time = bmx_time;
+	e->dbgl = dbgl;
+	e->dbgt = dbgt;
+	e->args = 0;
+	e->len = 0;
+	e->truncated = NO;
+
+	for (p = fmt; *p; p++) {
+
+		char conv;
+		uint8_t lmod, stars;
+		union dbg_ring_arg v;
+
+		if (*p != '%')
+			continue;
+
+		if (p[1] == '%') {
+			p++;
+			continue;
+		}
+
+		p += dbg_ring_spec(p, &conv, &lmod, &stars) - 1;
+
+		for (; stars; stars--) {
+			v.i = va_arg(ap, int);
+			if (dbg_ring_put(e, &v, sizeof(v)) == SUCCESS)
+				e->args++;
+		}
+
+		if (conv == 's') {
+
+			const char *str = va_arg(ap, const char *);
+			uint8_t len = XMIN(strlen(str ? str : "(null)"), DBG_RING_STR_MAX);
+
+			if (dbg_ring_put(e, &len, sizeof(len)) == SUCCESS && dbg_ring_put(e, str ? str : "(null)", len) == SUCCESS)
+				e->args++;
+
+			continue;
+
+		} else if (conv == 'd' || conv == 'i') {
+			v.i = lmod == DBG_RING_LMOD_LLONG ? va_arg(ap, long long) : (lmod == DBG_RING_LMOD_LONG ? va_arg(ap, long) : va_arg(ap, int));
+		} else if (conv == 'u' || conv == 'o' || conv == 'x' || conv == 'X' || conv == 'c') {
+			v.u = lmod == DBG_RING_LMOD_LLONG ? va_arg(ap, unsigned long long) : (lmod == DBG_RING_LMOD_LONG ? va_arg(ap, unsigned long) : va_arg(ap, unsigned int));
+		} else if (conv && strchr("eEfFgGaA", conv)) {
+			v.d = lmod == DBG_RING_LMOD_DOUBLE ? (double) va_arg(ap, long double) : va_arg(ap, double);
+		} else if (conv == 'p' || conv == 'n') {
+			v.u = (unsigned long) va_arg(ap, void *);
+		} else {
+			e->truncated = YES;
+			break;
+		}
+
+		if (dbg_ring_put(e, &v, sizeof(v)) == SUCCESS)
+			e->args++;
+	}
+}
+
+/*
+ * Formats a captured entry the way vsnprintf() would have done it at capture time.
+ */
+STATIC_FUNC
+int dbg_ring_render(struct dbg_ring_entry *e, char *out, int size)
+{
+	const char *p;
+	uint8_t arg = 0, off = 0;
+	int pos = snprintf(out, size, "[%d %8u] %s%s%s", My_pid, e->time, dbgt2str[e->dbgt], e->func ? e->func : "", e->func ? ": " : "");
+
+	for (p = e->fmt; *p && pos < size - 1; p++) {
+
+		char conv, spec[DBG_RING_SPEC_MAX + 1];
+		uint8_t lmod, stars, slen = 0;
+		union dbg_ring_arg v;
+		uint16_t len;
+		const char *q, *end;
+
+		if (*p != '%' || p[1] == '%') {
+			out[pos++] = *p;
+			p += (*p == '%');
+			continue;
+		}
+
+		len = dbg_ring_spec(p, &conv, &lmod, &stars);
+		end = p + len;
+
+		// substitute '*' by the captured width/precision values
+		for (q = p; q < end && slen < DBG_RING_SPEC_MAX - 12; q++) {
+
+			if (*q != '*') {
+				spec[slen++] = *q;
+				continue;
 			}
 
-			dbgl_history[h][i].print_stamp = bmx_time;
-			dbgl_history[h][i].catched = 1;
-			return DBG_HIST_NEW;
+			if (arg >= e->args)
+				break;
 
+			memcpy(&v, e->data + off, sizeof(v));
+			off += sizeof(v);
+			arg++;
+			slen += sprintf(spec + slen, "%d", (int) v.i);
 		}
+		spec[slen] = 0;
 
-		if (unused_i == -1 &&
-			(dbgl_history[h][i].catched == 0 ||
-			!(U32_LT(bmx_time, dbgl_history[h][i].print_stamp + dbg_mute_to) &&
-			U32_GE(bmx_time, dbgl_history[h][i].print_stamp)))) {
+		p = end - 1;
 
-			unused_i = i;
+		if (q < end || arg >= e->args) {
+			pos += snprintf(out + pos, size - pos, "%s", e->truncated ? "..." : "");
+			break;
 		}
 
+		if (conv == 's') {
+			char str[DBG_RING_STR_MAX + 1];
+			uint8_t l = e->data[off];
 
-		i = ((i + 1) % DBG_HIST_SIZE);
+			memcpy(str, e->data + off + 1, l);
+			str[l] = 0;
+			off += 1 + l;
+			pos += snprintf(out + pos, size - pos, spec, str);
+			arg++;
+			continue;
+		}
 
-	} while (i != r);
+		memcpy(&v, e->data + off, sizeof(v));
+		off += sizeof(v);
+		arg++;
 
-	if (unused_i == -1)
-		unused_i = r;
+		if (conv == 'n')
+			continue;
+		else if (conv == 'p')
+			pos += snprintf(out + pos, size - pos, spec, (void *) (unsigned long) v.u);
+		else if (strchr("eEfFgGaA", conv))
+			pos += lmod == DBG_RING_LMOD_DOUBLE ? snprintf(out + pos, size - pos, spec, (long double) v.d) : snprintf(out + pos, size - pos, spec, v.d);
+		else if (conv == 'd' || conv == 'i')
+			pos += lmod == DBG_RING_LMOD_LLONG ? snprintf(out + pos, size - pos, spec, (long long) v.i) :
+			(lmod == DBG_RING_LMOD_LONG ? snprintf(out + pos, size - pos, spec, (long) v.i) : snprintf(out + pos, size - pos, spec, (int) v.i));
+		else
+			pos += lmod == DBG_RING_LMOD_LLONG ? snprintf(out + pos, size - pos, spec, (unsigned long long) v.u) :
+			(lmod == DBG_RING_LMOD_LONG ? snprintf(out + pos, size - pos, spec, (unsigned long) v.u) : snprintf(out + pos, size - pos, spec, (unsigned int) v.u));
+	}
 
-	dbgl_history[h][unused_i].expire = dbg_mute_to;
-	dbgl_history[h][unused_i].check_len = check_len;
-	dbgl_history[h][unused_i].print_stamp = bmx_time;
-	dbgl_history[h][unused_i].catched = 1;
-	memcpy(dbgl_history[h][unused_i].text, s, XMIN(check_len, strlen(s)));
+	pos = XMIN(pos, size - 1);
+	out[pos] = 0;
+	return pos;
+}
 
-	return DBG_HIST_NEW;
+/*
+ * Renders all captured entries, oldest first, to the given client or, without
+ * one (e.g. when crashing), to syslog.
+ */
+void dbg_ring_dump(struct ctrl_node *cn)
+{
+	static char line[MAX_DBG_STR_SIZE + 1];
+	uint32_t i;
+
+	if (!dbg_ring)
+		return;
+
+	for (i = 0; i < (uint32_t) dbg_ring_entries; i++) {
+
+		struct dbg_ring_entry *e = &dbg_ring[(dbg_ring_next + i) % dbg_ring_entries];
+
+		if (!e->fmt)
+			continue;
+
+		dbg_ring_render(e, line, sizeof(line));
+
+		if (cn)
+			dbg_printf(cn, "%s\n", line);
+		else
+			syslog(LOG_ERR, "%s %s\n", ARG_DBG_RING, line);
+	}
 }
 
 STATIC_FUNC
-void debug_output(uint32_t check_len, struct ctrl_node *cn, int8_t dbgl, int8_t dbgt, const char *f, char *s)
+void dbg_out_vprintf(struct ctrl_node *cn, IDM_T droppable, char *last, va_list ap)
+{
+	static char s[ MAX_DBG_STR_SIZE + 1 ];
+	va_list aq;
+	int len;
+
+	if (!cn || cn->fd <= 0)
+		return;
+
+	errno = 0;
+
+	if (!cn->buffered) {
+
+		if (vdprintf(cn->fd, last, ap) < 0)
+			dprintf(cn->fd, "\nERROR: %s !\n", strerror(errno));
+
+		return;
+	}
+
+	va_copy(aq, ap);
+	len = vsnprintf(s, sizeof(s), last, aq);
+	va_end(aq);
+
+	if (len < 0) {
+		return;
+	} else if (len < (int) sizeof(s)) {
+		ctrl_out_append(cn, s, len, droppable);
+	} else {
+		char *l = debugMalloc(len + 1, -300904);
+		vsnprintf(l, len + 1, last, ap);
+		ctrl_out_append(cn, l, len, droppable);
+		debugFree(l, -300905);
+	}
+}
+
+STATIC_FUNC
+void dbg_out_printf(struct ctrl_node *cn, IDM_T droppable, char *last, ...)
+{
+	va_list ap;
+	va_start(ap, last);
+	dbg_out_vprintf(cn, droppable, last, ap);
+	va_end(ap);
+}
+
+STATIC_FUNC
+void debug_output(uint32_t check_len, uint8_t mute, struct ctrl_node *cn, int8_t dbgl, int8_t dbgt, const char *f, char *s)
 {
 
 	static uint16_t dbgl_all_msg_num = 0;
-	static char *dbgt2str[] = { "", "INFO  ", "WARN  ", "ERROR " };
 
 	struct list_node *list_pos;
 	int16_t dbgl_out[DBGL_MAX + 1];
+	char prefix[32];
 	int i = 0, j;
 
 	uint8_t mute_dbgl_sys = DBG_HIST_NEW;
@@ -544,8 +1051,7 @@ void debug_output(uint32_t check_len, struct ctrl_node *cn, int8_t dbgl, int8_t
 		if (!LIST_EMPTY(&dbgl_clients[DBGL_CHANGES ])) dbgl_out[i++] = DBGL_CHANGES;
 		if (!LIST_EMPTY(&dbgl_clients[DBGL_ALL ])) dbgl_out[i++] = DBGL_ALL;
 
-		if (check_len)
-			mute_dbgl_sys = check_dbg_history(DBGL_SYS, s, check_len);
+		mute_dbgl_sys = mute;
 
 		if (dbg_syslog || initializing || terminating) {
 			if (mute_dbgl_sys != DBG_HIST_MUTED)
@@ -585,14 +1091,16 @@ void debug_output(uint32_t check_len, struct ctrl_node *cn, int8_t dbgl, int8_t
 				level == DBGL_PROFILE ||
 				level == DBGL_SYS ||
 				level == DBGL_ALL)
-				dbg_printf(dn->cn, "[%d %8u %5u] ", My_pid, bmx_time, dbgl_all_msg_num);
-
+				snprintf(prefix, sizeof(prefix), "[%d %8u %5u] ", My_pid, bmx_time, dbgl_all_msg_num);
+			else
+				prefix[0] = 0;
 
-			dbg_printf(dn->cn, "%s%s: %s\n", dbgt2str[dbgt], f ? f : "", s);
+			// verbose output to slow clients is dropped beyond ctrlHighWater
+			dbg_out_printf(dn->cn, YES, "%s%s%s: %s\n", prefix, dbgt2str[dbgt], f ? f : "", s);
 
 			if ((level == DBGL_SYS && mute_dbgl_sys == DBG_HIST_MUTING) ||
 				(level == DBGL_CHANGES && mute_dbgl_changes == DBG_HIST_MUTING))
-				dbg_printf(dn->cn,
+				dbg_out_printf(dn->cn, YES,
 				"[%d %8u] %smuting further messages (with equal first %d bytes) for at most %d seconds\n",
 				My_pid, bmx_time, dbgt2str[DBGT_WARN], check_len, dbg_mute_to / 1000);
 
@@ -602,25 +1110,62 @@ void debug_output(uint32_t check_len, struct ctrl_node *cn, int8_t dbgl, int8_t
 
 
 
-// this static array of char is used by all following dbg functions.
-static char dbg_string_out[ MAX_DBG_STR_SIZE + 1 ];
+/*
+ * Entry point of dbg(), _dbgf(), and the muting variants: captures DBGL_SYS and
+ * DBGL_CHANGES messages into the ring and only formats them if someone is
+ * listening and the message is not muted.
+ */
+STATIC_FUNC
+void debug_record(uint32_t check_len, int8_t dbgl, int8_t dbgt, const char *f, char *last, va_list ap)
+{
+	uint8_t mute = DBG_HIST_NEW;
+
+	if (dbg_ring && (dbgl == DBGL_SYS || dbgl == DBGL_CHANGES)) {
+		struct dbg_ring_entry *e = &dbg_ring[dbg_ring_next];
+		va_list aq;
+
+		dbg_ring_next = (dbg_ring_next + 1) % dbg_ring_entries;
+
+		va_copy(aq, ap);
+		dbg_ring_capture(e, dbgl, dbgt, f, last, aq);
+		va_end(aq);
+	}
+
+	// muting is keyed by the first check_len bytes of the formatted message, so only those are formatted
+	if (check_len && dbgl == DBGL_SYS) {
+		char prefix[DBG_HIST_TEXT_SIZE + 1];
+		va_list aq;
+
+		va_copy(aq, ap);
+		vsnprintf(prefix, XMIN(check_len, DBG_HIST_TEXT_SIZE) + 1, last, aq);
+		va_end(aq);
+
+		mute = check_dbg_history(DBGL_SYS, prefix, check_len);
+	}
+
+	// nobody would see it (again), so don't format it
+	if (debug_system_active && (dbgl == DBGL_CHANGES || mute == DBG_HIST_MUTED) &&
+		LIST_EMPTY(&dbgl_clients[DBGL_CHANGES]) && LIST_EMPTY(&dbgl_clients[DBGL_ALL]))
+		return;
+
+	vsnprintf(dbg_string_out, MAX_DBG_STR_SIZE, last, ap);
+	debug_output(check_len, mute, 0, dbgl, dbgt, f, dbg_string_out);
+}
 
 void dbg(int8_t dbgl, int8_t dbgt, char *last, ...)
 {
 	va_list ap;
 	va_start(ap, last);
-	vsnprintf(dbg_string_out, MAX_DBG_STR_SIZE, last, ap);
+	debug_record(0, dbgl, dbgt, 0, last, ap);
 	va_end(ap);
-	debug_output(0, 0, dbgl, dbgt, 0, dbg_string_out);
 }
 
 void _dbgf(int8_t dbgl, int8_t dbgt, const char *f, char *last, ...)
 {
 	va_list ap;
 	va_start(ap, last);
-	vsnprintf(dbg_string_out, MAX_DBG_STR_SIZE, last, ap);
+	debug_record(0, dbgl, dbgt, f, last, ap);
 	va_end(ap);
-	debug_output(0, 0, dbgl, dbgt, f, dbg_string_out);
 }
 
 void dbg_cn(struct ctrl_node *cn, int8_t dbgl, int8_t dbgt, char *last, ...)
@@ -629,7 +1174,7 @@ void dbg_cn(struct ctrl_node *cn, int8_t dbgl, int8_t dbgt, char *last, ...)
 	va_start(ap, last);
 	vsnprintf(dbg_string_out, MAX_DBG_STR_SIZE, last, ap);
 	va_end(ap);
-	debug_output(0, cn, dbgl, dbgt, 0, dbg_string_out);
+	debug_output(0, DBG_HIST_NEW, cn, dbgl, dbgt, 0, dbg_string_out);
 }
 
 void _dbgf_cn(struct ctrl_node *cn, int8_t dbgl, int8_t dbgt, const char *f, char *last, ...)
@@ -638,25 +1183,23 @@ void _dbgf_cn(struct ctrl_node *cn, int8_t dbgl, int8_t dbgt, const char *f, cha
 	va_start(ap, last);
 	vsnprintf(dbg_string_out, MAX_DBG_STR_SIZE, last, ap);
 	va_end(ap);
-	debug_output(0, cn, dbgl, dbgt, f, dbg_string_out);
+	debug_output(0, DBG_HIST_NEW, cn, dbgl, dbgt, f, dbg_string_out);
 }
 
 void dbg_mute(uint32_t check_len, int8_t dbgl, int8_t dbgt, char *last, ...)
 {
 	va_list ap;
 	va_start(ap, last);
-	vsnprintf(dbg_string_out, MAX_DBG_STR_SIZE, last, ap);
+	debug_record(check_len, dbgl, dbgt, 0, last, ap);
 	va_end(ap);
-	debug_output(check_len, 0, dbgl, dbgt, 0, dbg_string_out);
 }
 
 void _dbgf_mute(uint32_t check_len, int8_t dbgl, int8_t dbgt, const char *f, char *last, ...)
 {
 	va_list ap;
 	va_start(ap, last);
-	vsnprintf(dbg_string_out, MAX_DBG_STR_SIZE, last, ap);
+	debug_record(check_len, dbgl, dbgt, f, last, ap);
 	va_end(ap);
-	debug_output(check_len, 0, dbgl, dbgt, f, dbg_string_out);
 }
 
 void _dbgf_all(int8_t dbgt, const char *f, char *last, ...)
@@ -665,7 +1208,7 @@ void _dbgf_all(int8_t dbgt, const char *f, char *last, ...)
 	va_start(ap, last);
 	vsnprintf(dbg_string_out, MAX_DBG_STR_SIZE, last, ap);
 	va_end(ap);
-	debug_output(0, 0, DBGL_ALL, dbgt, f, dbg_string_out);
+	debug_output(0, DBG_HIST_NEW, 0, DBGL_ALL, dbgt, f, dbg_string_out);
 }
 
 void dbg_spaces(struct ctrl_node *cn, uint16_t spaces)
@@ -678,60 +1221,10 @@ void dbg_spaces(struct ctrl_node *cn, uint16_t spaces)
 
 void dbg_printf(struct ctrl_node *cn, char *last, ...)
 {
-#define MAX_DBG_WRITES 4
-
-	if (!cn || cn->fd <= 0)
-		return;
-
-	/*
-	static char s[ MAX_DBG_STR_SIZE + 1 ];
-	ssize_t w, out = 0;
-	int tries = 1;
-
-	 */
-
-	errno = 0;
-
 	va_list ap;
 	va_start(ap, last);
-	//        vsnprintf(s, MAX_DBG_STR_SIZE, last, ap);
-
-	if (vdprintf(cn->fd, last, ap) < 0) {
-		int err = errno;
-		wait_sec_usec(0, 100000);
-		dprintf(cn->fd, "\nERROR: %s !\n", strerror(err));
-	}
-
+	dbg_out_vprintf(cn, NO, last, ap);
 	va_end(ap);
-
-	/*
-
-	// CONNECTION_END_CHR is reserved for signaling connection end
-	assertion(-500146, (!strchr(s, CONNECTION_END_CHR)));
-
-	errno = 0;
-
-	while ((w = write(cn->fd, s + out, strlen(s + out))) != (ssize_t) strlen(s + out)) {
-
-		if (errno == EPIPE || tries >= MAX_DBG_WRITES || cn->dbgl == DBGL_ALL) {
-
-			if (cn->dbgl != DBGL_ALL) {
-				syslog(LOG_ERR, "failed %d times writing %d instead of %d/%d bytes (%s)! Giving up: %s\n",
-					tries, (int) w, (int) strlen(s + out), (int) strlen(s), strerror(errno), s + out);
-			}
-
-			break;
-		}
-		tries++;
-
-		wait_sec_msec(0, 10000);
-
-		if (w > 0)
-			out += w;
-
-		errno = 0;
-	}
-	 */
 }
 
 #endif
@@ -763,7 +1256,7 @@ uint8_t __dbgf(uint8_t level)
 		return YES;
 	case DBGL_CHANGES:
 	{
-		if (debug_level == DBGL_CHANGES || !LIST_EMPTY(&dbgl_clients[DBGL_CHANGES]))
+		if (debug_level == DBGL_CHANGES || !LIST_EMPTY(&dbgl_clients[DBGL_CHANGES]) || dbg_ring)
 			return YES;
 		break;
 	}
@@ -919,6 +1412,64 @@ int8_t is_valid_opt_ival(struct opt_type *opt, char *s, struct ctrl_node *cn)
 	return SUCCESS;
 }
 
+STATIC_FUNC
+uint32_t opt_index_hash(struct opt_type *parent_opt, const char *name, int32_t len)
+{
+	uint32_t hash = ((unsigned long) parent_opt) >> 4;
+
+	while (len-- > 0)
+		hash = (hash * 31) + tolower((unsigned char) *name++);
+
+	return hash & (OPT_INDEX_SIZE - 1);
+}
+
+STATIC_FUNC
+void opt_index_add(struct opt_type *opt)
+{
+	struct opt_type **bucket;
+
+	if (!opt->name)
+		return;
+
+	bucket = &opt_name_index[opt_index_hash(opt->d.parent_opt, opt->name, strlen(opt->name))];
+	opt->d.name_next = *bucket;
+	*bucket = opt;
+
+	if (opt->short_name) {
+		bucket = &opt_short_index[opt_index_hash(opt->d.parent_opt, &opt->short_name, 1)];
+		opt->d.short_next = *bucket;
+		*bucket = opt;
+	}
+}
+
+STATIC_FUNC
+void opt_index_del(struct opt_type *opt)
+{
+	struct opt_type **pp;
+
+	if (!opt->name)
+		return;
+
+	for (pp = &opt_name_index[opt_index_hash(opt->d.parent_opt, opt->name, strlen(opt->name))]; *pp; pp = &(*pp)->d.name_next) {
+		if (*pp == opt) {
+			*pp = opt->d.name_next;
+			break;
+		}
+	}
+
+	if (opt->short_name) {
+		for (pp = &opt_short_index[opt_index_hash(opt->d.parent_opt, &opt->short_name, 1)]; *pp; pp = &(*pp)->d.short_next) {
+			if (*pp == opt) {
+				*pp = opt->d.short_next;
+				break;
+			}
+		}
+	}
+
+	opt->d.name_next = NULL;
+	opt->d.short_next = NULL;
+}
+
 STATIC_FUNC
 void register_option(struct opt_type *opt, const char * category_name)
 {
@@ -991,6 +1542,7 @@ void register_option(struct opt_type *opt, const char * category_name)
 		opt->d.parent_opt = tmp_opt;
 
 		bmx_list_add_tail(&tmp_opt->d.childs_type_list, &opt->d.list);
+		opt_index_add(opt);
 
 	} else {
 
@@ -1019,6 +1571,7 @@ void register_option(struct opt_type *opt, const char * category_name)
 		if (!tmp_opt)
 			bmx_list_add_tail(&opt_list, &opt->d.list);
 
+		opt_index_add(opt);
 	}
 
 	if (opt->call_custom_option && ((opt->call_custom_option)(OPT_REGISTER, 0, opt, 0, 0)) == FAILURE) {
@@ -1062,6 +1615,12 @@ void remove_option(struct opt_type *opt)
 				dbgf_sys(DBGT_ERR, "%s failed!", opt->name);
 			}
 
+			list_for_each(tmp_pos, &opt->d.childs_type_list)
+			{
+				opt_index_del((struct opt_type *) list_entry(tmp_pos, struct opt_data, list));
+			}
+
+			opt_index_del(opt);
 			list_del_next(&opt_list, prev_pos);
 			return;
 
@@ -1092,9 +1651,7 @@ void register_options_array(struct opt_type *fixed_options, int size, const char
 struct opt_type *get_option(struct opt_type *parent_opt, uint8_t short_opt, char *sin)
 {
 
-	struct list_node *list_pos;
 	int32_t len = 0;
-	struct bmx_list_head *list;
 	struct opt_type *opt = NULL;
 	char *equalp = NULL;
 	char s[MAX_ARG_SIZE] = "";
@@ -1116,31 +1673,20 @@ struct opt_type *get_option(struct opt_type *parent_opt, uint8_t short_opt, char
 		len = wordlen(s);
 
 
-	if (parent_opt == NULL)
-		list = &opt_list;
-	else
-		list = &parent_opt->d.childs_type_list;
-
 	dbgf_all(DBGT_INFO, "searching %s", s);
 
-	list_for_each(list_pos, list)
-	{
-
-		opt = (struct opt_type *) list_entry(list_pos, struct opt_data, list);
-
-		if (!opt->name)
-			continue;
-
-		else if (!short_opt && len == (int) strlen(opt->name) && !strncasecmp(s, opt->name, len))
-			break;
-
-		else if (!short_opt && len == 1 && s[0] == opt->short_name)
-			break;
-
-		else if (short_opt && s[0] == opt->short_name)
-			break;
+	if (!short_opt) {
+		for (opt = opt_name_index[opt_index_hash(parent_opt, s, len)]; opt; opt = opt->d.name_next) {
+			if (opt->d.parent_opt == parent_opt && len == (int) strlen(opt->name) && !strncasecmp(s, opt->name, len))
+				break;
+		}
+	}
 
-		opt = NULL;
+	if (!opt && (short_opt || len == 1)) {
+		for (opt = opt_short_index[opt_index_hash(parent_opt, s, 1)]; opt; opt = opt->d.short_next) {
+			if (opt->d.parent_opt == parent_opt && s[0] == opt->short_name)
+				break;
+		}
 	}
 
 	if (opt && opt->name) {
@@ -2918,6 +3464,80 @@ int32_t opt_help(uint8_t cmd, uint8_t _save, struct opt_type *opt, struct opt_pa
 	return SUCCESS;
 }
 
+STATIC_FUNC
+int32_t opt_subscribe(uint8_t cmd, uint8_t _save, struct opt_type *opt, struct opt_parent *patch, struct ctrl_node *cn)
+{
+
+	if (cmd == OPT_CHECK || cmd == OPT_APPLY) {
+
+		char classes[MAX_ARG_SIZE];
+		char *tok, *save = NULL;
+		uint8_t events = 0;
+		uint8_t c;
+
+		snprintf(classes, sizeof(classes), "%s", patch->val);
+
+		for (tok = strtok_r(classes, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+
+			if (!strcmp(tok, "all")) {
+				events |= CTRL_EVENT_ALL;
+				continue;
+			}
+
+			for (c = 0; c < (sizeof(ctrl_event_names) / sizeof(ctrl_event_names[0])); c++) {
+				if (!strcmp(tok, ctrl_event_names[c]))
+					break;
+			}
+
+			if (c >= (sizeof(ctrl_event_names) / sizeof(ctrl_event_names[0]))) {
+				dbg_cn(cn, DBGL_SYS, DBGT_ERR, "invalid %s class %s", opt->name, tok);
+				return FAILURE;
+			}
+
+			events |= (1 << c);
+		}
+
+		if (!events)
+			return FAILURE;
+
+		if (cmd == OPT_APPLY) {
+
+			if (!cn || cn->fd <= 0 || !cn->buffered)
+				return FAILURE;
+
+			cn->events = events;
+			ctrl_event_update_subscribed();
+		}
+	}
+
+	return SUCCESS;
+}
+
+STATIC_FUNC
+int32_t opt_dbg_ring(uint8_t cmd, uint8_t _save, struct opt_type *opt, struct opt_parent *patch, struct ctrl_node *cn)
+{
+
+	if (cmd == OPT_APPLY && !strcmp(opt->name, ARG_DBG_RING)) {
+
+		if (dbg_ring)
+			debugFree(dbg_ring, -300908);
+
+		dbg_ring = dbg_ring_entries ? debugMallocReset(dbg_ring_entries * sizeof(struct dbg_ring_entry), -300907) : NULL;
+		dbg_ring_next = 0;
+
+	} else if (cmd == OPT_APPLY && !strcmp(opt->name, ARG_DBG_RING_DUMP)) {
+
+		dbg_ring_dump(cn);
+
+	} else if (cmd == OPT_UNREGISTER && dbg_ring) {
+
+		debugFree(dbg_ring, -300908);
+		dbg_ring = NULL;
+	}
+
+	return SUCCESS;
+}
+
 STATIC_FUNC
 int32_t opt_quit_connection(uint8_t cmd, uint8_t _save, struct opt_type *opt, struct opt_parent *patch, struct ctrl_node *cn)
 {
@@ -2964,6 +3584,71 @@ int32_t opt_run_dir(uint8_t cmd, uint8_t _save, struct opt_type *opt, struct opt
 
 
 
+struct ctrl_status {
+	uint32_t fd;
+	char type[8];
+	int32_t dbgl;
+	char events[40];
+	uint32_t pending;
+	uint32_t peak;
+	uint32_t buffer;
+	char dropped[24];
+	uint32_t closing;
+};
+
+static const struct field_format ctrl_status_format[] = {
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT,              ctrl_status, fd,            1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       ctrl_status, type,          1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_INT,               ctrl_status, dbgl,          1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       ctrl_status, events,        1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT,              ctrl_status, pending,       1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT,              ctrl_status, peak,          1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT,              ctrl_status, buffer,        1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       ctrl_status, dropped,       1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT,              ctrl_status, closing,       1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_END
+};
+
+static int32_t ctrl_status_creator(struct status_handl *handl, void *data)
+{
+	struct list_node *list_pos;
+	struct ctrl_status *status;
+	uint32_t i = 0, c;
+
+	list_for_each(list_pos, &ctrl_list)
+	{
+		i++;
+	}
+
+	status = (struct ctrl_status *) (handl->data = debugRealloc(handl->data, (i + 1) * sizeof(struct ctrl_status), -300906));
+	memset(status, 0, (i + 1) * sizeof(struct ctrl_status));
+	i = 0;
+
+	list_for_each(list_pos, &ctrl_list)
+	{
+		struct ctrl_node *cn = list_entry(list_pos, struct ctrl_node, list);
+		int pos = 0;
+
+		status[i].fd = cn->fd;
+		snprintf(status[i].type, sizeof(status[i].type), "%s", cn->buffered ? "socket" : (cn->cn_fd_handler ? "plugin" : "fd"));
+		status[i].dbgl = cn->dbgl;
+
+		for (c = 0; c < (sizeof(ctrl_event_names) / sizeof(ctrl_event_names[0])); c++) {
+			if (cn->events & (1 << c))
+				pos += snprintf(status[i].events + pos, sizeof(status[i].events) - pos, "%s%s", pos ? "," : "", ctrl_event_names[c]);
+		}
+
+		status[i].pending = cn->outLen;
+		status[i].peak = cn->outPeak;
+		status[i].buffer = cn->outSize;
+		snprintf(status[i].dropped, sizeof(status[i].dropped), "%llu", (unsigned long long) cn->outDropped);
+		status[i].closing = cn->closing_stamp ? ((TIME_T) (bmx_time - cn->closing_stamp)) : 0;
+		i++;
+	}
+
+	return i * sizeof(struct ctrl_status);
+}
+
 static struct opt_type control_options[] ={
 	//        ord parent long_name          shrt Attributes				*ival		min		max		default		*func,*syntax,*help
 
@@ -3021,10 +3706,26 @@ static struct opt_type control_options[] ={
 			0,		"show configured parameters"}
 	,
 
+	{ODI,0,ARG_DBG_RING,		0,  9,1,A_PS1,A_ADM,A_DYI,A_CFA,A_ANY,	&dbg_ring_entries,MIN_DBG_RING,	MAX_DBG_RING,	DEF_DBG_RING,0,	opt_dbg_ring,
+			ARG_VALUE_FORM,	"set number of unformatted system and changes (level 3) debug messages kept for " ARG_DBG_RING_DUMP " and crash reports, 0 disables"},
+
+	{ODI,0,ARG_DBG_RING_DUMP,	0,  9,1,A_PS0,A_ADM,A_DYN,A_ARG,A_ANY,	0,		0, 		0,		0,0, 		opt_dbg_ring,
+			0,		"show messages kept by " ARG_DBG_RING},
+
         {ODI,0,"dbgMuteTimeout",	0,  9,1,A_PS1,A_ADM,A_DYI,A_CFA,A_ANY,	&dbg_mute_to,	0,		10000000,	100000,0,	0,
 			ARG_VALUE_FORM,	"set timeout in ms for muting frequent messages"},
 
 
+	{ODI,0,ARG_CTRL_HIGH_WATER,     0,  9,1,A_PS1,A_ADM,A_DYI,A_CFA,A_ANY,	&ctrl_high_water,MIN_CTRL_HIGH_WATER,MAX_CTRL_HIGH_WATER,DEF_CTRL_HIGH_WATER,0,0,
+			ARG_VALUE_FORM,	"set bytes of pending output per control client beyond which debug and event output to that client is dropped"},
+
+	{ODI,0,ARG_CTRL_CLIENTS,	0,  9,1,A_PS0N,A_USR,A_DYN,A_ARG,A_ANY,	0,		0, 		0,		0,0, 		opt_status,
+			0,		"show connected control clients and their output buffers\n"},
+
+	{ODI,0,ARG_SUBSCRIBE,		0,  9,2,A_PS1,A_USR,A_DYN,A_ARG,A_ETE,	0,		0, 		0,		0,0, 		opt_subscribe,
+			"<CLASS>[,<CLASS>...]", "keep connection open and stream incremental event records (must be last option)\n"
+		"	CLASS: routes, descriptions, links, devices, or all"},
+
 	{ODI,0,ARG_QUIT,CHR_QUIT,    9,0,A_PS0,A_USR,A_DYN,A_ARG,A_END,	        0,		0, 		0,		0,0, 		opt_quit_connection,0,0}
 };
 
@@ -3048,6 +3749,7 @@ void init_control(void)
 	LIST_INIT_HEAD(Patch_opt.d.parents_instance_list, struct opt_parent, list, list);
 
 	register_options_array(control_options, sizeof( control_options), CODE_CATEGORY_NAME);
+	register_status_handl(sizeof(struct ctrl_status), 1, ctrl_status_format, ARG_CTRL_CLIENTS, ctrl_status_creator);
 
 }
 
@@ -111,10 +111,44 @@ struct ctrl_node {
 	int fd;
 	void (*cn_fd_handler) (struct ctrl_node *);
 	TIME_T closing_stamp;
+	uint32_t closing_timeout; // ms, overrides CTRL_CLOSING_TIMEOUT if set
 	uint8_t authorized;
 	int8_t dbgl;
+	uint8_t events; // subscribed CTRL_EVENT_* classes
+	uint8_t buffered; // output is queued in outBuff and drained via writable-fd events
+	uint8_t outClose; // close fd once outBuff is drained
+	uint32_t outHead;
+	uint32_t outLen;
+	uint32_t outSize;
+	uint32_t outPeak;
+	uint32_t outDroppedPending; // bytes dropped since the last drop notice
+	uint64_t outDropped; // total bytes dropped
+	char *outBuff; // ring buffer of outSize bytes
 };
 
+#define ARG_CTRL_HIGH_WATER "ctrlHighWater"
+#define MIN_CTRL_HIGH_WATER 1024
+#define MAX_CTRL_HIGH_WATER (16 * 1024 * 1024)
+#define DEF_CTRL_HIGH_WATER 65536
+
+#define CTRL_OUT_BUFF_MIN 4096
+#define CTRL_OUT_BUFF_MAX (2 * MAX_CTRL_HIGH_WATER)
+
+#define ARG_CTRL_CLIENTS "clients"
+
+#define ARG_SUBSCRIBE "subscribe"
+
+#define CTRL_EVENT_ROUTES 0x01
+#define CTRL_EVENT_DESCS  0x02
+#define CTRL_EVENT_LINKS  0x04
+#define CTRL_EVENT_DEVS   0x08
+#define CTRL_EVENT_ALL    0x0F
+
+extern uint8_t ctrl_events_subscribed;
+
+void _ctrl_event(uint8_t class, char *last, ...);
+#define ctrl_event( class, ... ) do { if (ctrl_events_subscribed & (class)) _ctrl_event( class, __VA_ARGS__ ); } while (0)
+
 extern struct bmx_list_head dbgl_clients[DBGL_MAX + 1];
 
 struct dbgl_node {
@@ -125,16 +159,51 @@ struct dbgl_node {
 
 
 // muting does not help if a changing value like time or seqno occurs durig the first DBG_HIST_TEXT_SIZE bytes
-#define DBG_HIST_TEXT_SIZE 80 
-#define DBG_HIST_SIZE 20
+#define DBG_HIST_TEXT_SIZE 80
+#define DBG_HIST_SIZE 64
+#define DBG_HIST_WAYS 4 // entries per set, colliding messages only evict each other's muting beyond that
 //#define DBG_HIST_EXPIRE 100000
 
 struct dbg_histogram {
 	TIME_T print_stamp;
 	int32_t expire;
+	uint32_t hash;     // of the first check_len bytes of the formatted message
 	uint16_t check_len;
 	uint16_t catched;
-	char text[ DBG_HIST_TEXT_SIZE ];
+};
+
+#define ARG_DBG_RING "dbgRing"
+#define MIN_DBG_RING 0
+#define MAX_DBG_RING 65536
+#define DEF_DBG_RING 0
+#define ARG_DBG_RING_DUMP "dbgRingDump"
+
+#define DBG_RING_DATA_SIZE 224
+#define DBG_RING_STR_MAX 64
+#define DBG_RING_SPEC_MAX 31
+
+#define DBG_RING_LMOD_INT 0
+#define DBG_RING_LMOD_LONG 1
+#define DBG_RING_LMOD_LLONG 2
+#define DBG_RING_LMOD_DOUBLE 3
+
+union dbg_ring_arg {
+	int64_t i;
+	uint64_t u;
+	double d;
+};
+
+// one unformatted debug message: call site, time, and raw arguments
+struct dbg_ring_entry {
+	char *fmt;
+	const char *func;
+	TIME_T time;
+	int8_t dbgl;
+	int8_t dbgt;
+	uint8_t args;
+	uint8_t len;
+	uint8_t truncated;
+	uint8_t data[DBG_RING_DATA_SIZE];
 };
 
 
@@ -191,6 +260,7 @@ void _dbgf_all(int8_t dbgt, const char *f, char *last, ...);
 
 void dbg_printf(struct ctrl_node *cn, char *last, ...);
 void dbg_spaces(struct ctrl_node *cn, uint16_t spaces);
+void dbg_ring_dump(struct ctrl_node *cn);
 #else
 
 #define dbgf( dbgl, dbgt, ...)    printf( __VA_ARGS__ )
@@ -211,6 +281,7 @@ void dbg_spaces(struct ctrl_node *cn, uint16_t spaces);
 #define dbgf_ext( dbgt, ... )    printf( __VA_ARGS__ )
 #define dbg_printf( cn, ...  )    printf( __VA_ARGS__ )
 #define dbg_spaces(cn, spaces)
+#define dbg_ring_dump(cn)
 #endif
 
 uint8_t __dbgf_all(void);
@@ -219,6 +290,8 @@ uint8_t __dbgf(uint8_t level);
 
 void accept_ctrl_node(void);
 void handle_ctrl_node(struct ctrl_node *cn);
+void handle_ctrl_node_output(struct ctrl_node *cn);
+int8_t ctrl_out_write(struct ctrl_node *cn, const char *data, uint32_t len);
 void close_ctrl_node(uint8_t cmd, struct ctrl_node *cn);
 struct ctrl_node *create_ctrl_node(int fd, void (*cn_fd_handler) (struct ctrl_node *), uint8_t authorized);
 
@@ -302,7 +375,7 @@ struct opt_parent {
 
 };
 
-#define ODI {NULL, {0}, NULL, {0,0,0,0,0,0}, {0,0,0,0,0,0}}
+#define ODI {NULL, {0}, NULL, {0,0,0,0,0,0}, {0,0,0,0,0,0}, NULL, NULL}
 
 struct opt_data {
 	const char *category_name;
@@ -314,8 +387,13 @@ struct opt_data {
 	struct bmx_list_head childs_type_list; //if this opt is a section type, then further sub-opts types can be listed here
 
 	struct bmx_list_head parents_instance_list; //
+
+	struct opt_type *name_next; // next in opt_name_index bucket
+	struct opt_type *short_next; // next in opt_short_index bucket
 };
 
+#define OPT_INDEX_SIZE 256 // must be a power of two
+
 struct opt_type {
 	struct opt_data d; //MUST be first structure in opt_type to allow casting between struct opt_data and  struct opt_type
 
@@ -52,6 +52,11 @@ static int32_t data_dev_plugin_registry = FAILURE;
 
 static struct dump_data dump_all;
 
+struct dump_data *get_traffic_statistics(void)
+{
+	return &dump_all;
+}
+
 STATIC_FUNC
 void update_traffic_statistics_data(struct dump_data *data)
 {
@@ -134,6 +139,7 @@ void dump(struct packet_buff *pb)
 	(*dev_plugin_data)->tmp_all[direction][DUMP_TYPE_UDP_PAYLOAD] += (plength << IMPROVE_ROUNDOFF);
 
 	dump_all.tmp_all[direction][DUMP_TYPE_UDP_PAYLOAD] += (plength << IMPROVE_ROUNDOFF);
+	dump_all.sum_all[direction][DUMP_TYPE_UDP_PAYLOAD] += plength;
 
 
 	dbgf(DBGL_DUMP, DBGT_NONE,
@@ -144,6 +150,7 @@ void dump(struct packet_buff *pb)
 	(*dev_plugin_data)->tmp_all[direction][DUMP_TYPE_PACKET_HEADER] += (sizeof(struct packet_header) << IMPROVE_ROUNDOFF);
 
 	dump_all.tmp_all[direction][DUMP_TYPE_PACKET_HEADER] += (sizeof(struct packet_header) << IMPROVE_ROUNDOFF);
+	dump_all.sum_all[direction][DUMP_TYPE_PACKET_HEADER] += sizeof(struct packet_header);
 
 
 	struct rx_frame_iterator it = {
@@ -186,10 +193,12 @@ void dump(struct packet_buff *pb)
 		(*dev_plugin_data)->tmp_frame[direction][it.f_type] += (it._f_len << IMPROVE_ROUNDOFF);
 
 		dump_all.tmp_frame[direction][it.f_type] += (it._f_len << IMPROVE_ROUNDOFF);
+		dump_all.sum_frame[direction][it.f_type] += it._f_len;
 
 		(*dev_plugin_data)->tmp_all[direction][DUMP_TYPE_FRAME_HEADER] += ((it._f_len - it.f_dlen) << IMPROVE_ROUNDOFF);
 
 		dump_all.tmp_all[direction][DUMP_TYPE_FRAME_HEADER] += ((it._f_len - it.f_dlen) << IMPROVE_ROUNDOFF);
+		dump_all.sum_all[direction][DUMP_TYPE_FRAME_HEADER] += (it._f_len - it.f_dlen);
 
 		pkt_pos += it._f_len;
 	}
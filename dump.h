@@ -50,4 +50,10 @@ struct dump_data {
 	uint32_t tmp_all[DUMP_DIRECTION_ARRSZ][DUMP_TYPE_ARRSZ];
 	uint32_t pre_all[DUMP_DIRECTION_ARRSZ][DUMP_TYPE_ARRSZ];
 	uint32_t avg_all[DUMP_DIRECTION_ARRSZ][DUMP_TYPE_ARRSZ];
+
+	// bytes since startup (not shifted by IMPROVE_ROUNDOFF):
+	uint64_t sum_frame[DUMP_DIRECTION_ARRSZ][FRAME_TYPE_ARRSZ];
+	uint64_t sum_all[DUMP_DIRECTION_ARRSZ][DUMP_TYPE_ARRSZ];
 };
+
+struct dump_data *get_traffic_statistics(void);
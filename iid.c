@@ -59,7 +59,39 @@
  ************************************************************/
 
 
-struct iid_repos my_iid_repos = {0, 0, 0, 0, {NULL}};
+#define IID_USED_WORD_BITS 64
+
+#if (IID_REPOS_SIZE_BLOCK % IID_USED_WORD_BITS)
+#error "IID_REPOS_SIZE_BLOCK must be a multiple of IID_USED_WORD_BITS"
+#endif
+
+#define IID_USED_WORDS(size) ((size) / IID_USED_WORD_BITS)
+#define IID_USED_BIT(iid) (((uint64_t) 1) << ((iid) % IID_USED_WORD_BITS))
+
+struct iid_repos my_iid_repos = {0, 0, 0, 0, NULL, {NULL}};
+
+uint32_t iid_repos_shrinks = 0;
+
+STATIC_FUNC
+void iid_resize_repos(struct iid_repos *rep, IID_T new_size)
+{
+	assertion(-502790, (new_size && !(new_size % IID_REPOS_SIZE_BLOCK)));
+
+	if (rep->arr_size) {
+		rep->arr.u8 = debugRealloc(rep->arr.u8, new_size * sizeof(struct iid_ref), -300035);
+		rep->used = debugRealloc(rep->used, IID_USED_WORDS(new_size) * sizeof(uint64_t), -300859);
+	} else {
+		rep->arr.u8 = debugMalloc(new_size * sizeof(struct iid_ref), -300085);
+		rep->used = debugMalloc(IID_USED_WORDS(new_size) * sizeof(uint64_t), -300860);
+	}
+
+	if (new_size > rep->arr_size) {
+		memset(&(rep->arr.u8[rep->arr_size * sizeof(struct iid_ref)]), 0, (new_size - rep->arr_size) * sizeof(struct iid_ref));
+		memset(&(rep->used[IID_USED_WORDS(rep->arr_size)]), 0, IID_USED_WORDS(new_size - rep->arr_size) * sizeof(uint64_t));
+	}
+
+	rep->arr_size = new_size;
+}
 
 void iid_extend_repos(struct iid_repos *rep)
 {
@@ -72,21 +104,13 @@ void iid_extend_repos(struct iid_repos *rep)
 		assertion(-502538, (rep->arr_size + IID_REPOS_SIZE_BLOCK <= IID_REPOS_SIZE_MAX));
 	}
 
-	if (rep->arr_size) {
-
-		rep->arr.u8 = debugRealloc(rep->arr.u8, (rep->arr_size + IID_REPOS_SIZE_BLOCK) * sizeof(struct iid_ref), -300035);
-
-	} else {
-
-		rep->arr.u8 = debugMalloc(IID_REPOS_SIZE_BLOCK * sizeof(struct iid_ref), -300085);
+	if (!rep->arr_size) {
 		rep->tot_used = IID_RSVD_MAX + 1;
 		rep->min_free = IID_RSVD_MAX + 1;
 		rep->max_free = IID_RSVD_MAX + 1;
 	}
 
-	memset(&(rep->arr.u8[rep->arr_size * sizeof(struct iid_ref)]), 0, IID_REPOS_SIZE_BLOCK * sizeof(struct iid_ref));
-
-	rep->arr_size += IID_REPOS_SIZE_BLOCK;
+	iid_resize_repos(rep, rep->arr_size + IID_REPOS_SIZE_BLOCK);
 }
 
 void iid_purge_repos(struct iid_repos *rep)
@@ -94,10 +118,75 @@ void iid_purge_repos(struct iid_repos *rep)
 	if (rep->arr.u8)
 		debugFree(rep->arr.u8, -300135);
 
+	if (rep->used)
+		debugFree(rep->used, -300861);
+
 	memset(rep, 0, sizeof( struct iid_repos));
 
 }
 
+/*
+ * Returns the first unused field at or after iid, or arr_size if all remaining fields are used.
+ */
+STATIC_FUNC
+IID_T iid_next_free(struct iid_repos *rep, IID_T iid)
+{
+	uint32_t w = IID_USED_WORDS(iid);
+	uint64_t free;
+
+	if (iid >= rep->arr_size)
+		return rep->arr_size;
+
+	for (free = ~rep->used[w] & ~(IID_USED_BIT(iid) - 1); !free; free = ~rep->used[w]) {
+
+		if (++w >= IID_USED_WORDS(rep->arr_size))
+			return rep->arr_size;
+	}
+
+	return (w * IID_USED_WORD_BITS) + __builtin_ctzll(free);
+}
+
+/*
+ * Returns the first used field at or after iid, or IID_RSVD_MAX if no such field exists.
+ * Iterate over all occupied IIDs with: for (iid = 0; (iid = iid_next_used(rep, iid + 1));)
+ */
+IID_T iid_next_used(struct iid_repos *rep, IID_T iid)
+{
+	uint32_t w = IID_USED_WORDS(iid);
+	uint64_t used;
+
+	if (iid >= rep->max_free)
+		return IID_RSVD_MAX;
+
+	for (used = rep->used[w] & ~(IID_USED_BIT(iid) - 1); !used; used = rep->used[w]) {
+
+		if (++w >= IID_USED_WORDS(rep->arr_size))
+			return IID_RSVD_MAX;
+	}
+
+	return (w * IID_USED_WORD_BITS) + __builtin_ctzll(used);
+}
+
+/*
+ * Returns the field following the last used field before iid, but at least IID_MIN_USED_FOR_SELF.
+ */
+STATIC_FUNC
+IID_T iid_max_free_before(struct iid_repos *rep, IID_T iid)
+{
+	int32_t w = IID_USED_WORDS(iid);
+	uint64_t used = (iid % IID_USED_WORD_BITS) ? (rep->used[w] & (IID_USED_BIT(iid) - 1)) : 0;
+
+	while (!used) {
+
+		if (--w < 0)
+			return IID_MIN_USED_FOR_SELF;
+
+		used = rep->used[w];
+	}
+
+	return XMAX(IID_MIN_USED_FOR_SELF, (w * IID_USED_WORD_BITS) + (IID_USED_WORD_BITS - __builtin_clzll(used)));
+}
+
 void iid_free(struct iid_repos *rep, IID_T iid)
 {
 	rep = rep ? rep : &my_iid_repos;
@@ -107,6 +196,7 @@ void iid_free(struct iid_repos *rep, IID_T iid)
 
 	struct iid_ref *ref = &rep->arr.r[iid];
 	assertion(-500229, (ref->referred_timestamp));
+	assertion(-502791, (rep->used[IID_USED_WORDS(iid)] & IID_USED_BIT(iid)));
 
 	if (rep == &my_iid_repos)
 		((MIID_T*) (ref->iidn))->__myIID4x = 0;
@@ -115,21 +205,12 @@ void iid_free(struct iid_repos *rep, IID_T iid)
 
 	ref->iidn = NULL;
 	ref->referred_timestamp = 0;
+	rep->used[IID_USED_WORDS(iid)] &= ~IID_USED_BIT(iid);
 
 	rep->min_free = XMIN(rep->min_free, iid);
 
-	if (rep->max_free == iid + 1) {
-
-		IID_T i;
-
-		for (i = iid; i > IID_MIN_USED_FOR_SELF; i--) {
-
-			if (rep->arr.r[i - 1].referred_timestamp)
-				break;
-		}
-
-		rep->max_free = i;
-	}
+	if (rep->max_free == iid + 1)
+		rep->max_free = iid_max_free_before(rep, iid);
 
 	rep->tot_used--;
 
@@ -141,6 +222,12 @@ void iid_free(struct iid_repos *rep, IID_T iid)
 		assertion(-500362, (rep->tot_used == IID_MIN_USED_FOR_SELF && rep->max_free == IID_MIN_USED_FOR_SELF && rep->min_free == IID_MIN_USED_FOR_SELF));
 
 		iid_purge_repos(rep);
+
+	} else if (rep->arr_size >= rep->max_free + (2 * IID_REPOS_SIZE_BLOCK)) {
+
+		// compact the tail of sparse repositories, keeping one spare block to avoid realloc oscillation:
+		iid_resize_repos(rep, ((rep->max_free / IID_REPOS_SIZE_BLOCK) + 2) * IID_REPOS_SIZE_BLOCK);
+		iid_repos_shrinks++;
 	}
 
 }
@@ -228,13 +315,8 @@ void _iid_set(struct iid_repos *rep, IID_T IIDpos, NIID_T *nbn, MIID_T *myn)
 
 	IID_T min = rep->min_free;
 
-	if (min == IIDpos) {
-		for (min++; min < rep->arr_size; min++) {
-
-			if (!(rep->arr.r[min].referred_timestamp))
-				break;
-		}
-	}
+	if (min == IIDpos)
+		min = iid_next_free(rep, min + 1);
 
 	assertion(-500244, (min <= rep->max_free));
 
@@ -242,6 +324,7 @@ void _iid_set(struct iid_repos *rep, IID_T IIDpos, NIID_T *nbn, MIID_T *myn)
 
 	assertion(-502551, (!rep->arr.r[IIDpos].iidn));
 	assertion(-502552, (!rep->arr.r[IIDpos].referred_timestamp));
+	assertion(-502792, (!(rep->used[IID_USED_WORDS(IIDpos)] & IID_USED_BIT(IIDpos))));
 
 	if (nbn) {
 		assertion(-502553, (!nbn->__neighIID4x));
@@ -254,7 +337,7 @@ void _iid_set(struct iid_repos *rep, IID_T IIDpos, NIID_T *nbn, MIID_T *myn)
 	}
 
 	rep->arr.r[IIDpos].referred_timestamp = bmx_time;
-
+	rep->used[IID_USED_WORDS(IIDpos)] |= IID_USED_BIT(IIDpos);
 
 }
 
@@ -33,6 +33,8 @@ struct iid_repos {
 	IID_T max_free; // the first unused array field after the last used field in the array (might be outside of allocated space)
 	IID_T tot_used; // the total number of used fields in the array
 
+	uint64_t *used; // occupied-slot bitmap, one bit per array field, IID_REPOS_SIZE_BLOCK fields per word
+
 	union {
 		uint8_t *u8;
 		struct iid_ref *r;
@@ -41,11 +43,13 @@ struct iid_repos {
 
 
 extern struct iid_repos my_iid_repos;
+extern uint32_t iid_repos_shrinks;
 
 
 void iid_extend_repos(struct iid_repos *rep);
 void iid_purge_repos(struct iid_repos *rep);
 void iid_free(struct iid_repos *rep, IID_T iid);
+IID_T iid_next_used(struct iid_repos *rep, IID_T iid);
 void iid_set_neighIID4x(struct iid_repos *rep, IID_T neighIID4x, NIID_T *niidn);
 IID_T iid_new_myIID4x(MIID_T *on);
 
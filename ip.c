@@ -37,6 +37,7 @@
 #include <asm/types.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
+#include <linux/netconf.h>
 
 #include <linux/ip.h>
 #include <net/if.h>
@@ -106,6 +107,8 @@ int32_t base_port = DEF_BASE_PORT;
 
 int32_t netlinkBuffSize = DEF_NETLINK_BUFFSZ;
 
+static int32_t netlinkBatch = DEF_NETLINK_BATCH;
+
 //TODO: make this configurable
 static struct net_key llocal_prefix_cfg;
 struct net_key autoconf_prefix_cfg;
@@ -147,6 +150,7 @@ AVL_TREE(dev_name_tree, struct dev_node, ifname_device);
 AVL_TREE(tun_name_tree, struct ifname, str);
 
 AVL_TREE(iptrack_tree, struct track_node, k);
+static AVL_TREE(rule_track_tree, struct rule_track_node, k);
 
 
 static int ifevent_sk = -1;
@@ -407,6 +411,12 @@ char *trackt2str(uint16_t cmd)
 	else if (cmd == IP_ROUTE_GET)
 		return "ROUTE_GET";
 
+	else if (cmd == IP_NETCONF_GET)
+		return "NETCONF_GET";
+
+	else if (cmd == IP_STATS_GET)
+		return "STATS_GET";
+
 
 	else if (cmd == IP_ADDRESS_SET)
 		return "ADDRESS_SET";
@@ -574,12 +584,219 @@ int rtnl_rcv(int fd, uint32_t pid, uint32_t seq, uint16_t cmd, uint8_t quiet, vo
 	return SUCCESS;
 }
 
+/*
+ * Route and rule changes requested via iproute() are queued here and sent to the kernel
+ * packed into a single sendmsg() without NLM_F_ACK, followed by an NLMSG_NOOP barrier with NLM_F_ACK.
+ * The kernel only acks failed messages and the barrier, so errors are matched by sequence number
+ * and the batch costs one round trip instead of one per message.
+ * The batch is flushed when full, at the next scheduler iteration, and before any other
+ * netlink or tunnel-device operation to keep kernel ordering consistent with iptrack().
+ */
+struct rtnl_batch_msg {
+	uint32_t seq;
+	uint32_t offset;
+	uint16_t cmd;
+	int8_t del;
+	uint8_t quiet;
+	struct track_key k;
+	uint8_t nexthop; // queued route deletion with known next hop, to be diffed against a following add
+	uint32_t oif_idx;
+	IPX_T via;
+	IPX_T src;
+};
+
+static struct rtnl_batch {
+	uint32_t len;
+	uint16_t msgs;
+	uint32_t flushes;
+	uint32_t sent;
+	uint32_t errors;
+	uint32_t replaced;
+	uint32_t unchanged;
+	struct rtnl_batch_msg msg[MAX_NETLINK_BATCH];
+	char buf[RTNL_RCV_MAX];
+} rtnl_batch;
+
+STATIC_FUNC
+void rtnl_batch_reset(void)
+{
+	rtnl_batch.sent += rtnl_batch.msgs;
+	rtnl_batch.len = rtnl_batch.msgs = 0;
+}
+
+STATIC_FUNC
+void rtnl_batch_flush(void *unused)
+{
+	if (!rtnl_batch.msgs)
+		return;
+
+	task_remove(rtnl_batch_flush, NULL);
+
+	assertion(-502796, (!ip_rth.busy));
+	assertion(-502797, (rtnl_batch.len + NLMSG_ALIGN(NLMSG_LENGTH(0)) <= sizeof(rtnl_batch.buf)));
+	ip_rth.busy = 1;
+
+	uint64_t nsStart = prof_now(); // bmx_time does not advance while blocking here
+	uint32_t firstSeq = rtnl_batch.msg[0].seq;
+	struct nlmsghdr *barrier = (struct nlmsghdr *) &rtnl_batch.buf[rtnl_batch.len];
+
+	memset(barrier, 0, NLMSG_LENGTH(0));
+	barrier->nlmsg_len = NLMSG_LENGTH(0);
+	barrier->nlmsg_type = NLMSG_NOOP;
+	barrier->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+	barrier->nlmsg_pid = My_pid;
+	barrier->nlmsg_seq = ++(ip_rth.seq);
+
+	errno = 0;
+	if (send(ip_rth.fd, rtnl_batch.buf, rtnl_batch.len + NLMSG_ALIGN(barrier->nlmsg_len), 0) < 0) {
+		dbgf_sys(DBGT_ERR, "can't send netlink batch of %d messages to kernel: %s", rtnl_batch.msgs, strerror(errno));
+		ip_rth.busy = 0;
+		EXITERROR(-502798, (0));
+		rtnl_batch_reset();
+		return;
+	}
+
+	IDM_T acked = NO;
+	int max_retries = 10;
+
+	while (!acked) {
+
+		char buf[RTNL_RCV_MAX];
+		struct nlmsghdr *nh;
+
+		errno = 0;
+		int status = recv(ip_rth.fd, buf, sizeof(buf), 0);
+
+		if (status < 0 && (errno == EINTR || errno == EWOULDBLOCK || errno == EAGAIN) && max_retries-- > 0) {
+			usleep(500);
+			upd_time(NULL);
+			continue;
+		} else if (status <= 0) {
+			dbgf_sys(DBGT_ERR, "giving up on netlink batch acks status=%d: %s", status, strerror(errno));
+			break;
+		}
+
+		for (nh = (struct nlmsghdr *) buf; NLMSG_OK(nh, (size_t) status); nh = NLMSG_NEXT(nh, status)) {
+
+			if (nh->nlmsg_type != NLMSG_ERROR)
+				continue;
+
+			if (nh->nlmsg_seq == barrier->nlmsg_seq) {
+
+				acked = YES;
+
+			} else if (((struct nlmsgerr*) NLMSG_DATA(nh))->error &&
+				((uint32_t) (nh->nlmsg_seq - firstSeq)) < rtnl_batch.msgs) {
+
+				struct rtnl_batch_msg *bm = &rtnl_batch.msg[nh->nlmsg_seq - firstSeq];
+
+				assertion(-502799, (bm->seq == nh->nlmsg_seq));
+				rtnl_batch.errors++;
+
+				dbgf(bm->quiet ? DBGL_ALL : DBGL_SYS, bm->quiet ? DBGT_INFO : DBGT_ERR, "%s %s net=%s table=%d error=%s",
+					del2str(bm->del), trackt2str(bm->cmd), netAsStr(&bm->k.net), bm->k.table,
+					strerror(-((struct nlmsgerr*) NLMSG_DATA(nh))->error));
+			}
+		}
+	}
+
+	dbgf_track(DBGT_INFO, "sent %d messages with %d bytes in %dus, total flushes=%d msgs=%d errors=%d replaced=%d unchanged=%d",
+		rtnl_batch.msgs, rtnl_batch.len, (int) ((prof_now() - nsStart) / 1000), rtnl_batch.flushes + 1, rtnl_batch.sent + rtnl_batch.msgs,
+		rtnl_batch.errors, rtnl_batch.replaced, rtnl_batch.unchanged);
+
+	rtnl_batch_reset();
+	rtnl_batch.flushes++;
+	ip_rth.busy = 0;
+}
+
+STATIC_FUNC
+void rtnl_batch_add(struct nlmsghdr *nlh, uint16_t cmd, int8_t del, uint8_t quiet, struct track_key *k, struct track_node *nexthop)
+{
+	assertion(-502800, (!ip_rth.busy));
+	assertion(-502801, IMPLIES(nexthop, del));
+
+	if (rtnl_batch.msgs >= netlinkBatch ||
+		rtnl_batch.len + NLMSG_ALIGN(nlh->nlmsg_len) + NLMSG_ALIGN(NLMSG_LENGTH(0)) > sizeof(rtnl_batch.buf))
+		rtnl_batch_flush(NULL);
+
+	struct rtnl_batch_msg *bm = &rtnl_batch.msg[rtnl_batch.msgs];
+
+	nlh->nlmsg_flags &= ~NLM_F_ACK;
+	nlh->nlmsg_pid = My_pid;
+	nlh->nlmsg_seq = ++(ip_rth.seq);
+
+	memcpy(&rtnl_batch.buf[rtnl_batch.len], nlh, nlh->nlmsg_len);
+
+	bm->seq = nlh->nlmsg_seq;
+	bm->offset = rtnl_batch.len;
+	bm->cmd = cmd;
+	bm->del = del;
+	bm->quiet = quiet;
+	bm->k = *k;
+	bm->nexthop = !!nexthop;
+	bm->oif_idx = nexthop ? nexthop->oif_idx : 0;
+	bm->via = nexthop ? nexthop->via : ZERO_IP;
+	bm->src = nexthop ? nexthop->src : ZERO_IP;
+
+	rtnl_batch.len += NLMSG_ALIGN(nlh->nlmsg_len);
+
+	if (!(rtnl_batch.msgs++))
+		task_register(0, rtnl_batch_flush, NULL, -300862);
+
+	if (netlinkBatch == MIN_NETLINK_BATCH)
+		rtnl_batch_flush(NULL);
+}
+
+/*
+ * Called for a route that is about to be added. If the same route is still queued for deletion
+ * (eg due to a next-hop change signalled as route DEL followed by ADD) the deletion is cancelled.
+ * Returns YES if the kernel route already matches the new next hop and nothing needs to be sent,
+ * otherwise NO and *replace tells whether the add must replace the still existing kernel route.
+ */
+STATIC_FUNC
+IDM_T rtnl_batch_cancel_del(struct track_key *k, uint16_t cmd, int oif_idx, IPX_T *via, IPX_T *src, IDM_T *replace)
+{
+	int32_t m;
+
+	*replace = NO;
+
+	for (m = rtnl_batch.msgs - 1; m >= 0; m--) {
+
+		struct rtnl_batch_msg *bm = &rtnl_batch.msg[m];
+
+		if (memcmp(&bm->k, k, sizeof(*k)))
+			continue;
+
+		if (!bm->del || !bm->nexthop || bm->cmd != cmd)
+			return NO;
+
+		((struct nlmsghdr *) &rtnl_batch.buf[bm->offset])->nlmsg_type = NLMSG_NOOP;
+		bm->del = NO;
+
+		if (bm->oif_idx == (uint32_t) oif_idx &&
+			is_ip_equal(&bm->via, via ? via : &ZERO_IP) &&
+			is_ip_equal(&bm->src, src ? src : &ZERO_IP)) {
+
+			rtnl_batch.unchanged++;
+			return YES;
+		}
+
+		rtnl_batch.replaced++;
+		*replace = YES;
+		return NO;
+	}
+
+	return NO;
+}
+
 STATIC_FUNC
 IDM_T rtnl_talk(struct rtnl_handle *iprth, struct nlmsghdr *nlh, uint16_t cmd, uint8_t quiet, void (*func) (struct nlmsghdr *nh, void *data), void *data)
 {
 
 	// DONT USE setNet() here (because return pointer is static)!!!!!!!!!!!!!
 
+	rtnl_batch_flush(NULL);
+
 	assertion(-501494, (!iprth->busy));
 	iprth->busy = 1;
 
@@ -643,6 +860,7 @@ IDM_T kernel_get_if_config_post(IDM_T purge_all, uint16_t curr_sqn)
 			} else {
 
 				changed += ian->changed;
+				ian->changed = 0; // consumed, incremental interface events do not reparse all addresses
 
 				addr_changed = YES;
 
@@ -674,6 +892,7 @@ IDM_T kernel_get_if_config_post(IDM_T purge_all, uint16_t curr_sqn)
 			dbgf(dbgl, DBGT_WARN, "link=%s dev=%s iln_changed=%d configuration CHANGED",
 				iln->name.str, dev ? dev->ifname_label.str : "ERROR", iln->changed);
 
+			iln->changed = 0;
 		}
 	}
 
@@ -686,6 +905,12 @@ IDM_T kernel_get_if_config_post(IDM_T purge_all, uint16_t curr_sqn)
 	}
 }
 
+static uint16_t if_config_sqn = 0;
+static IDM_T if_config_dumping = NO;
+static IDM_T if_config_resync = NO;
+
+struct if_event_stats if_event_stats;
+
 STATIC_FUNC
 void kernel_get_if_addr_config(struct nlmsghdr *nh, void *index_sqnp)
 {
@@ -701,7 +926,7 @@ void kernel_get_if_addr_config(struct nlmsghdr *nh, void *index_sqnp)
 	if (family != AF_INET && family != AF_INET6)
 		return;
 
-	if (nh->nlmsg_type != RTM_NEWADDR)
+	if (nh->nlmsg_type != RTM_NEWADDR && nh->nlmsg_type != RTM_DELADDR)
 		return;
 
 	assertion(-501496, (nh->nlmsg_len >= (int) NLMSG_LENGTH(sizeof(*if_addr))));
@@ -734,11 +959,20 @@ void kernel_get_if_addr_config(struct nlmsghdr *nh, void *index_sqnp)
 	struct if_addr_node *new_ian = NULL;
 	struct if_addr_node *old_ian = avl_find_item(&iln->if_addr_tree, &ip_addr);
 
+	if (nh->nlmsg_type == RTM_DELADDR) {
+
+		// let kernel_get_if_config_post() remove it:
+		if (old_ian)
+			old_ian->update_sqn = index_sqn - 1;
+
+		return;
+	}
+
 	if (old_ian) {
 
 		old_ian->changed = 0;
 
-		if (old_ian->update_sqn == index_sqn) {
+		if (old_ian->update_sqn == index_sqn && if_config_dumping) {
 			dbgf_sys(DBGT_ERR,
 				"ifi %d addr %s found several times!",
 				iln->index, ipXAsStr(old_ian->ifa.ifa_family, &ip_addr));
@@ -884,11 +1118,22 @@ void kernel_get_if_link_config(struct nlmsghdr *nh, void *update_sqnp)
 
 	uint16_t changed = 0;
 
-	if (nh->nlmsg_type != RTM_NEWLINK)
+	if (nh->nlmsg_type != RTM_NEWLINK && nh->nlmsg_type != RTM_DELLINK)
 		return;
 
 	assertion(-501497, (nh->nlmsg_len >= NLMSG_LENGTH(sizeof(*if_link_info))));
 
+	if (nh->nlmsg_type == RTM_DELLINK) {
+
+		struct if_link_node *del_ilx = avl_find_item(&if_link_tree, &if_link_info->ifi_index);
+
+		// let kernel_get_if_config_post() remove it and its addresses:
+		if (del_ilx)
+			del_ilx->update_sqn = update_sqn - 1;
+
+		return;
+	}
+
 	parse_rtattr(tb, IFLA_MAX, IFLA_RTA(if_link_info), IFLA_PAYLOAD(nh));
 
 	if (!tb[IFLA_IFNAME])
@@ -900,7 +1145,7 @@ void kernel_get_if_link_config(struct nlmsghdr *nh, void *update_sqnp)
 
 	if (old_ilx) {
 
-		if (old_ilx->update_sqn == update_sqn) {
+		if (old_ilx->update_sqn == update_sqn && if_config_dumping) {
 			dbgf_sys(DBGT_ERR, "ifi %d found several times!", old_ilx->index);
 		}
 
@@ -974,6 +1219,10 @@ void kernel_get_if_link_config(struct nlmsghdr *nh, void *update_sqnp)
 
 		struct if_addr_node *old_ian;
 
+		// addresses are only re-learned by a full address dump:
+		if (!if_config_dumping && old_ilx->if_addr_tree.items)
+			if_config_resync = YES;
+
 		while ((old_ian = avl_first_item(&old_ilx->if_addr_tree))) {
 
 			if (old_ian->dev) {
@@ -994,11 +1243,13 @@ void kernel_get_if_link_config(struct nlmsghdr *nh, void *update_sqnp)
 
 static IDM_T kernel_get_if_config(void)
 {
-	static uint16_t index_sqn = 0;
 	int ai;
 
-	index_sqn++;
-	dbgf_all(DBGT_INFO, "%d", index_sqn);
+	if_config_sqn++;
+	if_config_dumping = YES;
+	if_config_resync = NO;
+	if_event_stats.dumps++;
+	dbgf_all(DBGT_INFO, "%d", if_config_sqn);
 
 #define LINK_INFO 0
 #define ADDR_INFO 1
@@ -1018,10 +1269,12 @@ static IDM_T kernel_get_if_config(void)
 		req.rtg.rtgen_family = AF_UNSPEC;
 
 		rtnl_talk(&ip_rth, &req.nlh, (ai ? IP_ADDR_GET : IP_LINK_GET), NO,
-			(ai ? kernel_get_if_addr_config : kernel_get_if_link_config), &index_sqn);
+			(ai ? kernel_get_if_addr_config : kernel_get_if_link_config), &if_config_sqn);
 	}
 
-	return kernel_get_if_config_post(NO, index_sqn);
+	if_config_dumping = NO;
+
+	return kernel_get_if_config_post(NO, if_config_sqn);
 }
 
 IDM_T kernel_set_addr(IDM_T del, uint32_t if_index, uint8_t family, IPX_T *ipX, uint8_t prefixlen, IDM_T deprecated)
@@ -1156,6 +1409,7 @@ void kernel_dev_tun_del(char *name, int32_t fd)
 	}
 	assertion(-501498, (initializing || tn));
 
+	rtnl_batch_flush(NULL);
 
 	if (DEF_TUN_OUT_PERSIST && ioctl(fd, TUNSETPERSIST, 0) < 0) {
 
@@ -1263,6 +1517,7 @@ IDM_T kernel_tun_del(char *name)
 
 	assertion(-501526, (name && strlen(name)));
 
+	rtnl_batch_flush(NULL);
 
 	memset(&req, 0, sizeof(req));
 	strncpy(req.ifr_name, name, IFNAMSIZ);
@@ -1493,9 +1748,9 @@ int proc_get_dev_fields(char *bp, struct user_net_device_stats *stats, int procn
 	return 0;
 }
 
-IDM_T kernel_get_ifstats(struct user_net_device_stats *stats, char *target)
+STATIC_FUNC
+IDM_T kernel_get_ifstats_proc(struct user_net_device_stats *stats, char *target)
 {
-	assertion(-502334, (stats && target));
 
 	FILE *fh;
 	char buf[512];
@@ -1540,6 +1795,140 @@ IDM_T kernel_get_ifstats(struct user_net_device_stats *stats, char *target)
 	return ret;
 }
 
+/*
+ * Interface counters are fetched in binary form via RTM_GETSTATS (IFLA_STATS_LINK_64).
+ * A full dump refreshes the counters of all interfaces at once and is reused for
+ * IF_STATS_CACHE_PERIOD. Interfaces unknown to the current dump (e.g. freshly created
+ * tunnels) are fetched individually. Kernels without RTM_GETSTATS (< 4.7) fall back
+ * to parsing /proc/net/dev.
+ */
+struct if_stats_node {
+	int32_t index;
+	TIME_T stamp;
+	struct user_net_device_stats stats;
+};
+
+static AVL_TREE(if_stats_tree, struct if_stats_node, index);
+static TIME_T if_stats_stamp = 0;
+static IDM_T if_stats_netlink = YES;
+
+STATIC_FUNC
+void kernel_ifstats_update(struct nlmsghdr *nh, void *unused)
+{
+	struct if_stats_msg *ifsm = NLMSG_DATA(nh);
+	struct rtattr *tb[IFLA_STATS_MAX + 1];
+	struct rtnl_link_stats64 s64;
+	struct if_stats_node *isn;
+
+	if (nh->nlmsg_type != RTM_NEWSTATS || nh->nlmsg_len < NLMSG_LENGTH(sizeof(*ifsm)) || ifsm->ifindex <= 0)
+		return;
+
+	parse_rtattr(tb, IFLA_STATS_MAX, (struct rtattr *) (((char*) ifsm) + NLMSG_ALIGN(sizeof(*ifsm))), nh->nlmsg_len - NLMSG_LENGTH(sizeof(*ifsm)));
+
+	if (!tb[IFLA_STATS_LINK_64] || RTA_PAYLOAD(tb[IFLA_STATS_LINK_64]) < sizeof(s64))
+		return;
+
+	// rtattr payload is only 4-byte aligned:
+	memcpy(&s64, RTA_DATA(tb[IFLA_STATS_LINK_64]), sizeof(s64));
+
+	int32_t index = ifsm->ifindex;
+
+	if (!(isn = avl_find_item(&if_stats_tree, &index))) {
+		isn = debugMallocReset(sizeof(struct if_stats_node), -300863);
+		isn->index = index;
+		avl_insert(&if_stats_tree, isn, -300864);
+	}
+
+	isn->stamp = bmx_time;
+	isn->stats.rx_packets = s64.rx_packets;
+	isn->stats.tx_packets = s64.tx_packets;
+}
+
+STATIC_FUNC
+IDM_T kernel_ifstats_request(int32_t ifindex)
+{
+	struct {
+		struct nlmsghdr nlh;
+		struct if_stats_msg ifsm;
+	} req;
+
+	memset(&req, 0, sizeof(req));
+	req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct if_stats_msg));
+	req.nlh.nlmsg_flags = NLM_F_REQUEST | (ifindex ? 0 : NLM_F_DUMP);
+	req.nlh.nlmsg_type = RTM_GETSTATS;
+	req.ifsm.family = AF_UNSPEC;
+	req.ifsm.ifindex = ifindex;
+	req.ifsm.filter_mask = IFLA_STATS_FILTER_BIT(IFLA_STATS_LINK_64);
+
+	return rtnl_talk(&ip_rth2, &req.nlh, IP_STATS_GET, YES, kernel_ifstats_update, NULL);
+}
+
+STATIC_FUNC
+IDM_T kernel_ifstats_dump(void)
+{
+	struct if_stats_node *isn;
+	int32_t index = 0;
+
+	if (kernel_ifstats_request(0) != SUCCESS)
+		return FAILURE;
+
+	if_stats_stamp = bmx_time;
+
+	while ((isn = avl_next_item(&if_stats_tree, &index))) {
+
+		index = isn->index;
+
+		if (isn->stamp != bmx_time) {
+			avl_remove(&if_stats_tree, &isn->index, -300865);
+			debugFree(isn, -300866);
+		}
+	}
+
+	return SUCCESS;
+}
+
+STATIC_FUNC
+void kernel_ifstats_flush(void)
+{
+	struct if_stats_node *isn;
+
+	while ((isn = avl_remove_first_item(&if_stats_tree, -300867)))
+		debugFree(isn, -300868);
+}
+
+// index is the caller's known ifindex of target, target is only needed for the /proc fallback
+IDM_T kernel_get_ifstats(struct user_net_device_stats *stats, int32_t index, char *target)
+{
+	assertion(-502334, (stats && target));
+
+	struct if_stats_node *isn = NULL;
+
+	if (if_stats_netlink && index > 0) {
+
+		if (!if_stats_tree.items || ((TIME_T) (bmx_time - if_stats_stamp)) >= IF_STATS_CACHE_PERIOD) {
+
+			if (kernel_ifstats_dump() != SUCCESS) {
+				dbgf_sys(DBGT_WARN, "RTM_GETSTATS not supported by kernel, falling back to %s", IFCONFIG_PATH_PROCNET_DEV);
+				kernel_ifstats_flush();
+				if_stats_netlink = NO;
+			}
+		}
+
+		if (if_stats_netlink && !(isn = avl_find_item(&if_stats_tree, &index)) && kernel_ifstats_request(index) == SUCCESS)
+			isn = avl_find_item(&if_stats_tree, &index);
+	}
+
+	if (!isn)
+		return kernel_get_ifstats_proc(stats, target);
+
+	dbgf_all(DBGT_INFO, "%s prev: rx=%llu tx=%llu  curr: rx=%llu tx=%llu", target,
+		stats->rx_packets, stats->tx_packets, isn->stats.rx_packets, isn->stats.tx_packets);
+
+	*stats = isn->stats;
+
+	return SUCCESS;
+}
+
 IDM_T kernel_get_route(uint8_t quiet, uint8_t family, uint16_t type, uint32_t table, void (*func) (struct nlmsghdr *nh, void *data))
 {
 	struct rtmsg_req req;
@@ -1558,72 +1947,70 @@ IDM_T kernel_get_route(uint8_t quiet, uint8_t family, uint16_t type, uint32_t ta
 }
 
 STATIC_FUNC
-IDM_T kernel_set_route(uint16_t cmd, int8_t del, uint8_t quiet, const struct net_key *dst,
+void kernel_route_req(struct rtmsg_req *req, uint16_t cmd, int8_t del, const struct net_key *dst,
 	uint32_t table, uint32_t prio, int oif_idx, IPX_T *via, IPX_T *src, uint32_t metric)
 {
-
 	dbgf_all(DBGT_INFO, "1");
 
-	struct rtmsg_req req;
 	IDM_T llocal = (via && is_ip_equal(via, &dst->ip)) ? YES : NO;
 
-	memset(&req, 0, sizeof(req));
+	memset(req, 0, sizeof(*req));
 
-	req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+	req->nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
 
-	req.rtm.rtm_family = dst->af;
-	req.rtm.rtm_table = table;
+	req->rtm.rtm_family = dst->af;
+	req->rtm.rtm_table = table;
 
-	req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
+	req->nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK;
 
 	if (cmd > IP_ROUTES && cmd < IP_ROUTE_MAX) {
 
 		if (del) {
-			req.nlh.nlmsg_type = RTM_DELROUTE;
-			req.rtm.rtm_scope = RT_SCOPE_NOWHERE;
+			req->nlh.nlmsg_type = RTM_DELROUTE;
+			req->rtm.rtm_scope = RT_SCOPE_NOWHERE;
 		} else {
-			req.nlh.nlmsg_flags = req.nlh.nlmsg_flags | NLM_F_CREATE | NLM_F_EXCL; //| NLM_F_REPLACE;
-			req.nlh.nlmsg_type = RTM_NEWROUTE;
-			req.rtm.rtm_scope = ((cmd == IP_ROUTE_HNA || cmd == IP_ROUTE_HOST) && llocal) ? RT_SCOPE_LINK : RT_SCOPE_UNIVERSE;
-			req.rtm.rtm_protocol = RTPROT_STATIC;
-			req.rtm.rtm_type = (cmd == IP_THROW_MY_HNA || cmd == IP_THROW_MY_NET || cmd == IP_THROW_MY_TUNS) ? RTN_THROW : RTN_UNICAST;
+			req->nlh.nlmsg_flags = req->nlh.nlmsg_flags | NLM_F_CREATE | NLM_F_EXCL; //| NLM_F_REPLACE;
+			req->nlh.nlmsg_type = RTM_NEWROUTE;
+			req->rtm.rtm_scope = ((cmd == IP_ROUTE_HNA || cmd == IP_ROUTE_HOST) && llocal) ? RT_SCOPE_LINK : RT_SCOPE_UNIVERSE;
+			req->rtm.rtm_protocol = RTPROT_STATIC;
+			req->rtm.rtm_type = (cmd == IP_THROW_MY_HNA || cmd == IP_THROW_MY_NET || cmd == IP_THROW_MY_TUNS) ? RTN_THROW : RTN_UNICAST;
 		}
 
 		if (is_ip_set(&dst->ip)) {
-			req.rtm.rtm_dst_len = dst->mask;
-			add_rtattr(&req.nlh, RTA_DST, (char*) &dst->ip, sizeof(IPX_T), dst->af);
+			req->rtm.rtm_dst_len = dst->mask;
+			add_rtattr(&req->nlh, RTA_DST, (char*) &dst->ip, sizeof(IPX_T), dst->af);
 		}
 
 		if (via && !llocal)
-			add_rtattr(&req.nlh, RTA_GATEWAY, (char*) via, sizeof(IPX_T), dst->af);
+			add_rtattr(&req->nlh, RTA_GATEWAY, (char*) via, sizeof(IPX_T), dst->af);
 
 		if (oif_idx)
-			add_rtattr(&req.nlh, RTA_OIF, (char*) & oif_idx, sizeof(oif_idx), 0);
+			add_rtattr(&req->nlh, RTA_OIF, (char*) & oif_idx, sizeof(oif_idx), 0);
 
 		if (src)
-			add_rtattr(&req.nlh, RTA_PREFSRC, (char*) src, sizeof(IPX_T), dst->af);
+			add_rtattr(&req->nlh, RTA_PREFSRC, (char*) src, sizeof(IPX_T), dst->af);
 
 		if (cmd > IP_ROUTE_TUNS)
-			req.rtm.rtm_protocol = (cmd - IP_ROUTE_TUNS);
+			req->rtm.rtm_protocol = (cmd - IP_ROUTE_TUNS);
 
 
 
 	} else if (cmd > IP_RULES && cmd < IP_RULE_MAX) {
 
 		if (del) {
-			req.nlh.nlmsg_type = RTM_DELRULE;
-			req.rtm.rtm_scope = RT_SCOPE_NOWHERE;
+			req->nlh.nlmsg_type = RTM_DELRULE;
+			req->rtm.rtm_scope = RT_SCOPE_NOWHERE;
 		} else {
-			req.nlh.nlmsg_flags = req.nlh.nlmsg_flags | NLM_F_CREATE | NLM_F_EXCL;
-			req.nlh.nlmsg_type = RTM_NEWRULE;
-			req.rtm.rtm_scope = RT_SCOPE_UNIVERSE;
-			req.rtm.rtm_protocol = RTPROT_STATIC;
-			req.rtm.rtm_type = RTN_UNICAST;
+			req->nlh.nlmsg_flags = req->nlh.nlmsg_flags | NLM_F_CREATE | NLM_F_EXCL;
+			req->nlh.nlmsg_type = RTM_NEWRULE;
+			req->rtm.rtm_scope = RT_SCOPE_UNIVERSE;
+			req->rtm.rtm_protocol = RTPROT_STATIC;
+			req->rtm.rtm_type = RTN_UNICAST;
 		}
 
 		if (is_ip_set(&dst->ip)) {
-			req.rtm.rtm_src_len = dst->mask;
-			add_rtattr(&req.nlh, RTA_SRC, (char*) &dst->ip, sizeof(IPX_T), dst->af);
+			req->rtm.rtm_src_len = dst->mask;
+			add_rtattr(&req->nlh, RTA_SRC, (char*) &dst->ip, sizeof(IPX_T), dst->af);
 		}
 
 	} else {
@@ -1633,10 +2020,19 @@ IDM_T kernel_set_route(uint16_t cmd, int8_t del, uint8_t quiet, const struct net
 
 
 	if (prio)
-		add_rtattr(&req.nlh, RTA_PRIORITY, (char*) & prio, sizeof(prio), 0);
+		add_rtattr(&req->nlh, RTA_PRIORITY, (char*) & prio, sizeof(prio), 0);
 
 	if (metric)
-		add_rtattr(&req.nlh, RTA_PRIORITY, (char*) & metric, sizeof(metric), 0);
+		add_rtattr(&req->nlh, RTA_PRIORITY, (char*) & metric, sizeof(metric), 0);
+}
+
+STATIC_FUNC
+IDM_T kernel_set_route(uint16_t cmd, int8_t del, uint8_t quiet, const struct net_key *dst,
+	uint32_t table, uint32_t prio, int oif_idx, IPX_T *via, IPX_T *src, uint32_t metric)
+{
+	struct rtmsg_req req;
+
+	kernel_route_req(&req, cmd, del, dst, table, prio, oif_idx, via, src, metric);
 
 	return rtnl_talk(&ip_rth, &req.nlh, cmd, quiet, NULL, NULL);
 }
@@ -1684,9 +2080,39 @@ void set_ipexport(void (*func) (int8_t del, const struct net_key *dst, uint32_t
 	}
 }
 
+STATIC_FUNC
+void rule_track_update(struct track_key *tk, int8_t del)
+{
+	struct rule_track_key rk = { .table = tk->table, .prio = tk->prio, .af = tk->net.af };
+	struct rule_track_node *rn = avl_find_item(&rule_track_tree, &rk);
+
+	assertion(-502802, IMPLIES(del, rn && rn->items));
+
+	if (del) {
+
+		if (--(rn->items))
+			return;
+
+		avl_remove(&rule_track_tree, &rk, -300870);
+		debugFree(rn, -300871);
+
+	} else {
+
+		if (!rn) {
+			rn = debugMallocReset(sizeof(struct rule_track_node), -300872);
+			rn->k = rk;
+			rn->net = tk->net;
+			rn->metric = tk->metric;
+			avl_insert(&rule_track_tree, rn, -300873);
+		}
+
+		rn->items++;
+	}
+}
+
 STATIC_FUNC
 IDM_T iptrack(const struct net_key *net, uint16_t cmd, uint8_t quiet, int8_t del, uint32_t table, uint32_t prio,
-	int oif_idx, IPX_T *via, IPX_T *src, uint32_t metric, struct route_export *rte)
+	int oif_idx, IPX_T *via, IPX_T *src, uint32_t metric, struct route_export *rte, struct track_node *removed)
 {
 
 	// DONT USE setNet() here (because return pointer is static)!!!!!!!!!!!!!
@@ -1746,6 +2172,9 @@ IDM_T iptrack(const struct net_key *net, uint16_t cmd, uint8_t quiet, int8_t del
 
 		} else if (exact->items == 1) {
 
+			if (removed)
+				*removed = *exact;
+
 			struct track_node *rem_tn = avl_remove(&iptrack_tree, &exact->k, -300250);
 			assertion(-501233, (rem_tn));
 			//assertion(-500882, (rem_tn == first_tn));
@@ -1762,6 +2191,9 @@ IDM_T iptrack(const struct net_key *net, uint16_t cmd, uint8_t quiet, int8_t del
 			exact->items--;
 		}
 
+		if (cmd == IP_RULE_DEFAULT)
+			rule_track_update(&ts.k, DEL);
+
 		if (found != 1)
 			return NO;
 
@@ -1781,7 +2213,7 @@ IDM_T iptrack(const struct net_key *net, uint16_t cmd, uint8_t quiet, int8_t del
 			tn->rt_exp.exportDistance = rte ? rte->exportDistance : TYP_EXPORT_DISTANCE_INFINITE;
 			tn->rt_exp.ipexport = rte ? rte->ipexport : 0;
 
-			if (cmd >= IP_ROUTE_TUNS && cmd < IP_ROUTE_MAX) {
+			if (ts.k.cmd_type == IP_ROUTES) {
 				tn->oif_idx = oif_idx;
 				tn->src = src ? *src : ZERO_IP;
 				tn->via = via ? *via : ZERO_IP;
@@ -1790,6 +2222,9 @@ IDM_T iptrack(const struct net_key *net, uint16_t cmd, uint8_t quiet, int8_t del
 			avl_insert(&iptrack_tree, tn, -300251);
 		}
 
+		if (cmd == IP_RULE_DEFAULT)
+			rule_track_update(&ts.k, ADD);
+
 		if (found > 0)
 			return NO;
 
@@ -1829,7 +2264,17 @@ IDM_T iproute(uint16_t cmd, int8_t del, uint8_t quiet, const struct net_key *dst
 		return SUCCESS;
 
 
-	if (iptrack(dst, cmd, quiet, del, table, prio, oif_idx, via, src, metric, rte) == NO)
+	struct track_node removed;
+	struct track_key k;
+	memset(&removed, 0, sizeof(removed));
+	memset(&k, 0, sizeof(k));
+	k.net = *dst;
+	k.prio = prio;
+	k.table = table;
+	k.metric = metric;
+	k.cmd_type = (cmd > IP_ROUTES && cmd < IP_ROUTE_MAX) ? IP_ROUTES : IP_RULES;
+
+	if (iptrack(dst, cmd, quiet, del, table, prio, oif_idx, via, src, metric, rte, &removed) == NO)
 		return SUCCESS;
 
 #ifdef DEBUG_ALL
@@ -1844,8 +2289,22 @@ IDM_T iproute(uint16_t cmd, int8_t del, uint8_t quiet, const struct net_key *dst
 	if (rte && rte->ipexport)
 		(*ipexport)(del, dst, oif_idx, via, metric, rte->exportDistance);
 
-	if (!rte || !rte->ipexport || !rte->exportOnly)
-		return kernel_set_route(cmd, del, quiet, dst, table, prio, oif_idx, via, src, metric);
+	if (!rte || !rte->ipexport || !rte->exportOnly) {
+
+		struct rtmsg_req req;
+		IDM_T isRoute = (k.cmd_type == IP_ROUTES);
+		IDM_T replace = NO;
+
+		if (!del && isRoute && rtnl_batch_cancel_del(&k, cmd, oif_idx, via, src, &replace) == YES)
+			return SUCCESS;
+
+		kernel_route_req(&req, cmd, del, dst, table, prio, oif_idx, via, src, metric);
+
+		if (replace)
+			req.nlh.nlmsg_flags = (req.nlh.nlmsg_flags & ~NLM_F_EXCL) | NLM_F_REPLACE;
+
+		rtnl_batch_add(&req.nlh, cmd, del, quiet, &k, (del && isRoute) ? &removed : NULL);
+	}
 
 	return SUCCESS;
 }
@@ -1893,6 +2352,99 @@ IDM_T check_proc_sys_net(char *file, int32_t desired, IDM_T force)
 }
 
 
+/*
+ * Instead of polling /proc every second, forwarding and rp_filter settings are learned from
+ * an RTM_GETNETCONF dump and RTNLGRP_IPV4/6_NETCONF notifications. /proc is only touched
+ * for values that need correction and for send_redirects (which is not reported via netconf).
+ * Without netconf support (nl_netconf_sk == 0) the original polling is used.
+ */
+static int nl_netconf_sk = 0;
+static IDM_T netconf_resync = YES;
+
+STATIC_FUNC
+void sysctl_netconf_check(struct nlmsghdr *nh, void *unused)
+{
+	struct netconfmsg *ncm = NLMSG_DATA(nh);
+	struct rtattr *tb[NETCONFA_MAX + 1];
+	char filename[100];
+
+	if (nh->nlmsg_type != RTM_NEWNETCONF || nh->nlmsg_len < NLMSG_LENGTH(sizeof(*ncm)))
+		return;
+
+	parse_rtattr(tb, NETCONFA_MAX, (struct rtattr *) (((char*) ncm) + NLMSG_ALIGN(sizeof(*ncm))), nh->nlmsg_len - NLMSG_LENGTH(sizeof(*ncm)));
+
+	if (!tb[NETCONFA_IFINDEX])
+		return;
+
+	int32_t ifindex = *((int32_t*) RTA_DATA(tb[NETCONFA_IFINDEX]));
+
+	dbgf_all(DBGT_INFO, "family=%d ifindex=%d forwarding=%d rp_filter=%d", ncm->ncm_family, ifindex,
+		tb[NETCONFA_FORWARDING] ? *((int32_t*) RTA_DATA(tb[NETCONFA_FORWARDING])) : -1,
+		tb[NETCONFA_RP_FILTER] ? *((int32_t*) RTA_DATA(tb[NETCONFA_RP_FILTER])) : -1);
+
+	if (ifindex == NETCONFA_IFINDEX_ALL && tb[NETCONFA_FORWARDING]) {
+
+		int32_t forwarding = *((int32_t*) RTA_DATA(tb[NETCONFA_FORWARDING]));
+
+		if (ncm->ncm_family == AF_INET6 && forwarding != SYSCTL_IP6_FORWARD)
+			check_proc_sys_net("ipv6/conf/all/forwarding", SYSCTL_IP6_FORWARD, NO);
+		else if (ncm->ncm_family == AF_INET && forwarding != SYSCTL_IP4_FORWARD)
+			check_proc_sys_net("ipv4/ip_forward", SYSCTL_IP4_FORWARD, NO);
+
+	} else if (ifindex > 0 && ncm->ncm_family == AF_INET && tb[NETCONFA_RP_FILTER] &&
+		*((int32_t*) RTA_DATA(tb[NETCONFA_RP_FILTER])) != SYSCTL_IP4_RP_FILTER) {
+
+		struct avl_node *an = NULL;
+		struct dev_node *dev;
+
+		while ((dev = avl_iterate_item(&dev_name_tree, &an))) {
+
+			if (dev->active && dev->if_llocal_addr && dev->if_llocal_addr->iln->index == ifindex) {
+				sprintf(filename, "ipv4/conf/%s/rp_filter", dev->ifname_device.str);
+				check_proc_sys_net(filename, SYSCTL_IP4_RP_FILTER, NO);
+			}
+		}
+	}
+}
+
+STATIC_FUNC
+void recv_netconf_netlink_sk(int sk)
+{
+	dbgf_track(DBGT_INFO, "detected changed netconf! Going to check...");
+
+	if (rtnl_rcv(sk, 0, 0, IP_NETCONF_GET, NO, autoSysctl ? sysctl_netconf_check : NULL, NULL) != SUCCESS) {
+		dbgf_sys(DBGT_WARN, "lost netconf events, resyncing");
+		netconf_resync = YES;
+	}
+}
+
+STATIC_FUNC
+IDM_T sysctl_netconf_dump(void)
+{
+	uint8_t families[] = {AF_INET, AF_INET6};
+	uint8_t f;
+
+	for (f = 0; f < sizeof(families); f++) {
+
+		struct {
+			struct nlmsghdr nlh;
+			struct netconfmsg ncm;
+			char buf[RT_REQ_BUFFSIZE];
+		} req;
+
+		memset(&req, 0, sizeof(req));
+		req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct netconfmsg));
+		req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+		req.nlh.nlmsg_type = RTM_GETNETCONF;
+		req.ncm.ncm_family = families[f];
+
+		if (rtnl_talk(&ip_rth2, &req.nlh, IP_NETCONF_GET, YES, sysctl_netconf_check, NULL) != SUCCESS)
+			return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
 // TODO: check for further traps: http://lwn.net/Articles/45386/
 
 void sysctl_config(struct dev_node *onlyDev)
@@ -1902,6 +2454,34 @@ void sysctl_config(struct dev_node *onlyDev)
 	struct avl_node *an;
 	struct dev_node *dev;
 
+	if (!onlyDev && nl_netconf_sk > 0) {
+
+		if (!autoSysctl || !netconf_resync) {
+
+			netconf_resync |= !autoSysctl;
+			return;
+		}
+
+		if (sysctl_netconf_dump() == SUCCESS) {
+
+			netconf_resync = NO;
+
+			for (an = NULL; (dev = avl_iterate_item(&dev_name_tree, &an));) {
+
+				if ((dev->active && dev->if_llocal_addr && dev->if_llocal_addr->iln->flags & IFF_UP)) {
+					sprintf(filename, "ipv4/conf/%s/send_redirects", dev->ifname_device.str);
+					check_proc_sys_net(filename, SYSCTL_IP4_SEND_REDIRECT, NO);
+				}
+			}
+
+			return;
+		}
+
+		dbgf_sys(DBGT_WARN, "netconf not supported by kernel, falling back to polling /proc/sys/net");
+		unregister_netlink_event_hook(nl_netconf_sk, recv_netconf_netlink_sk);
+		nl_netconf_sk = 0;
+	}
+
 	if (onlyDev || autoSysctl) {
 
 		if (checkstamp != bmx_time) {
@@ -1920,7 +2500,7 @@ void sysctl_config(struct dev_node *onlyDev)
 
 		for (an = NULL; (dev = onlyDev ? onlyDev : avl_iterate_item(&dev_name_tree, &an));) {
 
-			if ((dev->active && dev->if_llocal_addr && dev->if_llocal_addr->iln->flags && IFF_UP)) {
+			if ((dev->active && dev->if_llocal_addr && dev->if_llocal_addr->iln->flags & IFF_UP)) {
 
 				sprintf(filename, "ipv4/conf/%s/rp_filter", dev->ifname_device.str);
 				check_proc_sys_net(filename, SYSCTL_IP4_RP_FILTER, NO);
@@ -1976,6 +2556,8 @@ void dev_reconfigure_soft(struct dev_node *dev)
 		}
 	}
 
+	neighs_linkMetrics_changed(NULL);
+
 	if (dev->channel_conf != OPT_CHILD_UNDEFINED) {
 		dev->channel = dev->channel_conf;
 	} else {
@@ -2717,7 +3299,7 @@ static void dev_check(void *kernel_ip_config_changed)
 
 static void recv_ifevent_netlink_sk(int sk)
 {
-	char buf[4096]; //test this with a very small value !!
+	char buf[RTNL_RCV_MAX];
 	struct sockaddr_nl sa;
 	struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) };
 
@@ -2731,17 +3313,59 @@ static void recv_ifevent_netlink_sk(int sk)
 	msg.msg_iovlen = 1; /* Number of elements in the vector.  */
 
 	int rcvd;
+	IDM_T resync = (if_config_sqn == 0);
+	IDM_T applied = NO;
 
-	//so fare I just want to consume the pending message...
+	// apply link and address events incrementally, fall back to a full dump if events were lost:
 	while ((rcvd = recvmsg(sk, &msg, 0)) > 0) {
+
+		struct nlmsghdr *nh;
+
 		dbgf_track(DBGT_INFO, "rcvd %d bytes", rcvd);
 
+		if (msg.msg_flags & MSG_TRUNC)
+			resync = YES;
+
+		for (nh = (struct nlmsghdr *) buf; !resync && NLMSG_OK(nh, (size_t) rcvd); nh = NLMSG_NEXT(nh, rcvd)) {
+
+			if_event_stats.events++;
+
+			if ((nh->nlmsg_type == RTM_NEWLINK || nh->nlmsg_type == RTM_DELLINK) &&
+				nh->nlmsg_len >= NLMSG_LENGTH(sizeof(struct ifinfomsg)) &&
+				((struct ifinfomsg*) NLMSG_DATA(nh))->ifi_family == AF_UNSPEC) {
+
+				kernel_get_if_link_config(nh, &if_config_sqn);
+				applied = YES;
+
+			} else if ((nh->nlmsg_type == RTM_NEWADDR || nh->nlmsg_type == RTM_DELADDR) &&
+				nh->nlmsg_len >= NLMSG_LENGTH(sizeof(struct ifaddrmsg))) {
+
+				kernel_get_if_addr_config(nh, &if_config_sqn);
+				applied = YES;
+
+			} else {
+				// eg. RTMGRP_IPV6_IFINFO or RTMGRP_IPV6_PREFIX notifications
+				if_event_stats.ignored++;
+			}
+		}
+	}
+
+	if (rcvd < 0 && errno == ENOBUFS) {
+		dbgf_sys(DBGT_WARN, "interface event overrun! Going to resync all interfaces");
+		resync = YES;
 	}
 
 	//do NOT delay checking of interfaces to not miss ifdown/up of interfaces !!
-	if (kernel_get_if_config() == YES) //just call if changed!
-		dev_check((void*) &CONST_YES);
+	if (resync || if_config_resync) {
+
+		if (kernel_get_if_config() == YES) //just call if changed!
+			dev_check((void*) &CONST_YES);
 
+	} else if (applied) {
+
+		if (kernel_get_if_config_post(NO, if_config_sqn) == YES)
+			dev_check((void*) &CONST_YES);
+	}
 }
 
 static int open_ifevent_netlink_sk(void)
@@ -2854,6 +3478,114 @@ int unregister_netlink_event_hook(int rtevent_sk, void (*cb_fd_handler) (int32_t
 	return 0;
 }
 
+#ifndef SOL_NETLINK
+#define SOL_NETLINK 270
+#endif
+#ifndef NETLINK_GET_STRICT_CHK
+#define NETLINK_GET_STRICT_CHK 12
+#endif
+
+/*
+ * Non-blocking socket for dumps that are consumed from the event loop via
+ * rtnl_rcv_stream(). Kernels supporting strict checking (>= 4.20) then also apply
+ * the filters (e.g. RTA_TABLE) given in dump requests.
+ */
+int register_netlink_dump_hook(int buffsize, void (*cb_fd_handler) (int32_t fd))
+{
+	int sk = register_netlink_event_hook(0, buffsize, cb_fd_handler);
+	int one = 1;
+
+	if (sk > 0 && setsockopt(sk, SOL_NETLINK, NETLINK_GET_STRICT_CHK, &one, sizeof(one)) < 0) {
+		dbgf_track(DBGT_WARN, "no netlink strict checking (%s), dump consumers must filter by table", strerror(errno));
+	}
+
+	return sk;
+}
+
+IDM_T kernel_dump_route_request(int fd, uint8_t family, uint32_t table)
+{
+	struct rtmsg_req req;
+	struct sockaddr_nl nladdr = { .nl_family = AF_NETLINK };
+
+	memset(&req, 0, sizeof(req));
+
+	req.nlh.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+	req.nlh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.nlh.nlmsg_type = RTM_GETROUTE;
+	req.rtm.rtm_family = family;
+	req.rtm.rtm_table = (table & ~0xFF) ? RT_TABLE_COMPAT : table;
+
+	if (table)
+		add_rtattr(&req.nlh, RTA_TABLE, (char*) &table, sizeof(table), 0);
+
+	if (sendto(fd, &req, req.nlh.nlmsg_len, 0, (struct sockaddr *) &nladdr, sizeof(nladdr)) < 0) {
+		dbgf_sys(DBGT_ERR, "can't send netlink dump request family=%d table=%d: %s", family, table, strerror(errno));
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
+/*
+ * Processes at most budget buffers from a non-blocking netlink socket and leaves
+ * the rest for the next event-loop iteration.
+ */
+int rtnl_rcv_stream(int fd, uint32_t budget, void (*func) (struct nlmsghdr *nh, void *data), void *data)
+{
+	while (budget--) {
+
+		char buf[RTNL_RCV_MAX];
+		struct iovec iov = { .iov_base = buf, .iov_len = sizeof(buf) };
+		struct sockaddr_nl nla = { .nl_family = AF_NETLINK };
+		struct msghdr msg = { .msg_name = (void *) &nla, .msg_namelen = sizeof(nla), .msg_iov = &iov, .msg_iovlen = 1 };
+		struct nlmsghdr *nh;
+
+		errno = 0;
+		int status = recvmsg(fd, &msg, 0);
+		int err = errno;
+
+		if (status < 0) {
+
+			if (err == EINTR)
+				continue;
+
+			if (err == EWOULDBLOCK || err == EAGAIN)
+				return RTNL_STREAM_AGAIN;
+
+			dbgf_sys(DBGT_WARN, "fd=%d status=%d err=%d %s", fd, status, err, strerror(err));
+			return RTNL_STREAM_FAIL;
+
+		} else if (status == 0 || (msg.msg_flags & MSG_TRUNC)) {
+
+			dbgf_sys(DBGT_WARN, "fd=%d %s", fd, status ? "MSG_TRUNC" : "netlink EOF");
+			return RTNL_STREAM_FAIL;
+		}
+
+		for (nh = (struct nlmsghdr *) buf; NLMSG_OK(nh, (size_t) status); nh = NLMSG_NEXT(nh, status)) {
+
+			if (nla.nl_pid)
+				continue;
+
+			if (nh->nlmsg_type == NLMSG_DONE)
+				return RTNL_STREAM_DONE;
+
+			if (nh->nlmsg_type == NLMSG_ERROR) {
+
+				if (!((struct nlmsgerr*) NLMSG_DATA(nh))->error)
+					continue;
+
+				dbgf_sys(DBGT_ERR, "fd=%d error=%s", fd, strerror(-((struct nlmsgerr*) NLMSG_DATA(nh))->error));
+				return RTNL_STREAM_FAIL;
+			}
+
+			if (func)
+				(*func)(nh, data);
+		}
+	}
+
+	return RTNL_STREAM_BUDGET;
+}
+
 STATIC_FUNC
 IDM_T is_policy_rt_supported(void)
 {
@@ -2887,13 +3619,20 @@ IDM_T is_policy_rt_supported(void)
 
 }
 
-static void get_rule_list_nlhdr(struct nlmsghdr *nh, void *unused)
-{
-	dbgf_all(DBGT_INFO, " ");
-
-	struct avl_node *an;
-	struct track_node *tn;
+/*
+ * Rule events are only reconciled against the tracked IP_RULE_DEFAULT rules they can affect:
+ * Each RTM_DELRULE event is looked up in rule_track_tree by (af, table, prio) and marks the
+ * matching entry. Bursts are collected for RULE_EVENT_DEBOUNCE ms, then the rules of the
+ * affected families are dumped once and only marked entries are checked and re-added.
+ * A lost or unparsable event burst marks all entries.
+ */
+struct rule_event_stats rule_event_stats;
+static IDM_T rule_reconcile_all = NO;
+static IDM_T rule_reconcile_pending = NO;
 
+STATIC_FUNC
+struct rule_track_node *rule_track_find(struct nlmsghdr *nh)
+{
 	struct rtmsg *r = (struct rtmsg *) NLMSG_DATA(nh);
 	struct rtattr *rtap = (struct rtattr *) RTM_RTA(r);
 	int rtl = RTM_PAYLOAD(nh);
@@ -2925,52 +3664,118 @@ static void get_rule_list_nlhdr(struct nlmsghdr *nh, void *unused)
 
 	assertion_dbg(-502515, (!rtl), "!!!Deficit %d, rta_len=%d\n", rtl, rtap->rta_len);
 
+	//all the following is not yet used by bmx7 so must be zero or set by somebody else:
+	if (r->rtm_flags || r->rtm_protocol || r->rtm_src_len || r->rtm_dst_len || r->rtm_tos ||
+		tb[FRA_SRC] || tb[FRA_DST] || tb[FRA_FWMARK] || tb[FRA_FWMASK] || tb[FRA_IFNAME] || tb[FRA_OIFNAME])
+		return NULL;
 
-	for (an = NULL; (tn = avl_iterate_item(&iptrack_tree, &an));) {
-		if (tn->cmd == IP_RULE_DEFAULT && tn->k.cmd_type == IP_RULES &&
-			tn->k.net.af == r->rtm_family && tn->k.table == table && tn->k.prio == rta_prio &&
-			//all the following is not yet used by bmx7 so must be zero or set by somebody else:
-			!r->rtm_flags && !r->rtm_protocol && !r->rtm_src_len && !r->rtm_dst_len && !r->rtm_tos &&
-			!tb[FRA_SRC] && !tb[FRA_DST] && !tb[FRA_FWMARK] && !tb[FRA_FWMASK] && !tb[FRA_IFNAME] && !tb[FRA_OIFNAME]) {
+	struct rule_track_key rk = { .table = table, .prio = rta_prio, .af = r->rtm_family };
 
-			tn->tmp++;
-			;
-			dbgf_track(DBGT_INFO, "found %d/%d", tn->tmp, tn->items);
-		}
-	}
+	return avl_find_item(&rule_track_tree, &rk);
 }
 
-static void recv_ruleEvent_netlink_sk(int sk)
+static void get_rule_list_nlhdr(struct nlmsghdr *nh, void *unused)
 {
-	dbgf_track(DBGT_INFO, "detected changed rules! Going to check...");
+	struct rule_track_node *rn = rule_track_find(nh);
 
-	if (rtnl_rcv(sk, 0, 0, IP_ROUTE_GET, NO, NULL, NULL) != SUCCESS) {
-		dbgf_sys(DBGT_ERR, "FAILED");
+	if (rn) {
+		rn->found++;
+		dbgf_track(DBGT_INFO, "found %d/%d", rn->found, rn->items);
 	}
+}
+
+STATIC_FUNC
+void rule_event_check(struct nlmsghdr *nh, void *unused)
+{
+	struct rule_track_node *rn;
+
+	rule_event_stats.events++;
 
+	if (nh->nlmsg_type == RTM_DELRULE && (rn = rule_track_find(nh)))
+		rn->affected = YES;
+}
+
+STATIC_FUNC
+void rule_reconcile_task(void *unused)
+{
 	struct avl_node *an;
-	struct track_node *tn;
+	struct rule_track_node *rn;
+	struct timeval start, end;
+	IDM_T check4 = NO, check6 = NO;
 
-	for (an = NULL; (tn = avl_iterate_item(&iptrack_tree, &an));)
-		tn->tmp = 0;
+	gettimeofday(&start, NULL);
 
-	kernel_get_route(NO, AF_INET, RTM_GETRULE, 0, get_rule_list_nlhdr);
-	kernel_get_route(NO, AF_INET6, RTM_GETRULE, 0, get_rule_list_nlhdr);
+	rule_reconcile_pending = NO;
 
-	for (an = NULL; (tn = avl_iterate_item(&iptrack_tree, &an));) {
+	for (an = NULL; (rn = avl_iterate_item(&rule_track_tree, &an));) {
 
-		if (tn->cmd == IP_RULE_DEFAULT && tn->k.cmd_type == IP_RULES) {
+		if (rule_reconcile_all)
+			rn->affected = YES;
 
-			dbgf(tn->tmp < tn->items ? DBGL_SYS : DBGL_ALL, (tn->tmp < tn->items) ? DBGT_WARN : DBGT_INFO,
-				"%s lost rule family=%d pref=%d to table=%d should=%d is=%d",
-				tn->tmp < tn->items ? "FIXING" : "KEEPING", tn->k.net.af, tn->k.prio, tn->k.table, tn->items, tn->tmp);
+		if (rn->affected) {
+			rn->found = 0;
+			check4 |= (rn->k.af == AF_INET);
+			check6 |= (rn->k.af == AF_INET6);
+		}
+	}
 
-			if (tn->tmp < tn->items) {
-				kernel_set_route(tn->cmd, ADD, NO, &tn->k.net, tn->k.table, tn->k.prio, 0, NULL, NULL, tn->k.metric);
-				return;
-			}
+	rule_reconcile_all = NO;
+
+	if (check4)
+		kernel_get_route(NO, AF_INET, RTM_GETRULE, 0, get_rule_list_nlhdr);
+	if (check6)
+		kernel_get_route(NO, AF_INET6, RTM_GETRULE, 0, get_rule_list_nlhdr);
+
+	for (an = NULL; (rn = avl_iterate_item(&rule_track_tree, &an));) {
+
+		if (!rn->affected)
+			continue;
+
+		rn->affected = NO;
+		rule_event_stats.checks++;
+
+		dbgf(rn->found < rn->items ? DBGL_SYS : DBGL_ALL, (rn->found < rn->items) ? DBGT_WARN : DBGT_INFO,
+			"%s lost rule family=%d pref=%d to table=%d should=%d is=%d",
+			rn->found < rn->items ? "FIXING" : "KEEPING", rn->k.af, rn->k.prio, rn->k.table, rn->items, rn->found);
+
+		if (rn->found < rn->items) {
+			kernel_set_route(IP_RULE_DEFAULT, ADD, NO, &rn->net, rn->k.table, rn->k.prio, 0, NULL, NULL, rn->metric);
+			rule_event_stats.fixes++;
 		}
 	}
+
+	gettimeofday(&end, NULL);
+	timersub(&end, &start, &end);
+	rule_event_stats.lastUs = (end.tv_sec * 1000000) + end.tv_usec;
+	rule_event_stats.maxUs = XMAX(rule_event_stats.maxUs, rule_event_stats.lastUs);
+
+	dbgf_track(DBGT_INFO, "reconciled %s rules in %dus", check4 && check6 ? "IPv4+6" : check4 ? "IPv4" : check6 ? "IPv6" : "no", rule_event_stats.lastUs);
+}
+
+static void recv_ruleEvent_netlink_sk(int sk)
+{
+	dbgf_track(DBGT_INFO, "detected changed rules! Going to check...");
+
+	struct avl_node *an;
+	struct rule_track_node *rn = NULL;
+
+	if (rtnl_rcv(sk, 0, 0, IP_ROUTE_GET, NO, rule_event_check, NULL) != SUCCESS) {
+		dbgf_sys(DBGT_ERR, "FAILED, rechecking all tracked rules");
+		rule_reconcile_all = YES;
+	}
+
+	if (rule_reconcile_pending)
+		return;
+
+	for (an = NULL; !rule_reconcile_all && (rn = avl_iterate_item(&rule_track_tree, &an));) {
+		if (rn->affected)
+			break;
+	}
+
+	if (rule_reconcile_all || rn) {
+		rule_reconcile_pending = YES;
+		task_register(RULE_EVENT_DEBOUNCE, rule_reconcile_task, NULL, -300869);
+	}
 }
 
 STATIC_FUNC
@@ -3064,6 +3869,8 @@ int32_t opt_ip_version(uint8_t cmd, uint8_t _save, struct opt_type *opt, struct
 	} else if (cmd == OPT_UNREGISTER && nl_rule_event_sk > 0) {
 
 		unregister_netlink_event_hook(nl_rule_event_sk, recv_ruleEvent_netlink_sk);
+		task_remove(rule_reconcile_task, NULL);
+		rule_reconcile_pending = NO;
 	}
 
 	return SUCCESS;
@@ -3526,6 +4333,8 @@ static struct opt_type ip_options[]=
 
         {ODI,0,ARG_NETLINK_BUFFSZ,         0,  9,1, A_PS1, A_ADM, A_DYI, A_CFA, A_ANY, &netlinkBuffSize, MIN_NETLINK_BUFFSZ, MAX_NETLINK_BUFFSZ, DEF_NETLINK_BUFFSZ,0, NULL,
 			ARG_VALUE_FORM,	"set rtnl receive buffer size for netlink socket communication (increase if rtnl_rcv out of buffer logs)"},
+        {ODI,0,ARG_NETLINK_BATCH,          0,  9,1, A_PS1, A_ADM, A_DYI, A_CFA, A_ANY, &netlinkBatch,    MIN_NETLINK_BATCH,  MAX_NETLINK_BATCH,  DEF_NETLINK_BATCH,0,  NULL,
+			ARG_VALUE_FORM,	HLP_NETLINK_BATCH},
 
 			{ODI,0,ARG_INTERFACES,	        0,  9,2,A_PS0,A_USR,A_DYN,A_ARG,A_ANY,	0,		0, 		0,		0,0, 		opt_status,
 			0,		"show interfaces\n"},
@@ -3594,6 +4403,10 @@ void init_ip(void)
 	if (open_ifevent_netlink_sk() < 0)
 		cleanup_all(-500150);
 
+	if ((nl_netconf_sk = register_netlink_event_hook(nl_mgrp(RTNLGRP_IPV4_NETCONF) | nl_mgrp(RTNLGRP_IPV6_NETCONF),
+		(netlinkBuffSize / 4), recv_netconf_netlink_sk)) < 0)
+		nl_netconf_sk = 0;
+
 	register_options_array(ip_options, sizeof( ip_options), CODE_CATEGORY_NAME);
 
 	register_status_handl(sizeof(struct dev_status), 1, dev_status_format, ARG_INTERFACES, dev_status_creator);
@@ -3612,6 +4425,13 @@ void cleanup_ip(void)
 
 	close_ifevent_netlink_sk();
 
+	if (nl_netconf_sk > 0) {
+		unregister_netlink_event_hook(nl_netconf_sk, recv_netconf_netlink_sk);
+		nl_netconf_sk = 0;
+	}
+
+	kernel_ifstats_flush();
+
 	// if ever started succesfully in daemon mode...
 	// flush default routes installed by bmx7:
 	ip_flush_tracked(IP_ROUTE_FLUSH);
@@ -3634,6 +4454,8 @@ void cleanup_ip(void)
 	while (dev_name_tree.items)
 		dev_destroy(dev_name_tree.root->item);
 
+	rtnl_batch_flush(NULL);
+
 	if (ip_rth.fd >= 0) {
 		close(ip_rth.fd);
 		ip_rth.fd = -1;
@@ -53,6 +53,32 @@
 
 extern int32_t netlinkBuffSize;
 
+struct if_event_stats {
+	uint32_t events;
+	uint32_t ignored;
+	uint32_t dumps;
+};
+
+extern struct if_event_stats if_event_stats;
+
+#define RULE_EVENT_DEBOUNCE 100 // ms to collect rule-event bursts before reconciling tracked rules
+
+struct rule_event_stats {
+	uint32_t events;
+	uint32_t checks;
+	uint32_t fixes;
+	uint32_t lastUs;
+	uint32_t maxUs;
+};
+
+extern struct rule_event_stats rule_event_stats;
+
+#define ARG_NETLINK_BATCH "netlinkBatch"
+#define MIN_NETLINK_BATCH 1
+#define MAX_NETLINK_BATCH 256
+#define DEF_NETLINK_BATCH 128
+#define HLP_NETLINK_BATCH "set max number of route and rule changes sent to the kernel per netlink message batch (1 = send each immediately)"
+
 #define ARG_AUTO_SYSCTL "autoSysctl"
 #define ARG_ATUN_SYSCTL "autoTunSysctl"
 #define MIN_AUTO_SYSCTL 0
@@ -312,6 +338,8 @@ extern struct avl_tree dev_name_tree;
 
 #define IFCONFIG_PATH_PROCNET_DEV  "/proc/net/dev"
 
+#define IF_STATS_CACHE_PERIOD 500 // ms during which RTM_GETSTATS dump results are reused
+
 struct user_net_device_stats {
 	unsigned long long rx_packets; /* total packets received       */
 	unsigned long long tx_packets; /* total packets transmitted    */
@@ -533,6 +561,8 @@ struct dev_node {
 #define IP_LINK_GET        03
 #define IP_ADDR_GET        04
 #define IP_ROUTE_GET       05
+#define IP_NETCONF_GET     06
+#define IP_STATS_GET       07
 
 
 #define IP_ADDRESS_SET     11
@@ -580,6 +610,22 @@ struct track_node {
 	IPX_T src;
 };
 
+// secondary index of tracked IP_RULE_DEFAULT rules for rule-event reconciliation:
+struct rule_track_key {
+	uint32_t table;
+	uint32_t prio;
+	uint8_t af;
+} __attribute__((packed));
+
+struct rule_track_node {
+	struct rule_track_key k;
+	uint32_t items;
+	uint32_t found;
+	uint8_t affected;
+	struct net_key net;
+	uint32_t metric;
+};
+
 struct rtnl_get_node {
 	struct list_node list;
 	uint16_t nlmsg_type;
@@ -599,6 +645,16 @@ int rtnl_rcv(int fd, uint32_t pid, uint32_t seq, uint16_t cmd, uint8_t quiet, vo
 uint32_t nl_mgrp(uint32_t group);
 int register_netlink_event_hook(uint32_t nlgroups, int buffsize, void (*cb_fd_handler) (int32_t fd));
 int unregister_netlink_event_hook(int rtevent_sk, void (*cb_fd_handler) (int32_t fd));
+int register_netlink_dump_hook(int buffsize, void (*cb_fd_handler) (int32_t fd));
+IDM_T kernel_dump_route_request(int fd, uint8_t family, uint32_t table);
+
+//rtnl_rcv_stream() results:
+#define RTNL_STREAM_FAIL   -1 // overrun, truncated, error, or EOF
+#define RTNL_STREAM_AGAIN   0 // socket drained for now
+#define RTNL_STREAM_BUDGET  1 // budget exhausted, more data may be pending
+#define RTNL_STREAM_DONE    2 // NLMSG_DONE of a dump received
+
+int rtnl_rcv_stream(int fd, uint32_t budget, void (*func) (struct nlmsghdr *nh, void *data), void *data);
 
 uint32_t get_if_index(IFNAME_T *name);
 IDM_T kernel_set_flags(char *name, int fd, int get_req, int set_req, uint16_t up_flags, uint16_t down_flags);
@@ -619,7 +675,7 @@ IDM_T kernel_set_mtu(char *name, uint16_t mtu);
 IDM_T kernel_get_route(uint8_t quiet, uint8_t family, uint16_t type, uint32_t table, void (*func) (struct nlmsghdr *nh, void *data));
 
 // from net-tools: ifconfig.c and lib/interface.c
-IDM_T kernel_get_ifstats(struct user_net_device_stats *stats, char *target);
+IDM_T kernel_get_ifstats(struct user_net_device_stats *stats, int32_t index, char *target);
 
 struct sockaddr_storage set_sockaddr_storage(uint8_t af, IPX_T *ipx, int32_t port);
 void set_ipexport(void (*func) (int8_t del, const struct net_key *dst, uint32_t oif_idx, IPX_T *via, uint32_t metric, uint8_t distance));
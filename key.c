@@ -208,6 +208,7 @@ struct key_node *keyNode_create(GLOBAL_ID_T *kHash)
 	kn->kHash = *kHash;
 	AVL_INIT_TREE(kn->recommendations_tree, struct orig_node, kn);
 	AVL_INIT_TREE(kn->neighRefs_tree, struct NeighRef_node, nn);
+	AVL_INIT_TREE(kn->neighPathRanks, struct NeighRef_node, rank);
 	AVL_INIT_TREE(kn->trustees_tree, struct orig_node, kn);
 
 	avl_insert(&key_tree, kn, -300704);
@@ -239,6 +240,7 @@ void keyNode_destroy_(struct key_node *kn)
 
 	assertion(-502344, (!kn->on && !kn->nextDesc && !kn->recommendations_tree.items) && !kn->trustees_tree.items);
 	assertion(-502345, (!kn->neighRefs_tree.items));
+	assertion(-502787, (!kn->neighPathRanks.items));
 	assertion(-502346, (!kn->content));
 
 
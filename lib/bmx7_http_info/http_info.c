@@ -18,7 +18,9 @@
  */
 
 #include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <sys/types.h>
@@ -36,11 +38,21 @@
 #include "crypt.h"
 #include "avl.h"
 #include "node.h"
+#include "key.h"
+#include "sec.h"
+#include "metrics.h"
+#include "ogm.h"
+#include "msg.h"
 #include "plugin.h"
 #include "schedule.h"
 #include "tools.h"
 #include "iptools.h"
 #include "ip.h"
+#include "prof.h"
+#include "allocate.h"
+#ifdef TRAFFIC_DUMP
+#include "dump.h"
+#endif
 
 #define CODE_CATEGORY_NAME "http_info"
 
@@ -54,11 +66,213 @@ static int32_t http_info_port;
 #define HTTP_INFO_GLOB_ACCESS "http_info_global_access"
 static int32_t http_access;
 
-#define HTTP_INFO_LISTEN_QUEUE 5
+#define HTTP_INFO_KEEP_ALIVE "http_info_keep_alive"
+#define MIN_HTTP_INFO_KEEP_ALIVE 1000
+#define MAX_HTTP_INFO_KEEP_ALIVE 3600000
+#define DEF_HTTP_INFO_KEEP_ALIVE 60000
+static int32_t http_keep_alive_to = DEF_HTTP_INFO_KEEP_ALIVE;
+
+#define HTTP_INFO_LISTEN_QUEUE 32
+
+#define HTTP_METRICS_PATH "metrics"
+#define HTTP_METRICS_CONTENT_TYPE "text/plain; version=0.0.4"
+#define HTTP_METRICS_BUFF_MIN 8192
 
 
 static int http_info_tcp_sock_in = 0;
 
+static uint32_t http_route_changes[2];
+
+static char *metrics_buff = NULL;
+static uint32_t metrics_size = 0;
+static uint32_t metrics_len = 0;
+
+static void http_info_route_change(uint8_t del, struct orig_node *dest)
+{
+	http_route_changes[!!del]++;
+}
+
+static void metrics_printf(char *last, ...)
+{
+	va_list ap;
+	int len;
+
+	while (1) {
+
+		va_start(ap, last);
+		len = vsnprintf(metrics_buff + metrics_len, metrics_size - metrics_len, last, ap);
+		va_end(ap);
+
+		if (len < 0)
+			return;
+
+		if (metrics_len + len < metrics_size) {
+			metrics_len += len;
+			return;
+		}
+
+		metrics_size = XMAX(2 * metrics_size, metrics_len + len + 1);
+		metrics_buff = debugRealloc(metrics_buff, metrics_size, -300909);
+	}
+}
+
+static void metrics_head(char *name, char *type, char *help)
+{
+	metrics_printf("# HELP bmx7_%s %s\n# TYPE bmx7_%s %s\n", name, help, name, type);
+}
+
+/*
+ * Render all metrics in the prometheus text exposition format into metrics_buff.
+ * Counters are cumulative since startup, gauges reflect the current state.
+ */
+static void http_metrics_render(void)
+{
+	uint8_t c, r;
+
+	if (!metrics_buff) {
+		metrics_size = HTTP_METRICS_BUFF_MIN;
+		metrics_buff = debugMalloc(metrics_size, -300909);
+	}
+
+	metrics_len = 0;
+
+	metrics_head("info", "gauge", "Version of the running daemon");
+	metrics_printf("bmx7_info{branch=\"%s\",version=\"%s\",revision=\"%s\"} 1\n", BMX_BRANCH, BRANCH_VERSION, GIT_REV);
+
+	metrics_head("uptime_seconds", "gauge", "Seconds since the daemon was started");
+	metrics_printf("bmx7_uptime_seconds %u.%03u\n", bmx_time / 1000, bmx_time % 1000);
+
+	metrics_head("cpu_load_ratio", "gauge", "Averaged cpu load of the daemon");
+	metrics_printf("bmx7_cpu_load_ratio %u.%03u\n", s_curr_avg_cpu_load / 1000, s_curr_avg_cpu_load % 1000);
+
+	metrics_head("memory_bytes", "gauge", "Virtual memory size of the daemon");
+	metrics_printf("bmx7_memory_bytes %ju\n", (uintmax_t) getProcMemory());
+
+	metrics_head("originators", "gauge", "Known originators");
+	metrics_printf("bmx7_originators %u\n", orig_tree.items);
+
+	metrics_head("neighbors", "gauge", "Known neighbors");
+	metrics_printf("bmx7_neighbors %u\n", local_tree.items);
+
+	metrics_head("links", "gauge", "Known links");
+	metrics_printf("bmx7_links %u\n", link_tree.items);
+
+	metrics_head("keys", "gauge", "Known node keys");
+	metrics_printf("bmx7_keys %u\n", key_tree.items);
+
+	metrics_head("key_state_nodes", "gauge", "Node keys per key state");
+	for (c = 0; c < KCSize; c++) {
+		for (r = 0; r < KRSize; r++)
+			metrics_printf("bmx7_key_state_nodes{state=\"%s\"} %d\n", keyMatrix[c][r].secName, keyMatrix[c][r].i.numSec);
+	}
+
+	metrics_head("routes", "gauge", "Currently configured originator routes");
+	metrics_printf("bmx7_routes %d\n", totalOrigRoutes);
+
+	metrics_head("route_changes_total", "counter", "Originator routes added and removed since the plugin was loaded");
+	metrics_printf("bmx7_route_changes_total{op=\"add\"} %u\n", http_route_changes[NO]);
+	metrics_printf("bmx7_route_changes_total{op=\"del\"} %u\n", http_route_changes[YES]);
+
+	struct route_eval_stats *res = get_route_eval_stats();
+	metrics_head("route_evals", "gauge", "Route evaluations during the previous second");
+	metrics_printf("bmx7_route_evals{kind=\"evals\"} %u\n", res->evals);
+	metrics_printf("bmx7_route_evals{kind=\"cached\"} %u\n", res->cached);
+	metrics_printf("bmx7_route_evals{kind=\"algos\"} %u\n", res->algos);
+	metrics_printf("bmx7_route_evals{kind=\"ranked\"} %u\n", res->ranked);
+
+	metrics_head("ogm_aggregations_total", "counter", "Sent ogm aggregations");
+	metrics_printf("bmx7_ogm_aggregations_total %u\n", ogm_aggreg_stats.aggregs);
+	metrics_head("ogm_packets_total", "counter", "Sent packets containing ogm aggregations");
+	metrics_printf("bmx7_ogm_packets_total %u\n", ogm_aggreg_stats.packets);
+	metrics_head("ogm_dropped_total", "counter", "Ogms removed from the aggregation window before being sent");
+	metrics_printf("bmx7_ogm_dropped_total %u\n", ogm_aggreg_stats.dropped);
+
+#ifdef TRAFFIC_DUMP
+	static const char *dirs[DUMP_DIRECTION_ARRSZ] = { "out", "in" };
+	static const char *types[DUMP_TYPE_ARRSZ] = { "udp_payload", "packet_header", "frame_header" };
+	struct dump_data *dd = get_traffic_statistics();
+	uint8_t d, t;
+
+	metrics_head("traffic_bytes_total", "counter", "Sent (out) and received (in) bytes");
+	for (d = 0; d < DUMP_DIRECTION_ARRSZ; d++) {
+		for (t = 0; t < DUMP_TYPE_ARRSZ; t++)
+			metrics_printf("bmx7_traffic_bytes_total{dir=\"%s\",type=\"%s\"} %ju\n", dirs[d], types[t], (uintmax_t) dd->sum_all[d][t]);
+	}
+
+	metrics_head("frame_bytes_total", "counter", "Sent (out) and received (in) bytes per frame type");
+	for (d = 0; d < DUMP_DIRECTION_ARRSZ; d++) {
+		for (t = 0; t <= packet_frame_db->handl_max && t < FRAME_TYPE_ARRSZ; t++) {
+			if (packet_frame_db->handls[t].name)
+				metrics_printf("bmx7_frame_bytes_total{dir=\"%s\",frame=\"%s\"} %ju\n",
+				dirs[d], packet_frame_db->handls[t].name, (uintmax_t) dd->sum_frame[d][t]);
+		}
+	}
+#endif
+
+	struct avl_node *an = NULL;
+	struct prof_ctx *pc;
+	metrics_head("prof_seconds_total", "counter", "Process cpu time spent in profiled functions (updated every 5s)");
+	while ((pc = prof_iterate(&an))) {
+		// neighbor and originator specific contexts would result in duplicate series
+		if (!pc->k.neigh && !pc->k.orig)
+			metrics_printf("bmx7_prof_seconds_total{func=\"%s\"} %.6f\n", pc->name, ((double) pc->cpuPrevTotal) / 1000000000);
+	}
+
+	an = NULL;
+	metrics_head("prof_calls_total", "counter", "Calls of profiled functions");
+	while ((pc = prof_iterate(&an))) {
+		if (!pc->k.neigh && !pc->k.orig)
+			metrics_printf("bmx7_prof_calls_total{func=\"%s\"} %ju\n", pc->name, (uintmax_t) pc->calls);
+	}
+}
+
+/*
+ * HTTP/1.1 requests keep the connection open unless asked otherwise,
+ * HTTP/1.0 requests only with an explicit keep-alive header.
+ */
+static IDM_T http_keep_alive(char *req)
+{
+	char *eol = strpbrk(req, "\r\n");
+	char *line = req;
+	IDM_T keep = (eol && eol - req >= 8 && !strncmp(eol - 8, "HTTP/1.1", 8));
+
+	while ((line = strchr(line, '\n'))) {
+
+		line++;
+
+		if (!strncasecmp(line, "Connection:", strlen("Connection:"))) {
+
+			char *val = line + strlen("Connection:");
+			val += strspn(val, " \t");
+
+			if (!strncasecmp(val, "close", strlen("close")))
+				keep = NO;
+			else if (!strncasecmp(val, "keep-alive", strlen("keep-alive")))
+				keep = YES;
+		}
+	}
+
+	return keep;
+}
+
+static IDM_T http_metrics_reply(struct ctrl_node *cn, IDM_T keep)
+{
+	char hdr[200];
+	int hdr_len;
+
+	http_metrics_render();
+
+	hdr_len = snprintf(hdr, sizeof(hdr), "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: %s\r\n\r\n",
+		HTTP_METRICS_CONTENT_TYPE, metrics_len, keep ? "keep-alive" : "close");
+
+	if (ctrl_out_write(cn, hdr, hdr_len) == FAILURE || ctrl_out_write(cn, metrics_buff, metrics_len) == FAILURE) {
+		dbgf_sys(DBGT_ERR, "failed sending %d bytes of metrics via fd %d", hdr_len + metrics_len, cn->fd);
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
 static void http_info_rcv_tcp_data(struct ctrl_node *cn)
 {
 
@@ -70,6 +284,18 @@ static void http_info_rcv_tcp_data(struct ctrl_node *cn)
 	errno = 0;
 	tcp_req_len = read(cn->fd, &tcp_req_data, MAX_TCP_REQ_LEN);
 
+	if (tcp_req_len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+		return;
+
+	if (tcp_req_len > 0 && cn->outClose)
+		return;
+
+	if (tcp_req_len == 0) {
+		// (idle keep-alive) connection closed by peer
+		close_ctrl_node(CTRL_CLOSE_STRAIGHT, cn);
+		return;
+	}
+
 	if (tcp_req_len > 5 &&
 		!memcmp(HTTP_PREAMBLE, tcp_req_data, HTTP_PREAMBLE_LEN) &&
 		tcp_req_len <= MAX_TCP_REQ_LEN) {
@@ -79,6 +305,32 @@ static void http_info_rcv_tcp_data(struct ctrl_node *cn)
 		struct opt_type *opt;
 		char *request = &(tcp_req_data[HTTP_PREAMBLE_LEN]);
 
+		if (!strncmp(request, HTTP_METRICS_PATH, strlen(HTTP_METRICS_PATH)) &&
+			strchr(" ?\r\n", request[strlen(HTTP_METRICS_PATH)])) {
+
+			IDM_T keep = http_keep_alive(tcp_req_data);
+
+			dbgf(DBGL_CHANGES, DBGT_INFO, "rcvd %d bytes long HTTP request via fd %d: %s keep-alive=%d",
+				tcp_req_len, cn->fd, HTTP_METRICS_PATH, keep);
+
+			cn->closing_timeout = keep ? http_keep_alive_to : 0;
+
+			if (http_metrics_reply(cn, keep) == FAILURE)
+				close_ctrl_node(CTRL_CLOSE_STRAIGHT, cn);
+			else if (keep)
+				close_ctrl_node(CTRL_CLOSE_DELAY, cn); // restart idle timeout
+			else
+				close_ctrl_node(CTRL_CLOSE_ERROR, cn); // close once response is drained
+
+			return;
+		}
+
+		// text pages are written blocking until the connection is closed
+		if (!cn->outLen) {
+			fcntl(cn->fd, F_SETFL, fcntl(cn->fd, F_GETFL, 0) & ~O_NONBLOCK);
+			cn->buffered = NO;
+		}
+
 		dbg_printf(cn, "Content-type: text/plain\n\n");
 		dbg_printf(cn, "\n");
 
@@ -121,6 +373,8 @@ static void http_info_rcv_tcp_data(struct ctrl_node *cn)
 				}
 			}
 
+			dbg_printf(cn, "/%s\n\n", HTTP_METRICS_PATH);
+
 		}
 
 	} else {
@@ -128,7 +382,7 @@ static void http_info_rcv_tcp_data(struct ctrl_node *cn)
 		dbgf(DBGL_SYS, DBGT_ERR, "illegal request via cn->fd %d: %s", cn->fd, strerror(errno));
 	}
 
-	close_ctrl_node(CTRL_CLOSE_STRAIGHT, cn);
+	close_ctrl_node(CTRL_CLOSE_ERROR, cn);
 
 }
 
@@ -166,15 +420,15 @@ static void http_info_rcv_tcp_connect(int32_t fd_in)
 		return;
 	}
 
-	/*
+	// responses are queued and drained by the event loop so slow scrapers never block us:
 	int32_t sock_opts;
-	sock_opts = fcntl( tmp_tcp_sock, F_GETFL, 0 );
-	fcntl( tmp_tcp_sock, F_SETFL, sock_opts | O_NONBLOCK );
-	 */
+	sock_opts = fcntl(tmp_tcp_sock, F_GETFL, 0);
+	fcntl(tmp_tcp_sock, F_SETFL, sock_opts | O_NONBLOCK);
 
 	dbgf(DBGL_CHANGES, DBGT_INFO, "rcvd connect via fd %d from %s", tmp_tcp_sock, ip4AsStr(addr.sin_addr.s_addr));
 
 	struct ctrl_node *cn = create_ctrl_node(tmp_tcp_sock, http_info_rcv_tcp_data, NO /*admin rights*/);
+	cn->buffered = YES;
 	close_ctrl_node(CTRL_CLOSE_DELAY, cn);
 	change_selects();
 }
@@ -260,7 +514,10 @@ static struct opt_type http_info_options[]= {
 			ARG_PORT_FORM,	"set tcp port for http_info plugin" },
 		
 	{ODI,0,HTTP_INFO_GLOB_ACCESS,	0,9,2, A_PS1,A_ADM,A_DYI,A_CFA,A_ANY,	&http_access,	0, 		1,		0,0, 		0,
-			ARG_VALUE_FORM,	"disable/enable global accessibility of http_info plugin via configured tcp port" }
+			ARG_VALUE_FORM,	"disable/enable global accessibility of http_info plugin via configured tcp port" },
+
+	{ODI,0,HTTP_INFO_KEEP_ALIVE,	0,9,2, A_PS1,A_ADM,A_DYI,A_CFA,A_ANY,	&http_keep_alive_to,MIN_HTTP_INFO_KEEP_ALIVE,MAX_HTTP_INFO_KEEP_ALIVE,DEF_HTTP_INFO_KEEP_ALIVE,0, 0,
+			ARG_VALUE_FORM,	"set timeout in ms for idle keep-alive connections, should exceed the scrape interval" }
 	
 };
 static void http_info_cleanup(void)
@@ -268,6 +525,13 @@ static void http_info_cleanup(void)
 
 	//	remove_options_array( http_info_options );
 
+	set_route_change_hooks(http_info_route_change, DEL);
+
+	if (metrics_buff)
+		debugFree(metrics_buff, -300910);
+
+	metrics_buff = NULL;
+	metrics_size = 0;
 }
 
 static int32_t http_info_init(void)
@@ -275,6 +539,8 @@ static int32_t http_info_init(void)
 
 	register_options_array(http_info_options, sizeof( http_info_options), CODE_CATEGORY_NAME);
 
+	set_route_change_hooks(http_info_route_change, ADD);
+
 	return SUCCESS;
 
 }
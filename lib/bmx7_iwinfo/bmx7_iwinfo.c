@@ -130,6 +130,10 @@ void get_link_rate(struct dev_node *tDev)
 
 						if (oLink->wifiStats.txPackets != e->tx_packets) {
 
+							UMETRIC_T oldTxRateAvg = oLink->wifiStats.txRateAvg;
+							UMETRIC_T oldExpTpAvg = oLink->wifiStats.expTpAvg;
+							uint8_t oldTxShortGi = oLink->wifiStats.txShortGi;
+
 							oLink->wifiStats.txRate = e->tx_rate.rate * 1000;
 							oLink->wifiStats.txRateAvg = oLink->wifiStats.txRateAvg + (oLink->wifiStats.txRate / linkAvgRateWeight) - (oLink->wifiStats.txRateAvg / linkAvgRateWeight);
 #ifdef HAVE_IWINFO_THR
@@ -143,6 +147,11 @@ void get_link_rate(struct dev_node *tDev)
 							//link->linkStats.txMhz = e->tx_rate.mhz;
 							//link->linkStats.txNss = e->tx_rate.nss;
 							oLink->wifiStats.txShortGi = e->tx_rate.is_short_gi;
+
+							// only invalidate cached path metrics if the rate based link metric can differ
+							if (oldTxRateAvg != oLink->wifiStats.txRateAvg || oldExpTpAvg != oLink->wifiStats.expTpAvg ||
+								oldTxShortGi != oLink->wifiStats.txShortGi)
+								neighs_linkMetrics_changed(oLink->k.linkDev->key.local);
 							//link->linkStats.txVht = e->tx_rate.is_vht;
 
 							oLink->wifiStats.rxRate = e->rx_rate.rate * 1000;
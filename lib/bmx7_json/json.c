@@ -27,6 +27,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <stdint.h>
+#include <stdarg.h>
 #include <json-c/json.h>
 //#include <dirent.h>
 //#include <sys/inotify.h>
@@ -60,13 +61,209 @@
 static int32_t json_update_interval = DEF_JSON_UPDATE;
 static int32_t current_update_interval = 0;
 
+static int32_t json_flush_interval = DEF_JSON_FLUSH;
+
 static char *json_dir = NULL;
 static char *json_desc_dir = NULL;
 static char *json_orig_dir = NULL;
 static char *json_netjson_dir = NULL;
 
+struct json_file_node {
+	char path[MAX_PATH_SIZE];
+	CRYPTSHA_T hash; // of the last content written to path
+};
+
+struct json_dirty_node {
+	GLOBAL_ID_T nodeId;
+};
+
+static AVL_TREE(json_file_tree, struct json_file_node, path);
+static AVL_TREE(json_dirty_tree, struct json_dirty_node, nodeId); // originators pending a rewrite
+
+static uint8_t json_dirty = 0;
+static IDM_T json_flush_pending = NO;
+static TIME_T json_flush_stamp = 0;
+static struct json_stats json_stats;
+
+/*
+ * Minimal streaming json writer. Documents are rendered straight into one
+ * reusable buffer, following the spacing of json_object_to_json_string()
+ * so exported files keep their exact format.
+ */
+struct json_stream {
+	char *buf;
+	uint32_t len;
+	uint32_t size;
+	uint8_t depth;
+	uint8_t isObj[JSON_STREAM_DEPTH];
+	uint32_t items[JSON_STREAM_DEPTH];
+};
+
+static struct json_stream json_stream;
+
 STATIC_FUNC
-json_object * fields_dbg_json(uint8_t relevance, uint8_t force_array, uint16_t data_size, uint8_t *data,
+void jsw_reserve(struct json_stream *js, uint32_t len)
+{
+	if (js->len + len + 1 > js->size) {
+		js->size = XMAX(js->len + len + 1, XMAX(js->size * 2, JSON_STREAM_SIZE));
+		js->buf = debugRealloc(js->buf, js->size, -300895);
+	}
+}
+
+STATIC_FUNC
+struct json_stream *jsw_reset(void)
+{
+	struct json_stream *js = &json_stream;
+
+	jsw_reserve(js, 0);
+	js->len = 0;
+	js->depth = 0;
+	js->buf[0] = 0;
+	return js;
+}
+
+STATIC_FUNC
+void jsw_append(struct json_stream *js, const char *data, uint32_t len)
+{
+	jsw_reserve(js, len);
+	memcpy(js->buf + js->len, data, len);
+	js->buf[(js->len += len)] = 0;
+}
+
+STATIC_FUNC
+void jsw_printf(struct json_stream *js, const char *format, ...)
+{
+	va_list ap;
+	int len;
+
+	va_start(ap, format);
+	len = vsnprintf(js->buf + js->len, js->size - js->len, format, ap);
+	va_end(ap);
+
+	if (len >= (int) (js->size - js->len)) {
+		jsw_reserve(js, len);
+		va_start(ap, format);
+		vsnprintf(js->buf + js->len, js->size - js->len, format, ap);
+		va_end(ap);
+	}
+
+	js->len += len;
+}
+
+STATIC_FUNC
+void jsw_value(struct json_stream *js)
+{
+	// separate array elements, object members are separated by jsw_key()
+	if (js->depth && !js->isObj[js->depth - 1] && js->items[js->depth - 1]++)
+		jsw_append(js, ", ", 2);
+}
+
+STATIC_FUNC
+void jsw_quoted(struct json_stream *js, const char *str)
+{
+	const char *pos;
+
+	jsw_reserve(js, strlen(str) + 2);
+	jsw_append(js, "\"", 1);
+
+	for (pos = str; *pos; pos++) {
+
+		unsigned char c = *pos;
+
+		switch (c) {
+		case '"': jsw_append(js, "\\\"", 2); break;
+		case '\\': jsw_append(js, "\\\\", 2); break;
+		case '/': jsw_append(js, "\\/", 2); break;
+		case '\b': jsw_append(js, "\\b", 2); break;
+		case '\f': jsw_append(js, "\\f", 2); break;
+		case '\n': jsw_append(js, "\\n", 2); break;
+		case '\r': jsw_append(js, "\\r", 2); break;
+		case '\t': jsw_append(js, "\\t", 2); break;
+		default:
+			if (c < 0x20)
+				jsw_printf(js, "\\u%04x", c);
+			else
+				jsw_append(js, (const char*) &c, 1);
+		}
+	}
+
+	jsw_append(js, "\"", 1);
+}
+
+STATIC_FUNC
+void jsw_key(struct json_stream *js, const char *key)
+{
+	assertion(-502813, (js->depth && js->isObj[js->depth - 1]));
+
+	if (js->items[js->depth - 1]++)
+		jsw_append(js, ", ", 2);
+
+	jsw_quoted(js, key);
+	jsw_append(js, ": ", 2);
+}
+
+STATIC_FUNC
+void jsw_begin(struct json_stream *js, IDM_T isObj)
+{
+	assertion(-502814, (js->depth < JSON_STREAM_DEPTH));
+
+	jsw_value(js);
+	jsw_append(js, isObj ? "{ " : "[ ", 2);
+	js->isObj[js->depth] = isObj;
+	js->items[js->depth++] = 0;
+}
+
+STATIC_FUNC
+void jsw_end(struct json_stream *js)
+{
+	assertion(-502815, (js->depth));
+
+	js->depth--;
+
+	if (js->items[js->depth])
+		jsw_append(js, js->isObj[js->depth] ? " }" : " ]", 2);
+	else
+		jsw_append(js, js->isObj[js->depth] ? "}" : "]", 1);
+}
+
+STATIC_FUNC
+void jsw_string(struct json_stream *js, const char *str)
+{
+	jsw_value(js);
+	jsw_quoted(js, str);
+}
+
+STATIC_FUNC
+void jsw_int(struct json_stream *js, int32_t val)
+{
+	jsw_value(js);
+	jsw_printf(js, "%d", val);
+}
+
+STATIC_FUNC
+void jsw_double(struct json_stream *js, double val)
+{
+	char tmp[32];
+
+	jsw_value(js);
+	snprintf(tmp, sizeof(tmp), "%.17g", val);
+	jsw_append(js, tmp, strlen(tmp));
+
+	if (!strpbrk(tmp, ".eEinfa"))
+		jsw_append(js, ".0", 2);
+}
+
+#define jsw_key_string(js, key, val) do { jsw_key(js, key); jsw_string(js, val); } while (0)
+#define jsw_key_int(js, key, val) do { jsw_key(js, key); jsw_int(js, val); } while (0)
+#define jsw_key_double(js, key, val) do { jsw_key(js, key); jsw_double(js, val); } while (0)
+
+/*
+ * Streams the fields of a status or tlv message as one object (or, with
+ * force_array, as an array of objects). Returns NO and leaves the stream
+ * untouched if nothing was relevant.
+ */
+STATIC_FUNC
+IDM_T fields_dbg_json(struct json_stream *js, uint8_t relevance, uint8_t force_array, uint16_t data_size, uint8_t *data,
 	uint16_t min_msg_size, const struct field_format *format)
 {
 	assertion(-501300, (format && data));
@@ -76,87 +273,192 @@ json_object * fields_dbg_json(uint8_t relevance, uint8_t force_array, uint16_t d
 
 	struct field_iterator it = { .format = format, .data = data, .data_size = data_size, .min_msg_size = min_msg_size };
 
-	json_object *jfields = NULL;
-	json_object *jarray = NULL;
+	IDM_T jfields = NO;
+	IDM_T jarray = NO;
 
 	while ((msgs_size = field_iterate(&it)) == SUCCESS) {
 
 		assertion(-501301, IMPLIES(it.field == 0, !jfields));
-		/*
-		if (it.field == 0 && jfields) {
-			jarray = jarray ? jarray : json_object_new_array();
-			json_object_array_add(jarray, jfields);
-			jfields = NULL;
-		}
-		 */
 
 		if (format[it.field].field_relevance >= relevance) {
 
-			json_object *jfield_val;
+			if (force_array && !jarray) {
+				jsw_begin(js, NO);
+				jarray = YES;
+			}
 
-			if (format[it.field].field_type == FIELD_TYPE_UINT && it.field_bits <= 32) {
-				jfield_val = json_object_new_int(
-					field_get_value(&format[it.field], min_msg_size, data, it.field_bit_pos, it.field_bits));
-			} else {
-				jfield_val = json_object_new_string(
-					field_dbg_value(&format[it.field], min_msg_size, data, it.field_bit_pos, it.field_bits));
+			if (!jfields) {
+				jsw_begin(js, YES);
+				jfields = YES;
 			}
 
-			jfields = jfields ? jfields : json_object_new_object();
+			jsw_key(js, format[it.field].field_name);
 
-			json_object_object_add(jfields, format[it.field].field_name, jfield_val);
+			if (format[it.field].field_type == FIELD_TYPE_UINT && it.field_bits <= 32) {
+				jsw_int(js, field_get_value(&format[it.field], min_msg_size, data, it.field_bit_pos, it.field_bits));
+			} else {
+				jsw_string(js, field_dbg_value(&format[it.field], min_msg_size, data, it.field_bit_pos, it.field_bits));
+			}
 		}
 
 		if (force_array && it.field == (columns - 1)) {
-			jarray = jarray ? jarray : json_object_new_array();
-			json_object_array_add(jarray, jfields);
-			jfields = NULL;
+
+			if (!jarray) {
+				jsw_begin(js, NO);
+				jarray = YES;
+			}
+
+			if (jfields) {
+				jsw_end(js);
+				jfields = NO;
+			} else {
+				jsw_value(js);
+				jsw_append(js, "null", 4);
+			}
 		}
 
 	}
 
 	assertion(-501302, (data_size ? msgs_size == data_size : msgs_size == min_msg_size));
 
-	return jarray ? jarray : jfields;
+	if (jfields)
+		jsw_end(js);
+
+	if (jarray)
+		jsw_end(js);
+
+	return (jarray || jfields);
+}
+
+/*
+ * Like fields_dbg_json() but as a member of the current object, the key is
+ * only emitted if there are relevant fields.
+ */
+STATIC_FUNC
+IDM_T fields_dbg_json_member(struct json_stream *js, const char *key, uint8_t relevance, uint8_t force_array,
+	uint16_t data_size, uint8_t *data, uint16_t min_msg_size, const struct field_format *format)
+{
+	uint32_t len = js->len;
+	uint32_t items = js->items[js->depth - 1];
+
+	jsw_key(js, key);
+
+	if (fields_dbg_json(js, relevance, force_array, data_size, data, min_msg_size, format))
+		return YES;
+
+	js->buf[(js->len = len)] = 0;
+	js->items[js->depth - 1] = items;
+	return NO;
+}
+
+STATIC_FUNC
+IDM_T json_file_changed(char *path, CRYPTSHA_T *hash)
+{
+	struct json_file_node *fn;
+	char key[MAX_PATH_SIZE];
+
+	memset(key, 0, sizeof(key));
+	strncpy(key, path, sizeof(key) - 1);
+
+	if ((fn = avl_find_item(&json_file_tree, key))) {
 
-	/*
-		if (jfields && (force_array || jarray)) {
-			jarray = jarray ? jarray : json_object_new_array();
-			json_object_array_add(jarray, jfields);
-			return jarray;
+		if (!memcmp(&fn->hash, hash, sizeof(CRYPTSHA_T))) {
+			json_stats.avoided++;
+			return NO;
 		}
 
-		return jfields;
-	 */
+	} else {
+		fn = debugMallocReset(sizeof(struct json_file_node), -300885);
+		memcpy(fn->path, key, sizeof(fn->path));
+		avl_insert(&json_file_tree, fn, -300886);
+	}
+
+	fn->hash = *hash;
+	return YES;
 }
 
 STATIC_FUNC
-void json_write_file(json_object *jobj, char *dirName, char *fileName)
+void json_file_forget(char *path)
+{
+	struct json_file_node *fn;
+	char key[MAX_PATH_SIZE];
+
+	memset(key, 0, sizeof(key));
+	strncpy(key, path, sizeof(key) - 1);
+
+	if ((fn = avl_remove(&json_file_tree, key, -300887)))
+		debugFree(fn, -300888);
+}
+
+STATIC_FUNC
+void json_tmp_path(char *tmp_name, char *path_name)
+{
+	// dot-prefixed so readers of the directory never pick up partially written files
+	char *base = strrchr(path_name, '/');
+
+	assertion(-502810, (base));
+	snprintf(tmp_name, MAX_PATH_SIZE, "%.*s/.%s.tmp", (int) (base - path_name), path_name, base + 1);
+}
+
+STATIC_FUNC
+void json_rename_file(char *tmp_name, char *path_name)
+{
+	if (rename(tmp_name, path_name) != 0) {
+		dbgf_sys(DBGT_ERR, "could not rename %s to %s - %s", tmp_name, path_name, strerror(errno));
+		unlink(tmp_name);
+		json_file_forget(path_name);
+	} else {
+		json_stats.writes++;
+	}
+}
+
+STATIC_FUNC
+void json_write_str(const char *str, char *dirName, char *fileName)
 {
 
 	assertion(-501275, (dirName));
 	char path_name[MAX_PATH_SIZE];
 	sprintf(path_name, "%s/%s", dirName, fileName);
 
-	if (jobj) {
+	if (str) {
 		int fd;
+		char tmp_name[MAX_PATH_SIZE];
+		CRYPTSHA_T hash;
+
+		cryptShaAtomic((void*) str, strlen(str), &hash);
+
+		if (!json_file_changed(path_name, &hash))
+			return;
 
-		if ((fd = open(path_name, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) >= 0) { //check permissions of generated file
+		json_tmp_path(tmp_name, path_name);
+
+		if ((fd = open(tmp_name, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) >= 0) { //check permissions of generated file
 			dbgf_all(DBGT_INFO, "writing json data to: %s", path_name);
-			dprintf(fd, "%s\n", json_object_to_json_string(jobj));
+			dprintf(fd, "%s\n", str);
 			close(fd);
+			json_rename_file(tmp_name, path_name);
 		} else {
-			dbgf_sys(DBGT_ERR, "could not open %s - %s", path_name, strerror(errno));
+			dbgf_sys(DBGT_ERR, "could not open %s - %s", tmp_name, strerror(errno));
+			json_file_forget(path_name);
 		}
 	} else {
+		json_file_forget(path_name);
+
 		if (remove(path_name) != 0) {
 			dbgf_sys(DBGT_ERR, "could not remove %s: %s \n", path_name, strerror(errno));
 		} else {
+			json_stats.removes++;
 			dbgf_all(DBGT_INFO, "removing destroyed json-description=%s", path_name);
 		}
 	}
 }
 
+STATIC_FUNC
+void json_write_file(json_object *jobj, char *dirName, char *fileName)
+{
+	json_write_str(jobj ? json_object_to_json_string(jobj) : NULL, dirName, fileName);
+}
+
 STATIC_FUNC
 int32_t update_json_options(IDM_T show_options, IDM_T show_parameters, char *file_name)
 {
@@ -319,60 +621,63 @@ int32_t update_json_options(IDM_T show_options, IDM_T show_parameters, char *fil
 }
 
 STATIC_FUNC
-json_object *json_netjson_create_networkHeader(char *typeStr, char *labelStr)
+void json_netjson_create_networkHeader(struct json_stream *js, char *typeStr, char *labelStr)
 {
 	assertion(-500000, (typeStr));
 
-	json_object *jObj = json_object_new_object();
+	jsw_begin(js, YES);
 
 	// Create header:
-	json_object_object_add(jObj, "type", json_object_new_string(typeStr));
+	jsw_key_string(js, "type", typeStr);
 	if (labelStr)
-		json_object_object_add(jObj, "label", json_object_new_string(labelStr));
-	json_object_object_add(jObj, "protocol", json_object_new_string(BMX_BRANCH));
-	json_object_object_add(jObj, "version", json_object_new_string(BRANCH_VERSION));
+		jsw_key_string(js, "label", labelStr);
+	jsw_key_string(js, "protocol", BMX_BRANCH);
+	jsw_key_string(js, "version", BRANCH_VERSION);
 	char revision[8];
 	snprintf(revision, sizeof(revision), "%.7x", bmx_git_rev_u32);
-	json_object_object_add(jObj, "revision", json_object_new_string(revision));
-	json_object_object_add(jObj, "metric", json_object_new_string("MBitTime"));
-	json_object_object_add(jObj, "router_id", json_object_new_string(cryptShaAsString(&myKey->kHash)));
-
-	return jObj;
+	jsw_key_string(js, "revision", revision);
+	jsw_key_string(js, "metric", "MBitTime");
+	jsw_key_string(js, "router_id", cryptShaAsString(&myKey->kHash));
 }
 
 STATIC_FUNC
 void json_netjson_create_networkGraph(void)
 {
-	json_object *jgraph = json_netjson_create_networkHeader("NetworkGraph", "BMX7 network");
+	struct json_stream *js = jsw_reset();
+	json_netjson_create_networkHeader(js, "NetworkGraph", "BMX7 network");
 
 	// Create nodes array:
-	json_object *jnodes = json_object_new_array();
+	jsw_key(js, "nodes");
+	jsw_begin(js, NO);
 	struct orig_node *on;
 	for (on = NULL; (on = avl_next_item(&orig_tree, (on ? &on->k.nodeId : NULL)));) {
 
-		json_object *jnode = json_object_new_object();
-		json_object_object_add(jnode, "id", json_object_new_string(cryptShaAsString(&on->k.nodeId)));
+		jsw_begin(js, YES);
+		jsw_key_string(js, "id", cryptShaAsString(&on->k.nodeId));
 
 		char label[MAX_HOSTNAME_LEN + 10];
 		snprintf(label, sizeof(label), "%s.%s", on->k.hostname, cryptShaAsShortStr(&on->k.nodeId));
-		json_object_object_add(jnode, "label", json_object_new_string(label));
+		jsw_key_string(js, "label", label);
 
-		json_object *jaddresses = json_object_new_array();
-		json_object_array_add(jaddresses, json_object_new_string(ip6AsStr(&on->primary_ip)));
-		json_object_object_add(jnode, "local_addresses", jaddresses);
+		jsw_key(js, "local_addresses");
+		jsw_begin(js, NO);
+		jsw_string(js, ip6AsStr(&on->primary_ip));
+		jsw_end(js);
 
-		json_object *jproperties = json_object_new_object();
-		json_object_object_add(jproperties, "hostname", json_object_new_string(on->k.hostname));
-		json_object_object_add(jproperties, "lastRef", json_object_new_int((bmx_time - on->dc->referred_by_others_timestamp) / 1000));
-		json_object_object_add(jproperties, "descSqn", json_object_new_int(on->dc->descSqn));
-		json_object_object_add(jnode, "properties", jproperties);
+		jsw_key(js, "properties");
+		jsw_begin(js, YES);
+		jsw_key_string(js, "hostname", on->k.hostname);
+		jsw_key_int(js, "lastRef", (bmx_time - on->dc->referred_by_others_timestamp) / 1000);
+		jsw_key_int(js, "descSqn", on->dc->descSqn);
+		jsw_end(js);
 
-		json_object_array_add(jnodes, jnode);
+		jsw_end(js);
 	}
-	json_object_object_add(jgraph, "nodes", jnodes);
+	jsw_end(js);
 
 	// Create links array:
-	json_object *jlinks = json_object_new_array();
+	jsw_key(js, "links");
+	jsw_begin(js, NO);
 	struct status_handl *topoHandl;
 	uint32_t topoLen;
 	if ((topoHandl = get_status_handl(ARG_TOPOLOGY)) &&
@@ -386,152 +691,270 @@ void json_netjson_create_networkGraph(void)
 		uint32_t m;
 
 		for (m = 0; m < topoMsgs; m++) {
-			json_object *jlink = json_object_new_object();
-			json_object_object_add(jlink, "source", json_object_new_string(cryptShaAsString(s[m].id)));
-			json_object_object_add(jlink, "target", json_object_new_string(cryptShaAsString(s[m].neighId)));
-			json_object_object_add(jlink, "cost", json_object_new_double(((double) (1000 * 1000)) / ((double) (s[m].txRate))));
+			jsw_begin(js, YES);
+			jsw_key_string(js, "source", cryptShaAsString(s[m].id));
+			jsw_key_string(js, "target", cryptShaAsString(s[m].neighId));
+			jsw_key_double(js, "cost", ((double) (1000 * 1000)) / ((double) (s[m].txRate)));
 			char costText[20];
 			snprintf(costText, sizeof(costText), "1/%sb/s", umetric_to_human(s[m].txRate));
-			json_object_object_add(jlink, "cost_text", json_object_new_string(costText));
-			json_object_array_add(jlinks, jlink);
+			jsw_key_string(js, "cost_text", costText);
+			jsw_end(js);
 		}
 	}
-	json_object_object_add(jgraph, "links", jlinks);
+	jsw_end(js);
 
-	json_write_file(jgraph, json_netjson_dir, "network-graph.json");
-	json_object_put(jgraph);
+	jsw_end(js);
+	json_write_str(js->buf, json_netjson_dir, "network-graph.json");
 }
 
 
 STATIC_FUNC
 void json_netjson_create_networkRoutes(void)
 {
-
-	json_object *jNetworkRoutes = json_netjson_create_networkHeader("NetworkRoutes", NULL);
+	struct json_stream *js = jsw_reset();
+	json_netjson_create_networkHeader(js, "NetworkRoutes", NULL);
 
 	// Create routes array:
-	json_object *jRoutes = json_object_new_array();
+	jsw_key(js, "routes");
+	jsw_begin(js, NO);
 	struct orig_node *on;
 	for (on = NULL; (on = avl_next_item(&orig_tree, (on ? &on->k.nodeId : NULL)));) {
 
 		LinkNode *link = on->neighPath.link;
 		if (link && link->k.myDev) {
 
-			json_object *jRoute = json_object_new_object();
+			jsw_begin(js, YES);
 
-			json_object_object_add(jRoute, "destination", json_object_new_string(ip6AsStr(&on->primary_ip)));
-			json_object_object_add(jRoute, "destination_id", json_object_new_string(cryptShaAsString(&on->k.nodeId)));
+			jsw_key_string(js, "destination", ip6AsStr(&on->primary_ip));
+			jsw_key_string(js, "destination_id", cryptShaAsString(&on->k.nodeId));
 			char label[MAX_HOSTNAME_LEN + 10];
 			snprintf(label, sizeof(label), "%s.%s", on->k.hostname, cryptShaAsShortStr(&on->k.nodeId));
-			json_object_object_add(jRoute, "destination_label", json_object_new_string(label));
+			jsw_key_string(js, "destination_label", label);
 
-			json_object_object_add(jRoute, "next", json_object_new_string(ip6AsStr(&link->k.linkDev->key.llocal_ip)));
-			json_object_object_add(jRoute, "next_id", json_object_new_string(cryptShaAsString(&link->k.linkDev->key.local->on->k.nodeId)));
+			jsw_key_string(js, "next", ip6AsStr(&link->k.linkDev->key.llocal_ip));
+			jsw_key_string(js, "next_id", cryptShaAsString(&link->k.linkDev->key.local->on->k.nodeId));
 			char nextLabel[MAX_HOSTNAME_LEN + 10];
 			snprintf(nextLabel, sizeof(nextLabel), "%s.%s",
 				strlen(link->k.linkDev->key.local->on->k.hostname) ? link->k.linkDev->key.local->on->k.hostname : DBG_NIL,
 				cryptShaAsShortStr(&link->k.linkDev->key.local->on->k.nodeId));
-			json_object_object_add(jRoute, "next_label", json_object_new_string(nextLabel));
+			jsw_key_string(js, "next_label", nextLabel);
 
-			json_object_object_add(jRoute, "cost", json_object_new_double(((double) (1000 * 1000)) / ((double) (on->neighPath.um))));
+			jsw_key_double(js, "cost", ((double) (1000 * 1000)) / ((double) (on->neighPath.um)));
 			char costText[20];
 			snprintf(costText, sizeof(costText), "1/%sb/s", umetric_to_human(on->neighPath.um));
-			json_object_object_add(jRoute, "cost_text", json_object_new_string(costText));
-			json_object_object_add(jRoute, "hops", json_object_new_int(on->ogmHopCount));
+			jsw_key_string(js, "cost_text", costText);
+			jsw_key_int(js, "hops", on->ogmHopCount);
 
-			json_object_object_add(jRoute, "device", json_object_new_string(link->k.myDev->ifname_device.str));
+			jsw_key_string(js, "device", link->k.myDev->ifname_device.str);
 
-			json_object_array_add(jRoutes, jRoute);
+			jsw_end(js);
 		}
 
 	}
-	json_object_object_add(jNetworkRoutes, "routes", jRoutes);
+	jsw_end(js);
 
-	json_write_file(jNetworkRoutes, json_netjson_dir, "network-routes.json");
-	json_object_put(jNetworkRoutes);
+	jsw_end(js);
+	json_write_str(js->buf, json_netjson_dir, "network-routes.json");
 }
 
 STATIC_FUNC
-void json_generic_event_hook(char *statusKey)
+void json_generic_write(char *statusKey)
 {
-	if (!json_update_interval || terminating)
-		return;
-
 	char path_name[MAX_PATH_SIZE];
+	char tmp_name[MAX_PATH_SIZE];
 	sprintf(path_name, "%s/%s", json_dir, statusKey);
+	json_tmp_path(tmp_name, path_name);
 	int fd;
 
-	if ((fd = open(path_name, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) >= 0) {
-		struct ctrl_node *cn = create_ctrl_node(fd, NULL, YES/*we are root*/);
+	if ((fd = open(tmp_name, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) >= 0) {
+		struct ctrl_node *cn = create_ctrl_node(dup(fd), NULL, YES/*we are root*/);
 		check_apply_parent_option(ADD, OPT_APPLY, 0, get_option(0, 0, ARG_JSON_STATUS), statusKey, cn);
 		close_ctrl_node(CTRL_CLOSE_STRAIGHT, cn);
+
+		// the status is rendered by the ctrl code straight into the file, so hash what was written
+		char buff[4096];
+		ssize_t len, total = 0;
+		CRYPTSHA_T hash;
+		memset(&hash, 0, sizeof(hash));
+
+		lseek(fd, 0, SEEK_SET);
+		while ((len = read(fd, buff, sizeof(buff))) > 0) {
+			if (total)
+				cryptShaUpdate(buff, len);
+			else
+				cryptShaNew(buff, len);
+			total += len;
+		}
+		if (total)
+			cryptShaFinal(&hash);
+
+		close(fd);
+
+		if (json_file_changed(path_name, &hash))
+			json_rename_file(tmp_name, path_name);
+		else
+			unlink(tmp_name);
+
 	} else {
-		dbgf_sys(DBGT_ERR, "could not open %s - %s", path_name, strerror(errno));
+		dbgf_sys(DBGT_ERR, "could not open %s - %s", tmp_name, strerror(errno));
 	}
 }
 
 STATIC_FUNC
-void json_dev_event_hook(int32_t cb_id, void* data)
+void json_originator_write(struct orig_node *on)
 {
-	json_generic_event_hook(ARG_INTERFACES);
+	struct status_handl *handl;
+	uint32_t data_len;
+	struct json_stream *js = jsw_reset();
+
+	if ((handl = get_status_handl(ARG_ORIGINATORS)) &&
+		(data_len = ((*(handl->frame_creator))(handl, on->kn))) &&
+		fields_dbg_json(js, FIELD_RELEVANCE_MEDI, NO, data_len, handl->data, handl->min_msg_size, handl->format)) {
+
+		json_write_str(js->buf, json_orig_dir, cryptShaAsString(&on->k.nodeId));
+	}
 }
 
 STATIC_FUNC
-void json_config_event_hook(int32_t cb_id, void *data)
+void json_flush(void *unused)
+{
+	prof_start(json_flush, main);
+	assertion(-502811, (json_flush_pending));
+
+	uint8_t dirty = json_dirty;
+	uint32_t origs = 0;
+	uint32_t writes = json_stats.writes;
+	uint32_t avoided = json_stats.avoided;
+	struct json_dirty_node *dn;
+	struct orig_node *on;
+
+	json_dirty = 0;
+	json_flush_pending = NO;
+	json_flush_stamp = bmx_time;
+	json_stats.flushes++;
+
+	if (json_update_interval) {
+
+		if (dirty & JSON_DIRTY_PARAMETERS)
+			update_json_options(0, 1, JSON_PARAMETERS_FILE);
+		if (dirty & JSON_DIRTY_STATUS)
+			json_generic_write(ARG_STATUS);
+		if (dirty & JSON_DIRTY_INTERFACES)
+			json_generic_write(ARG_INTERFACES);
+		if (dirty & JSON_DIRTY_LINKS)
+			json_generic_write(ARG_LINKS);
+	}
+
+	if (dirty & JSON_DIRTY_ORIGS) {
+
+		struct avl_node *it = NULL;
+		while ((on = avl_iterate_item(&orig_tree, &it))) {
+			json_originator_write(on);
+			origs++;
+		}
+	}
+
+	while ((dn = avl_remove_first_item(&json_dirty_tree, -300891))) {
+
+		if (!(dirty & JSON_DIRTY_ORIGS) && (on = avl_find_item(&orig_tree, &dn->nodeId))) {
+			json_originator_write(on);
+			origs++;
+		}
+
+		debugFree(dn, -300892);
+	}
+
+	if (dirty & JSON_DIRTY_GRAPH)
+		json_netjson_create_networkGraph();
+	if (dirty & JSON_DIRTY_ROUTES)
+		json_netjson_create_networkRoutes();
+
+	dbgf_track(DBGT_INFO, "dirty=0x%X origs=%d writes=%d avoided=%d", dirty, origs,
+		json_stats.writes - writes, json_stats.avoided - avoided);
+
+	prof_stop();
+}
+
+STATIC_FUNC
+void json_schedule(uint8_t dirty)
 {
-	if (!json_update_interval || terminating)
+	if (terminating || !json_dir)
 		return;
 
-	update_json_options(0, 1, JSON_PARAMETERS_FILE);
-	json_generic_event_hook(ARG_INTERFACES);
+	json_dirty |= dirty;
+
+	if (json_flush_pending) {
+		json_stats.coalesced++;
+		return;
+	}
+
+	TIME_T since = bmx_time - json_flush_stamp;
+
+	json_flush_pending = YES;
+	task_register((json_flush_stamp && since < (TIME_T) json_flush_interval) ? (json_flush_interval - since) : 0,
+		json_flush, NULL, -300893);
+}
+
+STATIC_FUNC
+void json_schedule_originator(struct orig_node *on)
+{
+	if (!(json_dirty & JSON_DIRTY_ORIGS) && !avl_find(&json_dirty_tree, &on->k.nodeId)) {
+
+		struct json_dirty_node *dn = debugMallocReset(sizeof(struct json_dirty_node), -300889);
+		dn->nodeId = on->k.nodeId;
+		avl_insert(&json_dirty_tree, dn, -300890);
+	}
+
+	json_schedule(0);
+}
+
+STATIC_FUNC
+void json_dev_event_hook(int32_t cb_id, void* data)
+{
+	if (json_update_interval)
+		json_schedule(JSON_DIRTY_INTERFACES);
+}
+
+STATIC_FUNC
+void json_config_event_hook(int32_t cb_id, void *data)
+{
+	if (json_update_interval)
+		json_schedule(JSON_DIRTY_PARAMETERS | JSON_DIRTY_INTERFACES);
 }
 
 STATIC_FUNC
 void json_status_event_hook(int32_t cb_id, void* data)
 {
-	json_generic_event_hook(ARG_STATUS);
+	if (json_update_interval)
+		json_schedule(JSON_DIRTY_STATUS);
 }
 
 STATIC_FUNC
 void json_links_event_hook(int32_t cb_id, void* data)
 {
-	json_generic_event_hook(ARG_LINKS);
+	if (json_update_interval)
+		json_schedule(JSON_DIRTY_LINKS);
 }
 
 STATIC_FUNC
-void json_originator_event_hook(int32_t cb_id, struct orig_node *orig)
+void json_originator_event_hook(int32_t cb_id, struct orig_node *on)
 {
 	assertion(-501272, (json_orig_dir));
 	assertion(-501347, (cb_id == PLUGIN_CB_DESCRIPTION_DESTROY || cb_id == PLUGIN_CB_DESCRIPTION_CREATED));
-
-	struct orig_node *on;
+	assertion(-502812, (on));
 
 	if (cb_id == PLUGIN_CB_DESCRIPTION_DESTROY) {
 
-		if ((on = orig))
-			json_write_file(NULL, json_orig_dir, cryptShaAsString(&on->k.nodeId));
+		struct json_dirty_node *dn;
 
-	} else {
-
-		struct avl_node *it = NULL;
-		while ((on = orig ? orig : avl_iterate_item(&orig_tree, &it))) {
-
-			struct status_handl *handl;
-			uint32_t data_len;
-			json_object *jorig_fields;
+		if ((dn = avl_remove(&json_dirty_tree, &on->k.nodeId, -300891)))
+			debugFree(dn, -300892);
 
-			if ((handl = get_status_handl(ARG_ORIGINATORS)) &&
-				(data_len = ((*(handl->frame_creator))(handl, on->kn))) &&
-				(jorig_fields = fields_dbg_json(FIELD_RELEVANCE_MEDI, NO,
-				data_len, handl->data, handl->min_msg_size, handl->format))) {
+		json_write_file(NULL, json_orig_dir, cryptShaAsString(&on->k.nodeId));
 
-				json_write_file(jorig_fields, json_orig_dir, cryptShaAsString(&on->k.nodeId));
-				json_object_put(jorig_fields);
-			}
+	} else {
 
-			if (orig)
-				break;
-		}
+		json_schedule_originator(on);
 	}
 }
 
@@ -539,20 +962,11 @@ STATIC_FUNC
 void json_route_change_hook(uint8_t del, struct orig_node *on)
 {
 	if (!del) {
-		json_originator_event_hook(PLUGIN_CB_DESCRIPTION_CREATED, on);
-		json_netjson_create_networkRoutes();
+		json_schedule_originator(on);
+		json_schedule(JSON_DIRTY_ROUTES);
 	}
 }
 
-
-STATIC_FUNC
-void json_netjson_event_hook(void)
-{
-	json_netjson_create_networkGraph();
-	json_netjson_create_networkRoutes();
-}
-
-
 STATIC_FUNC
 void json_description_event_hook(int32_t cb_id, struct orig_node *on)
 {
@@ -568,8 +982,9 @@ void json_description_event_hook(int32_t cb_id, struct orig_node *on)
 		json_write_file(NULL, json_desc_dir, cryptShaAsString(&on->k.nodeId));
 
 	} else {
-		json_object *jorig = json_object_new_object();
-		json_object_object_add(jorig, "descSha", json_object_new_string(cryptShaAsString(&on->dc->dHash)));
+		struct json_stream *js = jsw_reset();
+		jsw_begin(js, YES);
+		jsw_key_string(js, "descSha", cryptShaAsString(&on->dc->dHash));
 
 		struct desc_content *dc = on->dc;
 		if (dc && dc->contentRefs_tree.items && !dc->unresolvedContentCounter) {
@@ -585,7 +1000,7 @@ void json_description_event_hook(int32_t cb_id, struct orig_node *on)
 				.op = TLV_OP_PLUGIN_MIN, .db = description_tlv_db, .process_filter = DEF_DESCRIPTION_TYPE, .f_type = -1, };
 
 			int32_t result;
-			json_object *jextensions = NULL;
+			IDM_T jextensions = NO;
 			while ((result = rx_frame_iterate(&it)) > TLV_RX_DATA_DONE) {
 
 				dbgf_track(DBGT_INFO, "%s=%d (%s%s length=%d%s):",
@@ -597,15 +1012,31 @@ void json_description_event_hook(int32_t cb_id, struct orig_node *on)
 					);
 
 				if (it.f_msg && it.f_handl && it.f_msgs_len) {
-					json_object * jext_fields;
 
-					if (it.f_handl->msg_format && it.f_handl->min_msg_size && (jext_fields = fields_dbg_json(
-						FIELD_RELEVANCE_MEDI, YES, it.f_msgs_len, it.f_msg, it.f_handl->min_msg_size, it.f_handl->msg_format))) {
+					if (it.f_handl->msg_format && it.f_handl->min_msg_size) {
 
-						json_object *jext = json_object_new_object();
-						json_object_object_add(jext, it.f_handl->name, jext_fields);
-						jextensions = jextensions ? jextensions : json_object_new_array();
-						json_object_array_add(jextensions, jext);
+						uint32_t len = js->len;
+						uint32_t items = js->items[js->depth - 1];
+
+						if (!jextensions) {
+							jsw_key(js, "extensions");
+							jsw_begin(js, NO);
+						}
+
+						jsw_begin(js, YES);
+
+						if (fields_dbg_json_member(js, it.f_handl->name,
+							FIELD_RELEVANCE_MEDI, YES, it.f_msgs_len, it.f_msg, it.f_handl->min_msg_size, it.f_handl->msg_format)) {
+
+							jsw_end(js);
+							jextensions = YES;
+
+						} else {
+							// nothing relevant, drop the opened extension (and extensions array)
+							js->buf[(js->len = len)] = 0;
+							js->depth -= (jextensions ? 1 : 2);
+							js->items[js->depth - 1] = items;
+						}
 
 					} /*else {
 						json_object *jext = json_object_new_object();
@@ -618,17 +1049,16 @@ void json_description_event_hook(int32_t cb_id, struct orig_node *on)
 				}
 			}
 			if (jextensions)
-				json_object_object_add(jorig, "extensions", jextensions);
+				jsw_end(js);
 
 		}
 
-		json_write_file(jorig, json_desc_dir, cryptShaAsString(&on->k.nodeId));
-
-		json_object_put(jorig);
+		jsw_end(js);
+		json_write_str(js->buf, json_desc_dir, cryptShaAsString(&on->k.nodeId));
 	}
 
 	json_originator_event_hook(cb_id, on);
-	json_netjson_event_hook();
+	json_schedule(JSON_DIRTY_GRAPH | JSON_DIRTY_ROUTES);
 }
 
 STATIC_FUNC
@@ -640,11 +1070,8 @@ void update_json_status(void *data)
 
 	task_register(json_update_interval, update_json_status, NULL, -300378);
 
-	json_status_event_hook(0, NULL);
-	json_dev_event_hook(0, NULL);
-	json_links_event_hook(0, NULL);
-	json_originator_event_hook(PLUGIN_CB_DESCRIPTION_CREATED, NULL);
-	json_netjson_create_networkRoutes();
+	// files whose content did not change are not rewritten
+	json_schedule(JSON_DIRTY_STATUS | JSON_DIRTY_INTERFACES | JSON_DIRTY_LINKS | JSON_DIRTY_ORIGS | JSON_DIRTY_ROUTES);
 	prof_stop();
 }
 
@@ -662,19 +1089,15 @@ int32_t opt_json_status(uint8_t cmd, uint8_t _save, struct opt_type *opt, struct
 
 			if (cmd == OPT_APPLY && (data_len = ((*(handl->frame_creator))(handl, NULL)))) {
 
-				json_object *jstat = json_object_new_object();
-				json_object *jstat_fields = NULL;
+				struct json_stream *js = jsw_reset();
 
-				if ((jstat_fields = fields_dbg_json(relevance, handl->multiline,
-					data_len, handl->data, handl->min_msg_size, handl->format))) {
-
-					json_object_object_add(jstat, handl->status_name, jstat_fields);
-				}
+				jsw_begin(js, YES);
+				fields_dbg_json_member(js, handl->status_name, relevance, handl->multiline,
+					data_len, handl->data, handl->min_msg_size, handl->format);
+				jsw_end(js);
 
 				if (cn)
-					dbg_printf(cn, "%s\n", json_object_to_json_string(jstat));
-
-				json_object_put(jstat);
+					dbg_printf(cn, "%s\n", js->buf);
 			}
 
 		} else {
@@ -767,6 +1190,12 @@ static struct opt_type json_options[]= {
 	{ODI,0,ARG_JSON_UPDATE,		0,  9,2,A_PS1,A_ADM,A_DYI,A_CFA,A_ANY,	&json_update_interval,	MIN_JSON_UPDATE,MAX_JSON_UPDATE,DEF_JSON_UPDATE,0,opt_json_update_interval,
                 ARG_VALUE_FORM, "disable or periodically update json-status files every given milliseconds."}
         ,
+	{ODI,0,ARG_JSON_FLUSH,		0,  9,2,A_PS1,A_ADM,A_DYI,A_CFA,A_ANY,	&json_flush_interval,	MIN_JSON_FLUSH,MAX_JSON_FLUSH,DEF_JSON_FLUSH,0,0,
+                ARG_VALUE_FORM, "minimum milliseconds between two rewrites of changed json files (0: once per event-loop round)"}
+        ,
+	{ODI,0,ARG_JSON_STATS,		0,  9,2,A_PS0N,A_USR,A_DYN,A_ARG,A_ANY,	0,		0, 		0,		0,0, 		opt_status,
+			0,		"show json file write statistics\n"}
+        ,
 	{ODI,0,ARG_JSON_STATUS,		0,  9,2,A_PS1N,A_USR,A_DYI,A_ARG,A_ANY,	0,		0, 		0,		0,0, 		opt_json_status,
 			0,		"show status in json format\n"}
         ,
@@ -775,13 +1204,51 @@ static struct opt_type json_options[]= {
 };
 static void json_cleanup(void)
 {
+	struct json_file_node *fn;
+	struct json_dirty_node *dn;
+
 	if (current_update_interval) {
 		set_route_change_hooks(json_route_change_hook, DEL);
 	}
+
+	if (json_flush_pending)
+		task_remove(json_flush, NULL);
+
+	while ((dn = avl_remove_first_item(&json_dirty_tree, -300891)))
+		debugFree(dn, -300892);
+
+	while ((fn = avl_remove_first_item(&json_file_tree, -300887)))
+		debugFree(fn, -300888);
+
+	if (json_stream.buf)
+		debugFree(json_stream.buf, -300896);
+
+	memset(&json_stream, 0, sizeof(json_stream));
+}
+
+static const struct field_format json_stats_format[] = {
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT, json_stats, flushes,   1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT, json_stats, coalesced, 1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT, json_stats, writes,    1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT, json_stats, avoided,   1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT, json_stats, removes,   1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT, json_stats, files,     1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_END
+};
+
+static int32_t json_stats_creator(struct status_handl *handl, void *data)
+{
+	struct json_stats *status = (struct json_stats *) (handl->data = debugRealloc(handl->data, sizeof(struct json_stats), -300894));
+
+	*status = json_stats;
+	status->files = json_file_tree.items;
+
+	return sizeof(struct json_stats);
 }
 
 static int32_t json_init(void)
 {
+	register_status_handl(sizeof(struct json_stats), 0, json_stats_format, ARG_JSON_STATS, json_stats_creator);
 	register_options_array(json_options, sizeof( json_options), CODE_CATEGORY_NAME);
 
 	return SUCCESS;
@@ -36,3 +36,30 @@
 #define DEF_JSON_UPDATE 60000
 #define MIN_JSON_UPDATE 0
 #define MAX_JSON_UPDATE REGISTER_TASK_TIMEOUT_MAX
+
+#define ARG_JSON_FLUSH "jsonFlushInterval"
+#define DEF_JSON_FLUSH 100
+#define MIN_JSON_FLUSH 0
+#define MAX_JSON_FLUSH 100000
+
+#define ARG_JSON_STATS "jsonStats"
+
+#define JSON_STREAM_SIZE 4096
+#define JSON_STREAM_DEPTH 16
+
+#define JSON_DIRTY_STATUS     0x01
+#define JSON_DIRTY_INTERFACES 0x02
+#define JSON_DIRTY_LINKS      0x04
+#define JSON_DIRTY_PARAMETERS 0x08
+#define JSON_DIRTY_ORIGS      0x10 // all originators, otherwise only those in json_dirty_tree
+#define JSON_DIRTY_GRAPH      0x20
+#define JSON_DIRTY_ROUTES     0x40
+
+struct json_stats {
+	uint32_t flushes;
+	uint32_t coalesced;
+	uint32_t writes;
+	uint32_t avoided;
+	uint32_t removes;
+	uint32_t files;
+};
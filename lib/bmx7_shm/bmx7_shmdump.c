@@ -0,0 +1,121 @@
+/*
+ * Copyright (c) 2010  Axel Neumann
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+/*
+ * bmx7-shmdump: print the tables of the bmx7 shared-memory status snapshot.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <stdint.h>
+
+#include "shm.h"
+
+#define DEF_SHMDUMP_FILE "/var/run/bmx7/" BMX7_SHM_FILE
+
+static void dump_table(struct bmx7_shm_reader *r, const struct bmx7_shm_table *t)
+{
+	const char *str = bmx7_shm_first(r, t);
+	uint32_t row, col;
+
+	printf("%s: (rows=%u)\n", t->name, t->rows);
+
+	for (row = 0; row <= t->rows; row++) {
+		for (col = 0; col < t->columns; col++, str = bmx7_shm_next(str))
+			printf("%s%s", col ? "\t" : "", str);
+		printf("\n");
+	}
+}
+
+static void dump(struct bmx7_shm_reader *r, int argc, char **argv)
+{
+	const struct bmx7_shm_table *t;
+	uint32_t i;
+	int a;
+
+	printf("# seq=%u updates=%u stamp=%u pid=%u tables=%u\n",
+		r->hdr.seq, r->hdr.updates, r->hdr.stamp, r->hdr.pid, r->hdr.tables);
+
+	if (optind >= argc) {
+		for (i = 0; (t = bmx7_shm_table_idx(r, i)); i++)
+			dump_table(r, t);
+	} else {
+		for (a = optind; a < argc; a++) {
+			if ((t = bmx7_shm_table(r, argv[a])))
+				dump_table(r, t);
+			else
+				fprintf(stderr, "no table %s\n", argv[a]);
+		}
+	}
+
+	fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = DEF_SHMDUMP_FILE;
+	struct bmx7_shm_reader r;
+	int watch_ms = 0;
+	int opt, ret;
+
+	while ((opt = getopt(argc, argv, "f:w:h")) != -1) {
+		switch (opt) {
+		case 'f':
+			path = optarg;
+			break;
+		case 'w':
+			watch_ms = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-f file] [-w milliseconds] [table...]\n"
+				"  -f  snapshot file (default: %s)\n"
+				"  -w  keep polling and print every new snapshot\n", argv[0], DEF_SHMDUMP_FILE);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	if (bmx7_shm_open(&r, path) != 0) {
+		fprintf(stderr, "could not open %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	do {
+		if ((ret = bmx7_shm_read(&r)) < 0 && watch_ms && errno == ENOENT) {
+			// daemon (re)starting, wait for its new file
+			ret = 0;
+		} else if (ret < 0) {
+			fprintf(stderr, "could not read %s: %s\n", path, strerror(errno));
+			bmx7_shm_close(&r);
+			return 1;
+		}
+
+		if (ret > 0)
+			dump(&r, argc, argv);
+
+		if (watch_ms)
+			usleep(watch_ms * 1000);
+
+	} while (watch_ms);
+
+	bmx7_shm_close(&r);
+	return 0;
+}
@@ -0,0 +1,303 @@
+/*
+ * Copyright (c) 2010  Axel Neumann
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+
+#include "list.h"
+#include "control.h"
+#include "bmx.h"
+#include "crypt.h"
+#include "avl.h"
+#include "node.h"
+#include "link.h"
+#include "plugin.h"
+#include "schedule.h"
+#include "tools.h"
+#include "ip.h"
+#include "allocate.h"
+#include "prof.h"
+#include "shm.h"
+
+
+#define CODE_CATEGORY_NAME "shm"
+
+static int32_t shm_update_interval = DEF_SHM_UPDATE;
+static int32_t current_update_interval = 0;
+
+static char *shm_tables[] = { ARG_STATUS, ARG_INTERFACES, ARG_LINKS, ARG_ORIGINATORS };
+
+static char shm_path[MAX_PATH_SIZE];
+static int shm_fd = -1;
+static struct bmx7_shm_header *shm_hdr = NULL;
+static uint32_t shm_map_len = 0;
+
+// staging buffer, the snapshot is rendered here and copied into the mapping under the seqlock
+static char *shm_buf = NULL;
+static uint32_t shm_buf_len = 0;
+static uint32_t shm_buf_size = 0;
+
+STATIC_FUNC
+void shm_reserve(uint32_t len)
+{
+	if (shm_buf_len + len > shm_buf_size) {
+		shm_buf_size = XMAX(shm_buf_len + len, XMAX(2 * shm_buf_size, SHM_MIN_SIZE));
+		shm_buf = debugRealloc(shm_buf, shm_buf_size, -300897);
+	}
+}
+
+STATIC_FUNC
+void shm_append_str(const char *str)
+{
+	uint32_t len = strlen(str) + 1;
+
+	shm_reserve(len);
+	memcpy(shm_buf + shm_buf_len, str, len);
+	shm_buf_len += len;
+}
+
+STATIC_FUNC
+IDM_T shm_render_table(uint32_t idx, char *name)
+{
+	struct status_handl *handl;
+	struct bmx7_shm_table *t;
+	uint32_t data_len, c;
+
+	if (!(handl = get_status_handl(name)))
+		return NO;
+
+	uint32_t offset = shm_buf_len;
+	uint32_t columns = field_format_get_items(handl->format);
+	uint32_t rows = 0;
+
+	for (c = 0; c < columns; c++)
+		shm_append_str(handl->format[c].field_name);
+
+	if ((data_len = ((*(handl->frame_creator))(handl, NULL)))) {
+
+		struct field_iterator it = { .format = handl->format, .data = handl->data, .data_size = data_len, .min_msg_size = handl->min_msg_size };
+
+		while (field_iterate(&it) == SUCCESS) {
+
+			rows += (it.field == 0);
+			shm_append_str(field_dbg_value(&handl->format[it.field], handl->min_msg_size, handl->data, it.field_bit_pos, it.field_bits));
+		}
+	}
+
+	t = ((struct bmx7_shm_table *) shm_buf) + idx;
+	memset(t, 0, sizeof(*t));
+	strncpy(t->name, name, sizeof(t->name) - 1);
+	t->columns = columns;
+	t->rows = rows;
+	t->offset = offset;
+	t->len = shm_buf_len - offset;
+
+	return YES;
+}
+
+STATIC_FUNC
+void shm_close(void)
+{
+	if (shm_hdr) {
+		__atomic_store_n(&shm_hdr->seq, shm_hdr->seq + 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_RELEASE);
+		shm_hdr->pid = 0;
+		__atomic_store_n(&shm_hdr->seq, shm_hdr->seq + 1, __ATOMIC_RELEASE);
+
+		munmap(shm_hdr, shm_map_len);
+		shm_hdr = NULL;
+		shm_map_len = 0;
+	}
+
+	if (shm_fd >= 0) {
+		close(shm_fd);
+		unlink(shm_path);
+		shm_fd = -1;
+	}
+}
+
+STATIC_FUNC
+IDM_T shm_map(uint32_t len)
+{
+	void *map;
+
+	if (ftruncate(shm_fd, len) != 0 ||
+		(map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0)) == MAP_FAILED) {
+
+		dbgf_sys(DBGT_ERR, "could not map %s len=%d: %s", shm_path, len, strerror(errno));
+		return FAILURE;
+	}
+
+	if (shm_hdr)
+		munmap(shm_hdr, shm_map_len);
+
+	shm_hdr = map;
+	shm_map_len = len;
+	return SUCCESS;
+}
+
+STATIC_FUNC
+IDM_T shm_open_file(void)
+{
+	assertion(-502816, (shm_fd < 0 && !shm_hdr));
+
+	sprintf(shm_path, "%s/%s", run_dir, BMX7_SHM_FILE);
+
+	// readers still mapping a previous instance keep their (stale) copy
+	unlink(shm_path);
+
+	if ((shm_fd = open(shm_path, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH)) < 0) {
+		dbgf_sys(DBGT_ERR, "could not create %s: %s", shm_path, strerror(errno));
+		return FAILURE;
+	}
+
+	if (shm_map(SHM_MIN_SIZE) == FAILURE) {
+		shm_close();
+		return FAILURE;
+	}
+
+	memset(shm_hdr, 0, sizeof(*shm_hdr));
+	shm_hdr->version = BMX7_SHM_VERSION;
+	shm_hdr->headerLen = sizeof(*shm_hdr);
+	shm_hdr->mapLen = shm_map_len;
+	shm_hdr->pid = getpid();
+	__atomic_store_n(&shm_hdr->magic, BMX7_SHM_MAGIC, __ATOMIC_RELEASE);
+
+	return SUCCESS;
+}
+
+STATIC_FUNC
+void shm_update(void *unused)
+{
+	prof_start(shm_update, main);
+	assertion(-502817, (shm_update_interval && shm_hdr));
+
+	uint32_t t, tables = 0;
+	uint32_t max = sizeof(shm_tables) / sizeof(shm_tables[0]);
+
+	task_register(shm_update_interval, shm_update, NULL, -300898);
+
+	shm_buf_len = 0;
+	shm_reserve(max * sizeof(struct bmx7_shm_table));
+	shm_buf_len = max * sizeof(struct bmx7_shm_table);
+
+	// slots of unavailable tables are never rendered, don't leak heap content into the file
+	memset(shm_buf, 0, shm_buf_len);
+
+	for (t = 0; t < max; t++)
+		tables += shm_render_table(tables, shm_tables[t]);
+
+	uint32_t need = sizeof(struct bmx7_shm_header) + shm_buf_len;
+	uint32_t seq = shm_hdr->seq;
+
+	// grown mappings stay valid for readers, the file never shrinks while we run
+	if (need > shm_map_len && shm_map(((need + (need / 2)) / SHM_MIN_SIZE + 1) * SHM_MIN_SIZE) == FAILURE) {
+		prof_stop();
+		return;
+	}
+
+	__atomic_store_n(&shm_hdr->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	memcpy(((char*) shm_hdr) + sizeof(struct bmx7_shm_header), shm_buf, shm_buf_len);
+	shm_hdr->mapLen = shm_map_len;
+	shm_hdr->dataLen = shm_buf_len;
+	shm_hdr->tables = tables;
+	shm_hdr->stamp = bmx_time;
+	shm_hdr->updates++;
+
+	__atomic_store_n(&shm_hdr->seq, seq + 2, __ATOMIC_RELEASE);
+
+	dbgf_all(DBGT_INFO, "tables=%d len=%d map=%d", tables, shm_buf_len, shm_map_len);
+	prof_stop();
+}
+
+STATIC_FUNC
+int32_t opt_shm_update_interval(uint8_t cmd, uint8_t _save, struct opt_type *opt, struct opt_parent *patch, struct ctrl_node *cn)
+{
+	if (cmd == OPT_SET_POST && current_update_interval != shm_update_interval) {
+
+		if (current_update_interval) {
+			task_remove(shm_update, NULL);
+			shm_close();
+		}
+
+		if (shm_update_interval) {
+
+			if (shm_open_file() == FAILURE)
+				return FAILURE;
+
+			task_register(0, shm_update, NULL, -300899);
+		}
+
+		current_update_interval = shm_update_interval;
+	}
+
+	return SUCCESS;
+}
+
+static struct opt_type shm_options[]= {
+//        ord parent long_name          shrt Attributes				*ival		min		max		default		*func,*syntax,*help
+
+	{ODI,0,ARG_SHM_UPDATE,		0,  9,2,A_PS1,A_ADM,A_DYI,A_CFA,A_ANY,	&shm_update_interval,	MIN_SHM_UPDATE,MAX_SHM_UPDATE,DEF_SHM_UPDATE,0,opt_shm_update_interval,
+                ARG_VALUE_FORM, "disable or periodically publish status tables to "BMX7_SHM_FILE" in the runtime dir every given milliseconds."}
+};
+
+static void shm_cleanup(void)
+{
+	if (current_update_interval)
+		task_remove(shm_update, NULL);
+
+	shm_close();
+
+	if (shm_buf)
+		debugFree(shm_buf, -300900);
+
+	shm_buf = NULL;
+	shm_buf_len = shm_buf_size = 0;
+}
+
+static int32_t shm_init(void)
+{
+	register_options_array(shm_options, sizeof( shm_options), CODE_CATEGORY_NAME);
+
+	return SUCCESS;
+}
+
+struct plugin* get_plugin(void)
+{
+	static struct plugin shm_plugin;
+
+	memset(&shm_plugin, 0, sizeof( struct plugin));
+
+	shm_plugin.plugin_name = CODE_CATEGORY_NAME;
+	shm_plugin.plugin_size = sizeof( struct plugin);
+	shm_plugin.cb_init = shm_init;
+	shm_plugin.cb_cleanup = shm_cleanup;
+
+	return &shm_plugin;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (c) 2010  Axel Neumann
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+/*
+ * Shared-memory status snapshot.
+ *
+ * The daemon periodically renders a set of status tables into
+ * <runDir>/shm_status. Local readers map that file read-only and copy a
+ * consistent snapshot without any syscall or wakeup of the daemon.
+ *
+ * Layout: struct bmx7_shm_header, followed by tables x struct
+ * bmx7_shm_table, followed by the table strings. Each table holds
+ * columns NUL-terminated column names followed by rows x columns
+ * NUL-terminated values.
+ *
+ * Consistency is provided by a seqlock: seq is odd while the daemon
+ * updates the snapshot. The file only grows while a daemon instance runs,
+ * a restarted daemon replaces it with a new file.
+ *
+ * This header is shared by the plugin and the reader library, it must not
+ * depend on bmx7 core headers.
+ */
+
+#ifndef _BMX7_SHM_H
+#define _BMX7_SHM_H
+
+#include <stdint.h>
+
+#define BMX7_SHM_FILE "shm_status"
+#define BMX7_SHM_MAGIC 0x626d7837 // "bmx7"
+#define BMX7_SHM_VERSION 1
+#define BMX7_SHM_NAME_LEN 32
+
+struct bmx7_shm_header {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t headerLen;
+	uint32_t seq;     // odd while the snapshot is being updated
+	uint32_t mapLen;  // current file size, readers remap when it grows
+	uint32_t dataLen; // snapshot bytes following the header
+	uint32_t tables;
+	uint32_t updates;
+	uint32_t stamp;   // daemon uptime of the snapshot in ms
+	uint32_t pid;     // zero once the daemon terminated
+};
+
+struct bmx7_shm_table {
+	char name[BMX7_SHM_NAME_LEN];
+	uint32_t columns;
+	uint32_t rows;
+	uint32_t offset; // of the first column name, relative to the end of the header
+	uint32_t len;
+};
+
+
+// reader library (shm_reader.c):
+
+struct bmx7_shm_reader {
+	char *path;
+	uint64_t ino;               // of the opened file, a restarted daemon creates a new one
+	int fd;
+	void *map;
+	uint32_t mapLen;
+	uint32_t seq;
+	struct bmx7_shm_header hdr; // of the last snapshot copy
+	char *data;                 // last consistent snapshot copy
+	uint32_t dataSize;
+};
+
+int bmx7_shm_open(struct bmx7_shm_reader *r, const char *path);
+int bmx7_shm_read(struct bmx7_shm_reader *r);
+const struct bmx7_shm_table *bmx7_shm_table(struct bmx7_shm_reader *r, const char *name);
+const struct bmx7_shm_table *bmx7_shm_table_idx(struct bmx7_shm_reader *r, uint32_t idx);
+const char *bmx7_shm_first(struct bmx7_shm_reader *r, const struct bmx7_shm_table *t);
+const char *bmx7_shm_next(const char *str);
+void bmx7_shm_close(struct bmx7_shm_reader *r);
+
+
+// plugin:
+
+#define ARG_SHM_UPDATE "shmUpdateInterval"
+#define DEF_SHM_UPDATE 1000
+#define MIN_SHM_UPDATE 0
+#define MAX_SHM_UPDATE 3600000
+
+#define SHM_MIN_SIZE 65536
+
+#endif
@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2010  Axel Neumann
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of version 2 of the GNU General Public
+ * License as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA
+ * 02110-1301, USA
+ */
+
+/*
+ * Reader library for the bmx7 shared-memory status snapshot, see shm.h.
+ * It only depends on libc so it can be linked into external tools.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "shm.h"
+
+#define BMX7_SHM_READ_RETRIES 1000
+
+static int bmx7_shm_map(struct bmx7_shm_reader *r)
+{
+	struct stat st;
+
+	if (fstat(r->fd, &st) != 0 || st.st_size < (off_t) sizeof(struct bmx7_shm_header))
+		return -1;
+
+	if (r->map)
+		munmap(r->map, r->mapLen);
+
+	r->mapLen = st.st_size;
+	r->ino = st.st_ino;
+
+	if ((r->map = mmap(NULL, r->mapLen, PROT_READ, MAP_SHARED, r->fd, 0)) == MAP_FAILED) {
+		r->map = NULL;
+		r->mapLen = 0;
+		return -1;
+	}
+
+	return 0;
+}
+
+int bmx7_shm_open(struct bmx7_shm_reader *r, const char *path)
+{
+	memset(r, 0, sizeof(*r));
+
+	if (!(r->path = strdup(path)) || (r->fd = open(path, O_RDONLY)) < 0) {
+		free(r->path);
+		memset(r, 0, sizeof(*r));
+		r->fd = -1;
+		return -1;
+	}
+
+	if (bmx7_shm_map(r) != 0 || ((struct bmx7_shm_header *) r->map)->magic != BMX7_SHM_MAGIC) {
+		bmx7_shm_close(r);
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * A terminated daemon zeroes the pid and unlinks the file, a restarted one
+ * creates a new file. Switches to that one or fails with ENOENT while there
+ * is none, instead of returning the stale snapshot of the old mapping.
+ */
+static int bmx7_shm_reopen(struct bmx7_shm_reader *r)
+{
+	struct bmx7_shm_reader n;
+	struct stat st;
+
+	if (stat(r->path, &st) == 0 && st.st_ino == r->ino) {
+
+		if (((struct bmx7_shm_header *) r->map)->pid)
+			return 0;
+
+		errno = ENOENT;
+		return -1;
+	}
+
+	if (bmx7_shm_open(&n, r->path) != 0) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	bmx7_shm_close(r);
+	*r = n;
+	return 0;
+}
+
+/*
+ * Copies the current snapshot if it changed since the last call.
+ * Returns 1 for a new snapshot, 0 if unchanged, and -1 if no consistent
+ * snapshot could be obtained.
+ */
+int bmx7_shm_read(struct bmx7_shm_reader *r)
+{
+	int tries;
+
+	if (bmx7_shm_reopen(r) != 0)
+		return -1;
+
+	for (tries = 0; tries < BMX7_SHM_READ_RETRIES; tries++) {
+
+		struct bmx7_shm_header *h = r->map;
+		struct bmx7_shm_header hdr;
+		uint32_t seq = __atomic_load_n(&h->seq, __ATOMIC_ACQUIRE);
+
+		if (seq & 1)
+			continue;
+
+		if (r->data && seq == r->seq)
+			return 0;
+
+		memcpy(&hdr, h, sizeof(hdr));
+
+		if (hdr.mapLen > r->mapLen) {
+			if (bmx7_shm_map(r) != 0)
+				return -1;
+			continue;
+		}
+
+		if (hdr.magic != BMX7_SHM_MAGIC || hdr.version != BMX7_SHM_VERSION ||
+			hdr.headerLen < sizeof(hdr) || hdr.headerLen + hdr.dataLen > r->mapLen)
+			continue;
+
+		if (hdr.dataLen > r->dataSize) {
+			char *data = realloc(r->data, hdr.dataLen);
+			if (!data)
+				return -1;
+			r->data = data;
+			r->dataSize = hdr.dataLen;
+		}
+
+		memcpy(r->data, ((char*) r->map) + hdr.headerLen, hdr.dataLen);
+
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (__atomic_load_n(&h->seq, __ATOMIC_RELAXED) != seq)
+			continue;
+
+		r->seq = seq;
+		r->hdr = hdr;
+		return 1;
+	}
+
+	errno = EAGAIN;
+	return -1;
+}
+
+const struct bmx7_shm_table *bmx7_shm_table_idx(struct bmx7_shm_reader *r, uint32_t idx)
+{
+	const struct bmx7_shm_table *t;
+
+	if (!r->data || idx >= r->hdr.tables || (idx + 1) * sizeof(*t) > r->hdr.dataLen)
+		return NULL;
+
+	t = ((const struct bmx7_shm_table *) r->data) + idx;
+
+	if (!t->len || t->offset + t->len > r->hdr.dataLen || r->data[t->offset + t->len - 1])
+		return NULL;
+
+	return t;
+}
+
+const struct bmx7_shm_table *bmx7_shm_table(struct bmx7_shm_reader *r, const char *name)
+{
+	const struct bmx7_shm_table *t;
+	uint32_t i;
+
+	for (i = 0; (t = bmx7_shm_table_idx(r, i)); i++) {
+		if (!strncmp(t->name, name, sizeof(t->name)))
+			return t;
+	}
+
+	return NULL;
+}
+
+/*
+ * Returns the first column name of the table. The following columns - 1
+ * names and rows x columns values are reached with bmx7_shm_next().
+ */
+const char *bmx7_shm_first(struct bmx7_shm_reader *r, const struct bmx7_shm_table *t)
+{
+	return r->data + t->offset;
+}
+
+const char *bmx7_shm_next(const char *str)
+{
+	return str + strlen(str) + 1;
+}
+
+void bmx7_shm_close(struct bmx7_shm_reader *r)
+{
+	if (r->map)
+		munmap(r->map, r->mapLen);
+
+	if (r->fd >= 0)
+		close(r->fd);
+
+	free(r->data);
+	free(r->path);
+	memset(r, 0, sizeof(*r));
+	r->fd = -1;
+}
@@ -69,53 +69,98 @@ struct tunXin6_net_adv_node * table_net_adv_list = NULL;
 int32_t rtredist_delay = DEF_REDIST_DELAY;
 int32_t rtfilter_delay = DEF_FILTER_DELAY;
 
+/*
+ * Only redist_in_nodes changed since the last run are processed (redist_dirty).
+ * Each maps onto the reference count of its redist_out_node so that aggregation
+ * and advertisement generation are only redone if the set of referenced
+ * out keys changed. Flapping routes whose key is still referenced by other routes
+ * (or filtered by redistTableInDelay) do not touch our description.
+ */
+static struct redist_in_node **redist_dirty = NULL;
+static uint32_t redist_dirty_items = 0;
+static uint32_t redist_dirty_size = 0;
+static IDM_T redist_force = NO;
+
+static struct redist_table_status redist_stats;
+
+#define RESYNC_IDLE    0
+#define RESYNC_PENDING 1
+#define RESYNC_DUMPING 2
+
+// while not idle the in/out trees are being rebuilt and nothing is published
+static uint8_t resync_state = RESYNC_IDLE;
+
+STATIC_FUNC
+void redist_set_dirty(struct redist_in_node *rin)
+{
+	if (rin->dirty)
+		return;
+
+	if (redist_dirty_items >= redist_dirty_size) {
+		redist_dirty_size = redist_dirty_size ? (2 * redist_dirty_size) : 64;
+		redist_dirty = debugRealloc(redist_dirty, redist_dirty_size * sizeof(struct redist_in_node *), -300879);
+	}
+
+	rin->dirty = YES;
+	redist_dirty[redist_dirty_items++] = rin;
+}
+
+STATIC_FUNC
+void redist_flush_in_tree(void)
+{
+	while (redist_in_tree.items)
+		debugFree(avl_remove_first_item(&redist_in_tree, -300487), -300488);
+
+	redist_dirty_items = 0;
+	redist_in_flush(&redist_out_tree);
+	redist_force = YES;
+}
+
 STATIC_FUNC
 void redist_table_routes(void)
 {
-	IDM_T forceChanged = NO;
+	IDM_T changed = redist_force;
 	struct redist_in_node *rin;
-	struct redist_in_node rii;
-	struct avl_node *an = NULL;
-	memset(&rii, 0, sizeof(rii));
+	uint32_t i;
 
 	prof_start(redist_table_routes, main);
 
-	for (an = NULL; (rin = avl_iterate_item(&redist_in_tree, &an));) {
+	redist_stats.runs++;
+
+	for (i = 0; i < redist_dirty_items; i++) {
+
+		rin = redist_dirty[i];
+		rin->dirty = NO;
 
 		ASSERTION(-502300, matching_redist_opt(rin, &redist_opt_tree));
 
-		if (!forceChanged && rin->old != (!!rin->cnt))
-			forceChanged = YES;
+		if (rin->old != (rin->cnt > 0)) {
+			redist_stats.changes++;
+			changed |= redist_in_update(&redist_out_tree, rin, rin->old ? DEL : ADD);
+			rin->old = !rin->old;
+		}
 
-		if (rin->cnt <= 0) {
-			an = an->left;
+		if (rin->cnt <= 0)
 			debugFree(avl_remove(&redist_in_tree, &rin->k, -300551), -300554);
-		}
 	}
-/*
-		while ((rin = avl_next_item(&redist_in_tree, &rii.k))) {
-			rii = *rin;
 
-			ASSERTION(-502300, matching_redist_opt(rin, &redist_opt_tree, rtredist_rt_dict));
+	redist_dirty_items = 0;
+	redist_force = NO;
 
-			if (!forceChanged && rin->old != (!!rin->cnt))
-				forceChanged = YES;
+	if (changed) {
 
-			if (rin->cnt <= 0)
-				debugFree( avl_remove(&redist_in_tree, &rin->k, -300551), -300554);
-		}
-	 */
-	if (forceChanged || (redist_in_tree.items == 0 && redist_out_tree.items)) {
-		if (redistribute_routes(&redist_out_tree, &redist_in_tree, &redist_opt_tree))
+		redist_stats.recomputes++;
+
+		if (redistribute_routes(&redist_out_tree)) {
+			redist_stats.descUpdates++;
 			update_tunXin6_net_adv_list(&redist_out_tree, &table_net_adv_list);
+		}
 	}
 
-	for (an = NULL; ((rin = avl_iterate_item(&redist_in_tree, &an)));)
-		rin->old = 1;
-
-	dbgf(forceChanged ? DBGL_SYS : DBGL_CHANGES, DBGT_INFO, " %sCHANGED out.items=%d in.items=%d opt.items=%d",
-		forceChanged ? "" : "UN",
-		redist_out_tree.items, redist_in_tree.items, redist_opt_tree.items);
+	dbgf(changed ? DBGL_SYS : DBGL_CHANGES, DBGT_INFO, " %sCHANGED out.items=%d in.items=%d opt.items=%d runs=%d changes=%d recomputes=%d descUpdates=%d",
+		changed ? "" : "UN",
+		redist_out_tree.items, redist_in_tree.items, redist_opt_tree.items,
+		redist_stats.runs, redist_stats.changes, redist_stats.recomputes, redist_stats.descUpdates);
 
 	prof_stop();
 }
@@ -133,7 +178,8 @@ void schedule_table_routes(void* nowPtr)
 		scheduled_table_routes = NO;
 		task_remove(schedule_table_routes, (void*) YES);
 
-		redist_table_routes();
+		if (resync_state == RESYNC_IDLE)
+			redist_table_routes();
 
 	} else if (!scheduled_table_routes) {
 
@@ -146,7 +192,8 @@ void schedule_table_routes(void* nowPtr)
 #define FILTER_TMP_RT_CHANGES_CHECK ((void*)0)
 #define FILTER_TMP_RT_CHANGES_PURGE ((void*)1)
 #define FILTER_TMP_RT_CHANGES_NOW ((void*)2)
-#define FILTER_TMP_RT_CHANGES_MAX ((void*)2)
+#define FILTER_TMP_RT_CHANGES_RESUME ((void*)3)
+#define FILTER_TMP_RT_CHANGES_MAX ((void*)3)
 
 STATIC_FUNC
 void filter_temporary_route_changes(void *newP)
@@ -161,7 +208,8 @@ void filter_temporary_route_changes(void *newP)
 	dbgf_track(DBGT_INFO, "%s cnt=%d net=%s",
 		newP == FILTER_TMP_RT_CHANGES_PURGE ? "purge" :
 		(newP == FILTER_TMP_RT_CHANGES_NOW ? "now" :
-		(newP == FILTER_TMP_RT_CHANGES_CHECK ? "check" : "new")),
+		(newP == FILTER_TMP_RT_CHANGES_RESUME ? "resume" :
+		(newP == FILTER_TMP_RT_CHANGES_CHECK ? "check" : "new"))),
 		(newP > FILTER_TMP_RT_CHANGES_MAX) ? new->cnt : 0,
 		(newP > FILTER_TMP_RT_CHANGES_MAX) ? netAsStr(&new->k.net) : NULL);
 
@@ -190,6 +238,8 @@ void filter_temporary_route_changes(void *newP)
 				avl_insert(&redist_in_tree, rin, -300553);
 			}
 
+			redist_set_dirty(rin);
+
 			debugFree(rfn, -300774);
 		}
 
@@ -232,6 +282,7 @@ void filter_temporary_route_changes(void *newP)
 					avl_insert(&redist_in_tree, rin, -300553);
 				}
 
+				redist_set_dirty(rin);
 				schedule_table_routes((void*) NO);
 				debugFree(avl_remove(&redist_filter_tree, &rfn->k, -300775), -300776);
 
@@ -245,6 +296,17 @@ void filter_temporary_route_changes(void *newP)
 		while (redist_filter_tree.items)
 			debugFree(avl_remove_first_item(&redist_filter_tree, -300777), -300778);
 
+	} else if (newP == FILTER_TMP_RT_CHANGES_RESUME) {
+
+		struct avl_node *an = NULL;
+
+		// let the routes of a finished resync become due together
+		while ((rfn = avl_iterate_item(&redist_filter_tree, &an)))
+			rfn->stamp = bmx_time;
+
+		if (!redist_filter_tree.items)
+			schedule_table_routes((void*) NO);
+
 	} else if (newP > FILTER_TMP_RT_CHANGES_MAX) {
 
 		if ((rfn = avl_find_item(&redist_filter_tree, &new->k))) {
@@ -265,7 +327,7 @@ void filter_temporary_route_changes(void *newP)
 
 	}
 
-	if (redist_filter_tree.items) {
+	if (redist_filter_tree.items && resync_state == RESYNC_IDLE) {
 		if (!scheduled) {
 			scheduled = YES;
 			task_register(next_check, filter_temporary_route_changes, FILTER_TMP_RT_CHANGES_CHECK, -300781);
@@ -309,82 +371,230 @@ void get_route_list_nlhdr(struct nlmsghdr *nh, void *unused)
 	}
 }
 
+/*
+ * Route ingestion never blocks the main loop:
+ * Event and dump sockets are non-blocking and at most REDIST_RCV_BUDGET buffers are
+ * consumed per event-loop iteration. A resync (initially, after option changes, or
+ * after an rt-event overrun) re-opens the event socket, waits REDIST_RESYNC_DELAY ms
+ * via the scheduler, and then streams one RTM_GETROUTE dump per (family, table) of
+ * the configured redistTable options. Until the last dump completed, the previously
+ * published routes stay announced. Events seen while dumping are dropped and the
+ * dump is repeated (with exponential backoff). After REDIST_RESYNC_ROUNDS disturbed
+ * dumps the last one is accepted anyway and another resync follows later.
+ */
+static int rtevent_sk = 0;
+static int rtdump_sk = 0;
+static uint8_t resync_now = NO;
+static uint8_t resync_events = NO;
+static uint32_t resync_rounds = 0;
+static uint8_t dump_family = 0;
+static int64_t dump_table = -1;
+
 STATIC_FUNC
-int32_t sync_redist_routes(IDM_T cleanup, IDM_T resync);
+void redist_resync(IDM_T now);
+
+STATIC_FUNC
+void redist_resync_followup(void *unused)
+{
+	redist_resync(NO);
+}
+
+STATIC_FUNC
+void resync_route_event(struct nlmsghdr *nh, void *unused)
+{
+	if (resync_state == RESYNC_DUMPING)
+		resync_events = YES;
+}
+
+// kernels without strict checking ignore the RTA_TABLE filter and dump all tables
+STATIC_FUNC
+void get_route_dump_nlhdr(struct nlmsghdr *nh, void *unused)
+{
+	struct rtmsg *rtm = (struct rtmsg *) NLMSG_DATA(nh);
+	struct rtattr *rtap = (struct rtattr *) RTM_RTA(rtm);
+	int rtl = RTM_PAYLOAD(nh);
+	uint32_t table = rtm->rtm_table;
+
+	for (; RTA_OK(rtap, rtl); rtap = RTA_NEXT(rtap, rtl)) {
+		if (rtap->rta_type == RTA_TABLE)
+			table = *((uint32_t*) RTA_DATA(rtap));
+	}
+
+	if (table == dump_table)
+		get_route_list_nlhdr(nh, unused);
+}
 
 static void recv_rtevent_netlink_sk(int sk)
 {
 	dbgf_all(DBGT_INFO, "detected changed routes! Going to check...");
 
-	int result = rtnl_rcv(sk, 0, 0, IP_ROUTE_GET, NO, get_route_list_nlhdr, NULL);
+	int result = rtnl_rcv_stream(sk, REDIST_RCV_BUDGET, (resync_state == RESYNC_IDLE) ? get_route_list_nlhdr : resync_route_event, NULL);
 
-	if (result != SUCCESS)
-		sync_redist_routes(NO, YES);
+	if (result == RTNL_STREAM_FAIL)
+		redist_resync(YES);
 }
 
+// returns YES if the next dump was requested, NO if all are done, or FAILURE
 STATIC_FUNC
-int32_t resync_routes(int32_t rtevent_sk)
+IDM_T redist_dump_next(void)
 {
-	const uint32_t nlgroups = nl_mgrp(RTNLGRP_IPV4_ROUTE) | nl_mgrp(RTNLGRP_IPV6_ROUTE);
+	struct redistr_opt_node *roptn;
+	struct avl_node *an;
 
-	fd_set sockset;
-	int cnt = 1;
+	while (dump_family) {
 
-	while (1) {
-		dbgf_sys(DBGT_WARN, "rt-events out of sync. Trying to resync (round=%d) ...", cnt);
+		int64_t next = -1;
 
-		if (rtevent_sk)
-			rtevent_sk = unregister_netlink_event_hook(rtevent_sk, recv_rtevent_netlink_sk);
+		for (an = NULL; (roptn = avl_iterate_item(&redist_opt_tree, &an));) {
 
-		filter_temporary_route_changes(FILTER_TMP_RT_CHANGES_PURGE);
+			if ((!roptn->net.af || roptn->net.af == dump_family) && roptn->table > dump_table && (next == -1 || roptn->table < next))
+				next = roptn->table;
+		}
 
-		while (redist_in_tree.items)
-			debugFree(avl_remove_first_item(&redist_in_tree, -300487), -300488);
+		if (next >= 0) {
 
+			dump_table = next;
+			dbgf_track(DBGT_INFO, "dumping family=%d table=%d", dump_family, (uint32_t) dump_table);
+			return kernel_dump_route_request(rtdump_sk, dump_family, dump_table) == SUCCESS ? YES : FAILURE;
+		}
 
+		dump_family = (dump_family == AF_INET) ? AF_INET6 : 0;
+		dump_table = -1;
+	}
 
-		wait_sec_usec(0, 500000);
-		dbgf_sys(DBGT_WARN, "now");
+	return NO;
+}
 
-		rtevent_sk = register_netlink_event_hook(nlgroups, netlinkBuffSize, recv_rtevent_netlink_sk);
-		assertion(-502504, (rtevent_sk > 0));
+static void recv_rtdump_netlink_sk(int sk);
 
-		kernel_get_route(NO, AF_INET, RTM_GETROUTE, 0, get_route_list_nlhdr);
-		kernel_get_route(NO, AF_INET6, RTM_GETROUTE, 0, get_route_list_nlhdr);
+STATIC_FUNC
+void redist_resync_done(void)
+{
+	rtdump_sk = unregister_netlink_event_hook(rtdump_sk, recv_rtdump_netlink_sk);
 
-		FD_ZERO(&sockset);
-		FD_SET(rtevent_sk, &sockset);
-		struct timeval to = { 0, 0 };
+	// the dump may or may not contain the concurrent changes, so it can not be trusted
+	if (resync_events && resync_rounds < REDIST_RESYNC_ROUNDS) {
+		redist_resync(resync_now);
+		return;
+	}
 
-		if (!select(rtevent_sk + 1, &sockset, NULL, NULL, &to))
-			break;
+	if (resync_events) {
+		dbgf_sys(DBGT_WARN, "accepting disturbed dump after round=%d, resyncing again in %dms",
+			resync_rounds, REDIST_RESYNC_FOLLOWUP);
+		task_register(REDIST_RESYNC_FOLLOWUP, redist_resync_followup, NULL, -300917);
+	} else {
+		dbgf_track(DBGT_INFO, "success after round=%d", resync_rounds);
+	}
 
-		cnt++;
+	resync_state = RESYNC_IDLE;
+	resync_rounds = 0;
 
-		assertion(-502505, (cnt < 100));
-	}
+	filter_temporary_route_changes(resync_now ? FILTER_TMP_RT_CHANGES_NOW : FILTER_TMP_RT_CHANGES_RESUME);
 
-	dbgf_sys(DBGT_WARN, "success");
-	return rtevent_sk;
+	resync_now = NO;
+}
 
+static void recv_rtdump_netlink_sk(int sk)
+{
+	IDM_T next;
+	int result = rtnl_rcv_stream(sk, REDIST_RCV_BUDGET, get_route_dump_nlhdr, NULL);
+
+	if (result == RTNL_STREAM_FAIL) {
+
+		redist_resync(resync_now);
+
+	} else if (result == RTNL_STREAM_DONE) {
+
+		if ((next = redist_dump_next()) == FAILURE)
+			redist_resync(resync_now);
+		else if (next == NO)
+			redist_resync_done();
+	}
 }
 
 STATIC_FUNC
-int32_t sync_redist_routes(IDM_T cleanup, IDM_T resync)
+void redist_resync_task(void *unused)
 {
-	static int rtevent_sk = 0;
+	IDM_T next;
+
+	assertion(-502806, (resync_state == RESYNC_PENDING));
+	assertion(-502807, (!rtdump_sk));
+
+	resync_state = RESYNC_DUMPING;
+	resync_events = NO;
+	dump_family = AF_INET;
+	dump_table = -1;
+
+	if ((rtdump_sk = register_netlink_dump_hook(netlinkBuffSize, recv_rtdump_netlink_sk)) <= 0) {
+		rtdump_sk = 0;
+		redist_resync(resync_now);
+	} else if ((next = redist_dump_next()) == FAILURE) {
+		redist_resync(resync_now);
+	} else if (next == NO) {
+		redist_resync_done();
+	}
+}
+
+STATIC_FUNC
+void redist_resync(IDM_T now)
+{
+	const uint32_t nlgroups = nl_mgrp(RTNLGRP_IPV4_ROUTE) | nl_mgrp(RTNLGRP_IPV6_ROUTE);
+
+	resync_now |= now;
+	resync_rounds++;
+	redist_stats.resyncs++;
 
+	dbgf_sys(DBGT_WARN, "rt-events out of sync. Trying to resync (round=%d) ...", resync_rounds);
+
+	task_remove(redist_resync_task, NULL);
+	task_remove(redist_resync_followup, NULL);
+
+	if (rtdump_sk)
+		rtdump_sk = unregister_netlink_event_hook(rtdump_sk, recv_rtdump_netlink_sk);
+
+	if (rtevent_sk)
+		rtevent_sk = unregister_netlink_event_hook(rtevent_sk, recv_rtevent_netlink_sk);
+
+	filter_temporary_route_changes(FILTER_TMP_RT_CHANGES_PURGE);
+
+	redist_flush_in_tree();
+
+	rtevent_sk = register_netlink_event_hook(nlgroups, netlinkBuffSize, recv_rtevent_netlink_sk);
+	assertion(-502504, (rtevent_sk > 0));
+
+	resync_state = RESYNC_PENDING;
+	task_register(REDIST_RESYNC_DELAY << XMIN(resync_rounds - 1, REDIST_RESYNC_ROUNDS - 1), redist_resync_task, NULL, -300882);
+}
+
+STATIC_FUNC
+void sync_redist_routes(IDM_T cleanup, IDM_T resync)
+{
 	if (cleanup) {
 
+		task_remove(redist_resync_task, NULL);
+		task_remove(redist_resync_followup, NULL);
+
+		if (rtdump_sk)
+			rtdump_sk = unregister_netlink_event_hook(rtdump_sk, recv_rtdump_netlink_sk);
+
 		rtevent_sk = unregister_netlink_event_hook(rtevent_sk, recv_rtevent_netlink_sk);
 
+		resync_state = RESYNC_IDLE;
+		resync_now = NO;
+		resync_rounds = 0;
+
 		(*set_tunXin6_net_adv_list)(DEL, (void**) &table_net_adv_list);
 
 		filter_temporary_route_changes(FILTER_TMP_RT_CHANGES_PURGE);
 
+		redist_flush_in_tree();
+		redist_force = NO;
 
-		while (redist_in_tree.items)
-			debugFree(avl_remove_first_item(&redist_in_tree, -300487), -300488);
+		if (redist_dirty) {
+			debugFree(redist_dirty, -300880);
+			redist_dirty = NULL;
+			redist_dirty_size = 0;
+		}
 
 		while (redist_out_tree.items) {
 			debugFree(avl_remove_first_item(&redist_out_tree, -300513), -300514);
@@ -398,19 +608,45 @@ int32_t sync_redist_routes(IDM_T cleanup, IDM_T resync)
 
 	} else if (resync) {
 
-		rtevent_sk = resync_routes(rtevent_sk);
-
-		filter_temporary_route_changes(FILTER_TMP_RT_CHANGES_NOW);
+		redist_resync(YES);
 
 	} else {
 
 		(*set_tunXin6_net_adv_list)(ADD, (void**) &table_net_adv_list);
 
-		rtevent_sk = resync_routes(rtevent_sk);
+		redist_resync(NO);
 	}
+}
 
+static const struct field_format redist_table_status_format[] = {
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT, redist_table_status, inRoutes,    1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT, redist_table_status, outRoutes,   1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT, redist_table_status, advRoutes,   1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT, redist_table_status, runs,        1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT, redist_table_status, changes,     1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT, redist_table_status, recomputes,  1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT, redist_table_status, descUpdates, 1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT, redist_table_status, resyncs,     1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_END
+};
+
+static int32_t redist_table_status_creator(struct status_handl *handl, void *data)
+{
+	struct redist_table_status *status = (struct redist_table_status *) (handl->data = debugRealloc(handl->data, sizeof(struct redist_table_status), -300881));
+	struct tunXin6_net_adv_node *tan;
 
-	return rtevent_sk;
+	*status = redist_stats;
+	status->inRoutes = redist_in_tree.items;
+	status->outRoutes = redist_out_tree.items;
+	status->advRoutes = 0;
+
+	for (tan = table_net_adv_list; tan; tan++) {
+		status->advRoutes++;
+		if (!tan->more)
+			break;
+	}
+
+	return sizeof(struct redist_table_status);
 }
 
 STATIC_FUNC
@@ -458,6 +694,10 @@ int32_t opt_redistribute(uint8_t cmd, uint8_t _save, struct opt_type *opt, struc
 static struct opt_type rtredist_options[]= {
 //        ord parent long_name          shrt Attributes				*ival		min		max		default		*func,*syntax,*help
 
+	{ODI,0,ARG_REDIST_STATUS,         0,9,2,A_PS0N,A_USR,A_DYN,A_ARG,A_ANY,	0,		0, 		0,		0,0, 		opt_status,
+			0,		"show table redistribution statistics\n"}
+        ,
+
         {ODI,0,ARG_FILTER_DELAY,          0,9,1, A_PS1, A_ADM, A_DYI, A_CFA, A_ANY, &rtfilter_delay,MIN_REDIST_DELAY,MAX_REDIST_DELAY,DEF_FILTER_DELAY,0,   0,
 			ARG_VALUE_FORM,	HLP_FILTER_DELAY}
         ,
@@ -498,6 +738,7 @@ static int32_t rtredist_init(void)
 		return FAILURE;
 	}
 
+	register_status_handl(sizeof(struct redist_table_status), 0, redist_table_status_format, ARG_REDIST_STATUS, redist_table_status_creator);
 	register_options_array(rtredist_options, sizeof( rtredist_options), CODE_CATEGORY_NAME);
 
 	return SUCCESS;
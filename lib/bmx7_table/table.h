@@ -21,6 +21,11 @@
 #define MAX_REDIST_DELAY  3600000
 #define DEF_REDIST_DELAY  2000
 
+#define REDIST_RCV_BUDGET    16  // netlink buffers processed per event-loop iteration
+#define REDIST_RESYNC_DELAY  500 // ms
+#define REDIST_RESYNC_ROUNDS 5 // disturbed dumps retried (with doubling delay) before one is accepted
+#define REDIST_RESYNC_FOLLOWUP 30000 // ms until an accepted disturbed dump is resynced again
+
 #define ARG_FILTER_DELAY  "redistTableInDelay"
 #define DEF_FILTER_DELAY  1000
 #define HLP_FILTER_DELAY  "delay processing of changed table routes in ms to filter shortly following changes"
@@ -28,3 +33,16 @@
 
 #define ARG_REDIST        "redistTable"
 #define HLP_REDIST        "arbitrary but unique name for redistributed table network(s) depending on sub criterias"
+
+#define ARG_REDIST_STATUS "redistTableStatus"
+
+struct redist_table_status {
+	uint32_t inRoutes;
+	uint32_t outRoutes;
+	uint32_t advRoutes;
+	uint32_t runs;
+	uint32_t changes;
+	uint32_t recomputes;
+	uint32_t descUpdates;
+	uint32_t resyncs;
+};
@@ -73,6 +73,8 @@ static AVL_TREE(tun_bit_tree, struct tun_bit_node, tunBitKey); // identified mat
 static AVL_TREE(tun_net_tree, struct tun_net_node, tunNetKey); // rcvd tun_out network advs
 static AVL_TREE(tun_out_tree, struct tun_out_node, tunOutKey); // rcvd tun_out advs
 static AVL_TREE(tun_catch_tree, struct tun_dev_node, tunCatchKey); // active tun_out tunnels
+static AVL_TREE(tun_class_tree, struct tun_bit_node, classKey); // active tun_bit_nodes indexed by masked route
+static uint32_t tun_class_masks[2][129]; // [isv4][prefixlen] number of tun_class_tree items
 
 LIST_SIMPEL(tunXin6_net_adv_list_list, struct tunXin6_net_adv_list_node, list, list);
 
@@ -274,6 +276,7 @@ uint16_t set_tun_out_mtu(char *name, uint16_t orig_mtu, uint16_t def_mtu, uint16
 
 
 #define MTU_MAX 1500
+#define TUN_CATCH_BATCH 64
 
 struct tun_packet {
 
@@ -326,7 +329,7 @@ void tun_out_state_catchAll(void *tonp)
 	IDM_T stats_captured = tdn->stats_captured;
 	unsigned long long tx_packets = tdn->stats.tx_packets;
 
-	tdn->stats_captured = kernel_get_ifstats(&tdn->stats, tdn->nameKey.str);
+	tdn->stats_captured = kernel_get_ifstats(&tdn->stats, tdn->ifIdx, tdn->nameKey.str);
 
 	if (stats_captured == SUCCESS && tdn->stats_captured == SUCCESS && tx_packets != tdn->stats.tx_packets) {
 		task_register(tun_dedicated_to, tun_out_state_catchAll, ton, -300748);
@@ -338,6 +341,76 @@ void tun_out_state_catchAll(void *tonp)
 	prof_stop();
 }
 
+STATIC_FUNC
+void tun_class_update(struct tun_bit_node *tbn)
+{
+	struct net_key *route = &tbn->tunBitKey.invRouteKey;
+	uint8_t isv4 = (route->af == AF_INET);
+	uint8_t mask = 128 - route->mask;
+
+	if (tbn->active_tdn && !tbn->classKey.tbn) {
+
+		IPX_T ip = route->ip;
+
+		ip_netmask_validate(&ip, mask, route->af, YES /*force*/);
+		tbn->classKey.net = *route;
+		tbn->classKey.net.mask = mask;
+		tbn->classKey.net.ip = ip;
+		tbn->classKey.tbn = tbn;
+
+		assertion(-502808, (!avl_find(&tun_class_tree, &tbn->classKey)));
+		avl_insert(&tun_class_tree, tbn, -300883);
+		tun_class_masks[isv4][mask]++;
+
+	} else if (!tbn->active_tdn && tbn->classKey.tbn) {
+
+		assertion(-502809, (tun_class_masks[isv4][tbn->classKey.net.mask]));
+		tun_class_masks[isv4][tbn->classKey.net.mask]--;
+		avl_remove(&tun_class_tree, &tbn->classKey, -300884);
+		memset(&tbn->classKey, 0, sizeof(tbn->classKey));
+	}
+}
+
+/*
+ * Find the active tun_bit_node whose route covers dst, preferring the one
+ * ordered first in tun_bit_tree (the same one a linear scan would pick).
+ * Only prefix lengths currently in use are probed.
+ */
+STATIC_FUNC
+struct tun_bit_node *tun_class_lookup(uint8_t af, IPX_T *dst)
+{
+	uint8_t isv4 = (af == AF_INET);
+	struct tun_bit_node *best = NULL, *tbn;
+	struct tun_class_key key;
+	IPX_T ip;
+	int16_t mask;
+
+	for (mask = (isv4 ? 32 : 128); mask >= 0; mask--) {
+
+		if (!tun_class_masks[isv4][mask])
+			continue;
+
+		ip = *dst;
+		ip_netmask_validate(&ip, mask, af, YES /*force*/);
+
+		memset(&key, 0, sizeof(key));
+		key.net.af = af;
+		key.net.mask = mask;
+		key.net.ip = ip;
+
+		while ((tbn = avl_next_item(&tun_class_tree, &key)) &&
+			!memcmp(&tbn->classKey.net, &key.net, sizeof(key.net))) {
+
+			if (!best || memcmp(&tbn->tunBitKey, &best->tunBitKey, sizeof(struct tun_bit_key)) < 0)
+				best = tbn;
+
+			key.tbn = tbn;
+		}
+	}
+
+	return best;
+}
+
 STATIC_FUNC
 void tun_out_catchAll_hook(int fd)
 {
@@ -352,7 +425,15 @@ void tun_out_catchAll_hook(int fd)
 
 
 
-	while ((tp_len = read(fd, &tp, sizeof(tp))) > 0) {
+	uint16_t packets = 0;
+	IDM_T delayed = NO;
+	uint32_t classifyMaxNs = 0;
+	uint64_t classifyNs = 0;
+
+	// drain a bounded batch per wakeup, remaining packets are picked up by the next select() round
+	while (packets < TUN_CATCH_BATCH && (tp_len = read(fd, &tp, sizeof(tp))) > 0) {
+
+		packets++;
 
 		uint8_t isv4 = (tp.t.ip4hdr.version == 4);
 		int32_t plen = -1;
@@ -383,31 +464,30 @@ void tun_out_catchAll_hook(int fd)
 				isv4 ? ip4AsStr(tp.t.ip4hdr.saddr) : ip6AsStr(&tp.t.ip6hdr.ip6_src), ipXAsStr(af, dst));
 
 			struct tun_out_node *ton = NULL;
-			struct avl_node *an = NULL;
-			struct tun_bit_node *tbn;
-			while ((tbn = avl_iterate_item(&tun_bit_tree, &an))) {
+			struct timespec t0, t1;
+			clock_gettime(CLOCK_MONOTONIC, &t0);
 
-				if (tbn->active_tdn && tbn->tunBitKey.invRouteKey.af == af) {
+			struct tun_bit_node *tbn = tun_class_lookup(af, dst);
 
-					uint8_t mask = 128 - tbn->tunBitKey.invRouteKey.mask;
+			clock_gettime(CLOCK_MONOTONIC, &t1);
+			uint32_t ns = ((t1.tv_sec - t0.tv_sec) * 1000000000) + t1.tv_nsec - t0.tv_nsec;
+			classifyNs += ns;
+			classifyMaxNs = XMAX(classifyMaxNs, ns);
 
-					if (is_ip_net_equal(dst, &tbn->tunBitKey.invRouteKey.ip, mask, af)) {
+			if (tbn) {
 
-						ton = tbn->tunBitKey.keyNodes.tnn->tunNetKey.ton;
+				ton = tbn->tunBitKey.keyNodes.tnn->tunNetKey.ton;
 
-						if (tbn->active_tdn->tunCatch_fd) {
+				if (tbn->active_tdn->tunCatch_fd) {
 
-							if (tun_proactive_routes)
-								tun_out_state_set(ton, TDN_STATE_DEDICATED);
-							else
-								configure_tun_bit(ADD, tbn, TDN_STATE_DEDICATED);
+					if (tun_proactive_routes)
+						tun_out_state_set(ton, TDN_STATE_DEDICATED);
+					else
+						configure_tun_bit(ADD, tbn, TDN_STATE_DEDICATED);
 
-						} else {
-							dbgf_track(DBGT_WARN, "tunnel dev=%s to nodeId=%s already dedicated!",
-								tbn->active_tdn->nameKey.str, cryptShaAsString(&ton->tunOutKey.on->k.nodeId));
-						}
-						break;
-					}
+				} else {
+					dbgf_track(DBGT_WARN, "tunnel dev=%s to nodeId=%s already dedicated!",
+						tbn->active_tdn->nameKey.str, cryptShaAsString(&ton->tunOutKey.on->k.nodeId));
 				}
 			}
 
@@ -423,8 +503,10 @@ void tun_out_catchAll_hook(int fd)
 
 				if (tdn && tdn->tunCatchKey.afKey == af) {
 
-					if (tun_out_delay)
+					if (tun_out_delay && !delayed) {
 						wait_sec_usec(0, tun_out_delay); //delay reschedule to complete proper tunnel-setup (e.g. local address, mtu, ...)
+						delayed = YES;
+					}
 
 					int written = write(tdn->tunCatch_fd, &tp, tp_len);
 
@@ -492,6 +574,9 @@ void tun_out_catchAll_hook(int fd)
 			}
 		}
 	}
+
+	dbgf_track(DBGT_INFO, "fd=%d packets=%d classified avgNs=%ju maxNs=%u activeRoutes=%u",
+		fd, packets, packets ? (uintmax_t) (classifyNs / packets) : 0, classifyMaxNs, tun_class_tree.items);
 }
 
 STATIC_FUNC
@@ -729,7 +814,7 @@ struct tun_dev_node *tun_dev_out_add(struct tun_bit_node *tbn, IDM_T tdn_state)
 				tdn->orig_mtu = kernel_get_mtu(tdn->nameKey.str);
 				tdn->curr_mtu = set_tun_out_mtu(tdn->nameKey.str, tdn->orig_mtu, DEF_TUN_OUT_MTU, tun_out_mtu);
 
-				tdn->stats_captured = kernel_get_ifstats(&tdn->stats, tdn->nameKey.str);
+				tdn->stats_captured = kernel_get_ifstats(&tdn->stats, tdn->ifIdx, tdn->nameKey.str);
 
 				assertion(-501485, (tdn->ifIdx > 0));
 				assertion(-501486, (tdn->orig_mtu >= MIN_TUN_OUT_MTU));
@@ -875,6 +960,8 @@ void configure_tun_bit(uint8_t del, struct tun_bit_node *tbn, IDM_T tdn_state)
 		dbgl = DBGL_ALL;
 	}
 
+	tun_class_update(tbn);
+
 	dbgf(dbgl, DBGT_INFO, "%s %s via nodeId=%s asDfltTun=%d tbn_active=%s",
 		del ? "DEL" : "ADD", netAsStr(&routeKey), cryptShaAsString(&ton->tunOutKey.on->k.nodeId),
 		tdn_state, tbn->active_tdn ? tbn->active_tdn->nameKey.str : "---");
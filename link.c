@@ -71,9 +71,25 @@ IDM_T min_lq_probe(LinkNode *link)
 		);
 }
 
+void neighs_linkMetrics_changed(struct neigh_node *onlyNeigh)
+{
+	struct avl_node *an = NULL;
+	struct neigh_node *nn;
+
+	while ((nn = onlyNeigh) || (nn = avl_iterate_item(&local_tree, &an))) {
+
+		nn->linkMetricsEpoch++;
+
+		if (onlyNeigh)
+			break;
+	}
+}
+
 STATIC_FUNC
 void upd_timeaware_rq_probe(LinkNode *link)
 {
+	LQ_T old = link->timeaware_rq_probe;
+
 	if (((TIME_T) (bmx_time - link->rq_probe_record.hello_time_max)) < ((uint32_t) link_purge_to / 10)) {
 
 		link->timeaware_rq_probe = link->rq_probe_record.hello_lq;
@@ -88,11 +104,15 @@ void upd_timeaware_rq_probe(LinkNode *link)
 
 		link->timeaware_rq_probe = 0;
 	}
+
+	if (old != link->timeaware_rq_probe)
+		neighs_linkMetrics_changed(link->k.linkDev->key.local);
 }
 
 STATIC_FUNC
 void upd_timeaware_tq_probe(LinkNode *link)
 {
+	LQ_T old = link->timeaware_tq_probe;
 
 	if (((TIME_T) (bmx_time - link->tq_probe_time)) < ((uint32_t) link_purge_to / 10)) {
 
@@ -106,6 +126,9 @@ void upd_timeaware_tq_probe(LinkNode *link)
 
 		link->timeaware_tq_probe = 0;
 	}
+
+	if (old != link->timeaware_tq_probe)
+		neighs_linkMetrics_changed(link->k.linkDev->key.local);
 }
 
 STATIC_FUNC
@@ -224,6 +247,10 @@ uint16_t purge_linkDevs(LinkDevNode *onlyLinkDev, struct dev_node *onlyDev, Link
 				dbgf_track(DBGT_INFO, "purging nbLlIp=%s nbIdx=%d dev=%s",
 					ip6AsStr(&linkDev->key.llocal_ip), linkDev->key.devIdx, link->k.myDev->ifname_label.str);
 
+				ctrl_event(CTRL_EVENT_LINKS, "link down id=%s name=%s llip=%s idx=%d dev=%s",
+					cryptShaAsString(&local->k.nodeId), local->on ? local->on->k.hostname : DBG_NIL,
+					ip6AsStr(&linkDev->key.llocal_ip), linkDev->key.devIdx, link->k.myDev->ifname_label.str);
+
 				purge_orig_router(NULL, NULL, link, NO);
 
 				purge_tx_task_tree(link, NULL, NULL, NULL, YES);
@@ -234,6 +261,8 @@ uint16_t purge_linkDevs(LinkDevNode *onlyLinkDev, struct dev_node *onlyDev, Link
 				if (link == local->best_tq_link)
 					local->best_tq_link = NULL;
 
+				neighs_linkMetrics_changed(local);
+
 				avl_remove(&link_tree, &link->k, -300221);
 				avl_remove(&linkDev->link_tree, &link->k, -300749);
 				debugFree(link, -300044);
@@ -369,8 +398,15 @@ LinkNode *getLinkNode(struct dev_node *dev, IPX_T *llip, DEVIDX_T idx, struct ne
 
 		avl_insert(&link_tree, link, -300220);
 
+		neighs_linkMetrics_changed(linkDev->key.local);
+
 		lndev_assign_best(linkDev->key.local, link);
 		cb_plugin_hooks(PLUGIN_CB_LINKS_EVENT, NULL);
+
+		ctrl_event(CTRL_EVENT_LINKS, "link up id=%s name=%s llip=%s idx=%d dev=%s",
+			cryptShaAsString(&linkDev->key.local->k.nodeId),
+			linkDev->key.local->on ? linkDev->key.local->on->k.hostname : DBG_NIL,
+			ip6AsStr(&linkDev->key.llocal_ip), linkDev->key.devIdx, dev->ifname_label.str);
 	}
 
 	assertion(-502196, (link->k.linkDev == linkDev));
@@ -388,7 +424,7 @@ void update_link_probe_record(LinkNode *link, HELLO_SQN_T sqn, uint8_t probe)
 
 	ASSERTION(-501049, ((sizeof(((struct lndev_probe_record*) NULL)->hello_array)) * 8 == MAX_HELLO_SQN_WINDOW));
 	assertion(-501050, (probe <= 1));
-	ASSERTION(-501055, (bits_get(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK) == lpr->hello_sum));
+	ASSERTION(-501055, (wbits_count(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK) == lpr->hello_sum));
 
 	if ((linkDev->hello_time_max || linkDev->hello_sqn_max) && linkDev->hello_sqn_max != sqn &&
 		((HELLO_SQN_MASK)&(linkDev->hello_sqn_max - sqn)) < HELLO_SQN_TOLERANCE)
@@ -397,55 +433,34 @@ void update_link_probe_record(LinkNode *link, HELLO_SQN_T sqn, uint8_t probe)
 
 	if (((HELLO_SQN_MASK)&(sqn - lpr->hello_sqn_max)) >= my_link_window) {
 
-		memset(lpr->hello_array, 0, MAX_HELLO_SQN_WINDOW / 8);
-
-		ASSERTION(-500159, is_zero(lpr->hello_array, MAX_HELLO_SQN_WINDOW / 8));
+		memset(lpr->hello_array, 0, sizeof(lpr->hello_array));
 
 		if (probe)
-			bit_set(lpr->hello_array, MAX_HELLO_SQN_WINDOW, sqn, 1);
+			wbit_set(lpr->hello_array, MAX_HELLO_SQN_WINDOW, sqn, 1);
 
 		lpr->hello_sum = probe;
-		dbgf_all(DBGT_INFO, "probe=%d probe_sum=%d %d",
-			probe, lpr->hello_sum, bits_get(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK));
-
-		ASSERTION(-501058, (bits_get(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK) == lpr->hello_sum));
+		dbgf_all(DBGT_INFO, "probe=%d probe_sum=%d", probe, lpr->hello_sum);
 
 	} else {
 		if (sqn != lpr->hello_sqn_max) {
 			HELLO_SQN_T prev_sqn_min = (HELLO_SQN_MASK)&(lpr->hello_sqn_max + 1 - ((HELLO_SQN_T) my_link_window));
 			HELLO_SQN_T new_sqn_min_minus_one = (HELLO_SQN_MASK)&(sqn - ((HELLO_SQN_T) my_link_window));
 
-			dbgf_all(DBGT_INFO, "prev_min=%5d prev_max=%d new_min=%5d sqn=%5d sum=%3d bits=%3d %s",
-				prev_sqn_min, lpr->hello_sqn_max, new_sqn_min_minus_one + 1, sqn, lpr->hello_sum,
-				bits_get(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK),
-				bits_print(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK));
-
-			lpr->hello_sum -= bits_get(lpr->hello_array, MAX_HELLO_SQN_WINDOW, prev_sqn_min, new_sqn_min_minus_one, HELLO_SQN_MASK);
+			lpr->hello_sum -= wbits_clear(lpr->hello_array, MAX_HELLO_SQN_WINDOW, prev_sqn_min, new_sqn_min_minus_one, HELLO_SQN_MASK);
 
-			dbgf_all(DBGT_INFO, "prev_min=%5d prev_max=%d new_min=%5d sqn=%5d sum=%3d bits=%3d %s",
+			dbgf_all(DBGT_INFO, "prev_min=%5d prev_max=%d new_min=%5d sqn=%5d sum=%3d %s",
 				prev_sqn_min, lpr->hello_sqn_max, new_sqn_min_minus_one + 1, sqn, lpr->hello_sum,
-				bits_get(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK),
-				bits_print(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK));
-
-			bits_clear(lpr->hello_array, MAX_HELLO_SQN_WINDOW, prev_sqn_min, new_sqn_min_minus_one, HELLO_SQN_MASK);
-
-			dbgf_all(DBGT_INFO, "prev_min=%5d prev_max=%d new_min=%5d sqn=%5d sum=%3d bits=%3d %s\n",
-				prev_sqn_min, lpr->hello_sqn_max, new_sqn_min_minus_one + 1, sqn, lpr->hello_sum,
-				bits_get(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK),
-				bits_print(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK));
-
+				wbits_print(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK));
 		}
 
-		ASSERTION(-501057, (bits_get(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK) == lpr->hello_sum));
-
-		if (!bit_get(lpr->hello_array, MAX_HELLO_SQN_WINDOW, sqn) && probe) {
-			bit_set(lpr->hello_array, MAX_HELLO_SQN_WINDOW, sqn, 1);
+		if (probe && !wbit_get(lpr->hello_array, MAX_HELLO_SQN_WINDOW, sqn)) {
+			wbit_set(lpr->hello_array, MAX_HELLO_SQN_WINDOW, sqn, 1);
 			lpr->hello_sum++;
 		}
-
-		ASSERTION(-501056, (bits_get(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK) == lpr->hello_sum));
 	}
 
+	ASSERTION(-501056, (wbits_count(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK) == lpr->hello_sum));
+
 	lpr->hello_sqn_max = sqn;
 	lpr->hello_lq = (LQ_MAX * ((uint32_t) lpr->hello_sum)) / ((uint32_t) my_link_window);
 	lpr->hello_time_max = bmx_time;
@@ -477,11 +492,10 @@ int32_t opt_link_metric(uint8_t cmd, uint8_t _save, struct opt_type *opt, struct
 				HELLO_SQN_T prev_sqn_min = (HELLO_SQN_MASK)&(lpr->hello_sqn_max + 1 - my_link_window_prev);
 				HELLO_SQN_T new_sqn_min_minus_one = (HELLO_SQN_MASK)&(lpr->hello_sqn_max - my_link_window);
 
-				lpr->hello_sum -= bits_get(lpr->hello_array, MAX_HELLO_SQN_WINDOW, prev_sqn_min, new_sqn_min_minus_one, HELLO_SQN_MASK);
-				bits_clear(lpr->hello_array, MAX_HELLO_SQN_WINDOW, prev_sqn_min, new_sqn_min_minus_one, HELLO_SQN_MASK);
+				lpr->hello_sum -= wbits_clear(lpr->hello_array, MAX_HELLO_SQN_WINDOW, prev_sqn_min, new_sqn_min_minus_one, HELLO_SQN_MASK);
 			}
 
-			assertion(-501053, (bits_get(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK) == lpr->hello_sum));
+			assertion(-501053, (wbits_count(lpr->hello_array, MAX_HELLO_SQN_WINDOW, 0, MAX_HELLO_SQN_WINDOW - 1, HELLO_SQN_MASK) == lpr->hello_sum));
 			assertion(-501061, (lpr->hello_sum <= ((uint32_t) my_link_window)));
 
 			lpr->hello_lq = (LQ_MAX * ((uint32_t) lpr->hello_sum)) / ((uint32_t) my_link_window);
@@ -932,7 +946,7 @@ static int32_t link_status_creator(struct status_handl *handl, void *data)
 				status[i].iidMax = linkDev->key.local->neighIID4x_repos.max_free;
 				status[i].aggSize = local->ogm_aggreg_size;
 				status[i].aggMax = local->ogm_aggreg_max;
-				status[i].aggRcvd = bit_get(local->ogm_aggreg_sqns, AGGREG_SQN_CACHE_RANGE, local->ogm_aggreg_max);
+				status[i].aggRcvd = wbit_get(local->ogm_aggreg_sqns, AGGREG_SQN_CACHE_RANGE, local->ogm_aggreg_max);
 				status[i].lastHelloSqn = linkDev->hello_sqn_max;
 				status[i].lastHelloAdv = ((TIME_T) (bmx_time - linkDev->hello_time_max)) / 1000;
 
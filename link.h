@@ -56,6 +56,7 @@ struct msg_hello_reply_dhash {
 
 //IDM_T updateNeighDevId(struct neigh_node *nn, struct desc_content *contents);
 IDM_T min_lq_probe(LinkNode *link);
+void neighs_linkMetrics_changed(struct neigh_node *onlyNeigh);
 LinkNode *getLinkNode(struct dev_node *dev, IPX_T *llip, DEVIDX_T idx, struct neigh_node *verifiedNeigh);
 uint16_t purge_linkDevs(LinkDevNode *onlyLinkDev, struct dev_node *onlyDev, LinkNode *onlyLink, IDM_T onlyExpired, IDM_T purgeLocal);
 char * getLinkKeysAsString(struct orig_node *on);
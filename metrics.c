@@ -40,6 +40,7 @@
 #include "ogm.h"
 #include "msg.h"
 #include "content.h"
+#include "link.h"
 #include "ip.h"
 #include "plugin.h"
 #include "schedule.h"
@@ -851,6 +852,8 @@ void metricalgo_assign(struct orig_node *on, struct host_metricalgo *host_algo)
 
 	on->mtcAlgo = debugMalloc(sizeof(struct host_metricalgo), -300286);
 	memcpy(on->mtcAlgo, host_algo, sizeof(struct host_metricalgo));
+
+	neighs_linkMetrics_changed(NULL);
 }
 
 STATIC_FUNC
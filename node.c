@@ -111,6 +111,8 @@ void neighRef_destroy(struct NeighRef_node *ref, IDM_T reAssessState)
 
 	iid_free(&ref->nn->neighIID4x_repos, iid_get_neighIID4x_by_node(ref));
 
+	neighRef_unrank(ref);
+
 	if (kn) {
 		struct key_credits kc = { .neighRef = ref };
 		keyNode_delCredits(NULL, kn, &kc, (reAssessState && kn != ref->nn->on->kn));
@@ -186,7 +188,7 @@ void neighRefs_resolve_or_destroy(void)
 	while ((nn = avl_next_item(&local_tree, &nid))) {
 		nid = nn->k.nodeId;
 
-		for (iid = 0; iid < nn->neighIID4x_repos.max_free; iid++) {
+		for (iid = 0; (iid = iid_next_used(&nn->neighIID4x_repos, iid + 1));) {
 
 			if ((ref = iid_get_node_by_neighIID4x(&nn->neighIID4x_repos, iid, NO)))
 				neighRef_resolve_or_destroy(ref, YES);
@@ -200,6 +202,7 @@ void set_ref_ogmSqnMaxMetric(struct NeighRef_node *ref, DESC_SQN_T descSqn, OGM_
 {
 
 	ref->reqCnt = 0;
+	ref->rankCached = NO;
 
 	if (chainOgm) {
 
@@ -544,7 +547,7 @@ void neigh_destroy(struct orig_node *on)
 
 
 	IID_T iid;
-	for (iid = 0; iid < local->neighIID4x_repos.max_free; iid++) {
+	for (iid = 0; (iid = iid_next_used(&local->neighIID4x_repos, iid + 1));) {
 		struct NeighRef_node *ref;
 		if ((ref = iid_get_node_by_neighIID4x(&local->neighIID4x_repos, iid, NO)))
 			neighRef_destroy(ref, YES);
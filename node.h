@@ -183,7 +183,7 @@ struct host_metricalgo {
 struct lndev_probe_record {
 	HELLO_SQN_T hello_sqn_max; // SQN which has been applied (if equals wa_pos) then wa_unscaled MUST NOT be set again!
 
-	uint8_t hello_array[MAX_HELLO_SQN_WINDOW / 8];
+	uint64_t hello_array[MAX_HELLO_SQN_WINDOW / WBITS_WORD_SIZE];
 	uint32_t hello_sum;
 	LQ_T hello_lq;
 	TIME_T hello_time_max;
@@ -329,10 +329,13 @@ struct neigh_node {
 
 	struct iid_repos neighIID4x_repos;
 
+	// incremented whenever metrics of any link to this neighbor change, invalidates NeighRef_node.rank:
+	uint32_t linkMetricsEpoch;
+
 	TIME_T ogm_aggreg_time;
 	AGGREG_SQN_T ogm_aggreg_max;
 	AGGREG_SQN_T ogm_aggreg_size;
-	uint8_t ogm_aggreg_sqns[(AGGREG_SQN_CACHE_RANGE / 8)];
+	uint64_t ogm_aggreg_sqns[(AGGREG_SQN_CACHE_RANGE / WBITS_WORD_SIZE)];
 };
 
 union content_sizes {
@@ -475,6 +478,15 @@ struct NeighRef_node {
 	// set by rx_frame_ogm_aggreg_adv():
 	TIME_T ogmBestSinceSqn;
 
+	// cached best path via this neighbor, set by lndev_best_via_router():
+	struct NeighPathRank {
+		UMETRIC_T umNbo; // network byte order so that key_node.neighPathRanks is ordered by metric
+		struct NeighRef_node *ref;
+	} rank;
+	LinkNode *rankLink;
+	uint32_t rankLinkMetricsEpoch;
+	uint8_t rankCached; // reset by set_ref_ogmSqnMaxMetric() or a changed neigh_node.linkMetricsEpoch
+	uint8_t ranked;
 };
 
 struct orig_node {
@@ -539,6 +551,7 @@ struct key_node {
 	TIME_T TAPTime;
 	TIME_T unReferencedTime;
 	struct avl_tree neighRefs_tree;
+	struct avl_tree neighPathRanks; // NeighRef_nodes ordered by their cached best path metric
 	struct avl_tree trustees_tree;
 	struct orig_node *on;
 	struct desc_content *nextDesc;
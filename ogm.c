@@ -58,12 +58,26 @@
 
 int32_t my_ogmInterval = DEF_OGM_INTERVAL; /* orginator message interval in miliseconds */
 static int32_t maxMyOgmIFactor = DEF_OGM_IFACTOR;
+static int32_t ogmAggregDelay = DEF_OGM_AGGREG_DELAY;
 
 
 AGGREG_SQN_T ogm_aggreg_sqn_max = 0;
 AGGREG_SQN_T ogm_aggreg_sqn_max_window_size = 0;
 AGGREG_SQN_T ogm_aggreg_sqn_send = 0;
 
+static TIME_T ogm_aggreg_open_time = 0;
+
+struct ogm_aggreg_stats ogm_aggreg_stats;
+
+// originators waiting for room in a full aggregation window:
+static AVL_TREE(ogm_backlog_tree, struct orig_node, k.nodeId);
+static TIME_T ogm_backlog_time = 0;
+
+uint32_t ogm_backlog_items(void)
+{
+	return ogm_backlog_tree.items;
+}
+
 struct OgmAggreg_node *getOgmAggregNode(AGGREG_SQN_T aggSqn)
 {
 	static struct OgmAggreg_node my_ogm_aggreg_nodes[AGGREG_SQN_CACHE_RANGE];
@@ -81,6 +95,13 @@ struct OgmAggreg_node *getOgmAggregNode(AGGREG_SQN_T aggSqn)
 
 void remove_ogm(struct orig_node *on)
 {
+	if (ogm_backlog_tree.items && avl_find(&ogm_backlog_tree, &on->k.nodeId)) {
+
+		avl_remove(&ogm_backlog_tree, &on->k.nodeId, -300856);
+
+		if (!ogm_backlog_tree.items)
+			ogm_backlog_time = 0;
+	}
 
 	if (on->ogmAggregActiveMsgLen) {
 		AGGREG_SQN_T aggregSqn = on->ogmAggregSqn;
@@ -160,6 +181,20 @@ void schedule_ogm(struct orig_node *on)
 
 		if (ogm_aggreg_sqn_max == ogm_aggreg_sqn_send) {
 
+			if (ogm_aggreg_sqn_max_window_size >= AGGREG_SQN_CACHE_RANGE &&
+				ogmAggregDelay && (!ogm_backlog_time || ((TIME_T) (bmx_time - ogm_backlog_time)) < (TIME_T) ogmAggregDelay)) {
+
+				// back-pressure: retry via revise_ogm_aggregations() once the window has room
+				if (!ogm_backlog_tree.items)
+					ogm_backlog_time = bmx_time;
+
+				avl_insert(&ogm_backlog_tree, on, -300857);
+				ogm_aggreg_stats.backlogged++;
+
+				dbgf_track(DBGT_INFO, "backlogged ogmSqn=%d hostname=%s backlog=%d", on->dc->ogmSqnMaxSend, on->k.hostname, ogm_backlog_tree.items);
+				return;
+			}
+
 			if (ogm_aggreg_sqn_max_window_size >= AGGREG_SQN_CACHE_RANGE) {
 
 				while ((oan = getOgmAggregNode(ogm_aggreg_sqn_max + 1)) && oan->tree.items) {
@@ -168,12 +203,14 @@ void schedule_ogm(struct orig_node *on)
 						o->dc->ogmSqnMaxSend, o->k.hostname, o->ogmAggregActiveMsgLen, o->ogmAggregSqn, ogm_aggreg_sqn_max);
 					assertion(-502472, (o->ogmAggregActiveMsgLen && o->ogmAggregSqn == ((AGGREG_SQN_T) (ogm_aggreg_sqn_max + 1 - AGGREG_SQN_CACHE_RANGE))));
 					remove_ogm(o);
+					ogm_aggreg_stats.dropped++;
 				}
 				assertion(-502761, (ogm_aggreg_sqn_max_window_size < AGGREG_SQN_CACHE_RANGE));
 			}
 
 			ogm_aggreg_sqn_max++;
 			ogm_aggreg_sqn_max_window_size++;
+			ogm_aggreg_open_time = bmx_time;
 		}
 
 		on->ogmAggregSqn = ogm_aggreg_sqn_max;
@@ -215,11 +252,36 @@ void schedule_my_originator_message(void)
 	}
 }
 
+STATIC_FUNC
+void drain_ogm_backlog(void)
+{
+	struct orig_node *on;
+
+	while ((on = avl_first_item(&ogm_backlog_tree))) {
+
+		if (ogm_aggreg_sqn_max == ogm_aggreg_sqn_send &&
+			ogm_aggreg_sqn_max_window_size >= AGGREG_SQN_CACHE_RANGE &&
+			((TIME_T) (bmx_time - ogm_backlog_time)) < (TIME_T) ogmAggregDelay)
+			break;
+
+		avl_remove(&ogm_backlog_tree, &on->k.nodeId, -300858);
+
+		// keep an expired ogm_backlog_time until schedule_ogm() has forced the node into an aggregation
+		schedule_ogm(on);
+	}
+
+	if (!ogm_backlog_tree.items)
+		ogm_backlog_time = 0;
+}
+
 STATIC_FUNC
 void revise_ogm_aggregations(void)
 {
 	assertion(-502276, (((AGGREG_SQN_T) (ogm_aggreg_sqn_max - ogm_aggreg_sqn_send)) <= 1));
 
+	if (ogm_backlog_tree.items)
+		drain_ogm_backlog();
+
 
 	static TIME_T myNextHitchhike = 0;
 	static TIME_T myNextGuarantee = 0;
@@ -241,7 +303,8 @@ void revise_ogm_aggregations(void)
 			myNextNow, myGuaranteedInterval, ogm_aggreg_sqn_max, ogm_aggreg_sqn_send,
 			oan->tree.items, oan->msgsLen, OGMS_DHASH_MSGS_LEN_PER_AGGREG_PREF, myKey->on->dc->ogmSqnMaxSend);
 
-		if (oan->tree.items)
+		// keep a partially filled aggregation open for a while so that more ogms share it
+		if (oan->tree.items && (myNextNow || ogm_backlog_tree.items || ((TIME_T) (bmx_time - ogm_aggreg_open_time)) >= (TIME_T) ogmAggregDelay))
 			schedule_ogm_aggregations();
 	}
 }
@@ -355,7 +418,7 @@ int32_t rx_frame_ogm_aggreg_sqn(struct rx_frame_iterator *it)
 				memset(nn->ogm_aggreg_sqns, 0, sizeof(nn->ogm_aggreg_sqns));
 
 			} else {
-				bits_clear(nn->ogm_aggreg_sqns, AGGREG_SQN_CACHE_RANGE,
+				wbits_clear(nn->ogm_aggreg_sqns, AGGREG_SQN_CACHE_RANGE,
 					((AGGREG_SQN_MASK)& (nn->ogm_aggreg_max + 1)), max, AGGREG_SQN_MASK);
 			}
 
@@ -379,11 +442,15 @@ void schedule_ogm_req(void)
 
 			AGGREG_SQN_T cnt = 0;
 
+			if (nn->ogm_aggreg_size && wbits_count(nn->ogm_aggreg_sqns, AGGREG_SQN_CACHE_RANGE,
+				((AGGREG_SQN_MASK)& (nn->ogm_aggreg_max + 1 - nn->ogm_aggreg_size)), nn->ogm_aggreg_max, AGGREG_SQN_MASK) == nn->ogm_aggreg_size)
+				continue;
+
 			for (cnt = 0; cnt < nn->ogm_aggreg_size; cnt++) {
 
 				AGGREG_SQN_T sqn = (nn->ogm_aggreg_max - cnt);
 
-				if (!bit_get(nn->ogm_aggreg_sqns, AGGREG_SQN_CACHE_RANGE, sqn)) {
+				if (!wbit_get(nn->ogm_aggreg_sqns, AGGREG_SQN_CACHE_RANGE, sqn)) {
 					struct dev_node *dev = nn->best_tq_link->k.myDev;
 					schedule_tx_task(FRAME_TYPE_OGM_REQ, NULL, &nn->k.nodeId, nn, dev, SCHEDULE_MIN_MSG_SIZE, &sqn, sizeof(sqn));
 				}
@@ -399,7 +466,7 @@ int32_t tx_msg_ogm_aggreg_request(struct tx_frame_iterator *it)
 	struct hdr_ogm_aggreg_req *hdr = (struct hdr_ogm_aggreg_req *) tx_iterator_cache_hdr_ptr(it);
 	struct msg_ogm_aggreg_req *msg = (struct msg_ogm_aggreg_req *) tx_iterator_cache_msg_ptr(it);
 
-	IDM_T known = bit_get(it->ttn->neigh->ogm_aggreg_sqns, AGGREG_SQN_CACHE_RANGE, *sqn);
+	IDM_T known = wbit_get(it->ttn->neigh->ogm_aggreg_sqns, AGGREG_SQN_CACHE_RANGE, *sqn);
 
 	dbgf_track(DBGT_INFO, "sqn=%d known=%d to neigh=%s", *sqn, known, it->ttn->neigh->on->k.hostname);
 
@@ -503,9 +570,71 @@ int32_t tx_frame_ogm_aggreg_advs(struct tx_frame_iterator *it)
 	assertion(-502666, (((uint32_t) oan->msgsLen) == ((uint32_t) (((uint8_t*) msg) - tx_iterator_cache_msg_ptr(it)))));
 	assertion(-502667, IMPLIES(oan->msgsLen, iterate_msg_ogm_adv(tx_iterator_cache_msg_ptr(it), oan->msgsLen, 0, YES, NULL, NULL) == oan->msgsLen));
 
+	// ogm frames of one packet are written back to back, so any other previous type means a new packet:
+	if (it->prev_out_type != FRAME_TYPE_OGM_ADV)
+		ogm_aggreg_stats.packets++;
+
+	ogm_aggreg_stats.aggregs++;
+
 	return oan->msgsLen;
 }
 
+static struct route_eval_stats routeEvalsCurr;
+static struct route_eval_stats routeEvalsLast;
+static TIME_SEC_T routeEvalsSec = 0;
+
+STATIC_FUNC
+struct route_eval_stats *route_evals_upd(void)
+{
+	if (routeEvalsSec != bmx_time_sec) {
+
+		if (((TIME_SEC_T) (bmx_time_sec - routeEvalsSec)) == 1)
+			routeEvalsLast = routeEvalsCurr;
+		else
+			memset(&routeEvalsLast, 0, sizeof(routeEvalsLast));
+
+		memset(&routeEvalsCurr, 0, sizeof(routeEvalsCurr));
+		routeEvalsSec = bmx_time_sec;
+	}
+
+	return &routeEvalsCurr;
+}
+
+struct route_eval_stats *get_route_eval_stats(void)
+{
+	route_evals_upd();
+	return &routeEvalsLast;
+}
+
+void neighRef_unrank(struct NeighRef_node *ref)
+{
+	if (ref->ranked) {
+		assertion(-502788, (ref->kn));
+		avl_remove(&ref->kn->neighPathRanks, &ref->rank, -300854);
+		ref->ranked = NO;
+	}
+
+	ref->rankCached = NO;
+	ref->rankLink = NULL;
+}
+
+STATIC_FUNC
+void neighRef_rank(struct NeighRef_node *ref, LinkNode *link, UMETRIC_T um)
+{
+	neighRef_unrank(ref);
+
+	ref->rankCached = YES;
+	ref->rankLinkMetricsEpoch = ref->nn->linkMetricsEpoch;
+	ref->rankLink = link;
+
+	if (link) {
+		ref->rank.umNbo = hton64(um);
+		ref->rank.ref = ref;
+		avl_insert(&ref->kn->neighPathRanks, ref, -300855);
+		ref->ranked = YES;
+	}
+}
+
 STATIC_FUNC
 struct NeighPath *lndev_best_via_router(struct NeighRef_node *ref)
 {
@@ -539,8 +668,27 @@ struct NeighPath *lndev_best_via_router(struct NeighRef_node *ref)
 		on->mtcAlgo->umetric_min, ref->ogmSqnMax, dc->ogmSqnMaxSend, on->neighPath.um,
 		on->mtcAlgo->ogm_sqn_late_hystere_100ms, on->mtcAlgo->ogm_metric_hystere_new_path, ref->ogmBestSinceSqn);
 
-	if (!neighTrust || !newOgmMins || refMetric < on->mtcAlgo->umetric_min || refMetric == UMETRIC_MIN__NOT_ROUTABLE || !ref->ogmSqnMaxClaimedHops)
+	route_evals_upd()->evals++;
+
+	if (!neighTrust || !newOgmMins || refMetric < on->mtcAlgo->umetric_min || refMetric == UMETRIC_MIN__NOT_ROUTABLE || !ref->ogmSqnMaxClaimedHops) {
+		neighRef_unrank(ref);
+		return &bestNeighPath;
+	}
+
+	if (ref->rankCached && ref->rankLinkMetricsEpoch == nn->linkMetricsEpoch) {
+
+		routeEvalsCurr.cached++;
+
+		if (ref->rankLink) {
+			routeEvalsCurr.algos++;
+			bestNeighPath = *apply_metric_algo(ref, ref->rankLink, on->mtcAlgo);
+
+			if (!bestNeighPath.link || hton64(bestNeighPath.um) != ref->rank.umNbo)
+				neighRef_rank(ref, bestNeighPath.link, bestNeighPath.um);
+		}
+
 		return &bestNeighPath;
+	}
 
 	while ((linkDev = avl_iterate_item(&nn->linkDev_tree, &linkDev_an))) {
 
@@ -554,6 +702,8 @@ struct NeighPath *lndev_best_via_router(struct NeighRef_node *ref)
 
 				struct NeighPath *tmpNeighPath = apply_metric_algo(ref, link, on->mtcAlgo);
 
+				routeEvalsCurr.algos++;
+
 				if (tmpNeighPath->um > bestNeighPath.um)
 					bestNeighPath = *tmpNeighPath;
 
@@ -563,12 +713,35 @@ struct NeighPath *lndev_best_via_router(struct NeighRef_node *ref)
 		}
 	}
 
+	neighRef_rank(ref, bestNeighPath.link, bestNeighPath.um);
+
 	return &bestNeighPath;
 }
 
+/*
+ * After the current path of an originator got worse, only the best ranked alternative
+ * neighbor needs to be re-evaluated instead of waiting for its next OGM.
+ */
+STATIC_FUNC
+struct NeighRef_node *neighRef_ranked_alternative(struct NeighRef_node *ref, UMETRIC_T oldUm)
+{
+	struct orig_node *on = ref->kn->on;
+	struct NeighRef_node *alt = avl_last_item(&ref->kn->neighPathRanks);
+
+	if (!alt || alt == ref || on->neighPath.um >= oldUm || ntoh64(alt->rank.umNbo) <= on->neighPath.um)
+		return NULL;
+
+	dbgf_track(DBGT_INFO, "to id=%s degraded %ju->%ju, trying ranked neigh=%s rankMtc=%ju",
+		cryptShaAsShortStr(&on->k.nodeId), oldUm, on->neighPath.um, cryptShaAsShortStr(&alt->nn->k.nodeId), ntoh64(alt->rank.umNbo));
+
+	return alt;
+}
+
 void process_ogm_metric(void *voidRef)
 {
 	prof_start(process_ogm_metric, main);
+	static uint8_t rankedRecursion = NO;
+	struct NeighRef_node *alt = NULL;
 	struct NeighRef_node *ref = voidRef;
 	struct orig_node *on = NULL;
 	struct desc_content *dc = NULL;
@@ -603,6 +776,7 @@ void process_ogm_metric(void *voidRef)
 		assertion(-502675, (ref->ogmSqnMax >= dc->ogmSqnMaxSend));
 
 		struct NeighPath *bestNeighPath = lndev_best_via_router(ref);
+		UMETRIC_T oldUm = on->neighPath.um;
 
 		dbgf_track(DBGT_INFO, "to id=%s hostname=%s currMetric=%s=%ju minMetric=%ju ogmSqnMaxSend=%d currNeigh=%s  viaNeigh=%s bestMtcViaNeigh=%ju ogmSqn=%d ogmSqnBestSince=%d",
 			cryptShaAsShortStr(&on->k.nodeId), on->k.hostname, umetric_to_human(on->neighPath.um), on->neighPath.um, UMETRIC_MIN__NOT_ROUTABLE, dc->ogmSqnMaxSend,
@@ -658,6 +832,8 @@ void process_ogm_metric(void *voidRef)
 
 			ref->ogmBestSinceSqn = 0;
 
+			alt = neighRef_ranked_alternative(ref, oldUm);
+
 		} else {
 			if ((ref->ogmSqnMax >= (dc->ogmSqnMaxSend + 1)) && (bestNeighPath->um > on->mtcAlgo->umetric_min) && (((TIME_T) (bmx_time - ref->ogmSqnMaxTime)) < (100 * on->mtcAlgo->ogm_sqn_late_hystere_100ms))) {
 				ref->scheduled_ogm_processing = YES;
@@ -674,6 +850,13 @@ void process_ogm_metric(void *voidRef)
 		}
 	}
 	prof_stop();
+
+	if (alt && !rankedRecursion) {
+		routeEvalsCurr.ranked++;
+		rankedRecursion = YES;
+		process_ogm_metric(alt);
+		rankedRecursion = NO;
+	}
 }
 
 STATIC_FUNC
@@ -683,7 +866,7 @@ int32_t rx_frame_ogm_aggreg_advs(struct rx_frame_iterator *it)
 	struct hdr_ogm_adv *hdr = ((struct hdr_ogm_adv*) it->f_data);
 	AGGREG_SQN_T aggSqn = ntohs(hdr->aggregation_sqn);
 	struct neigh_node *nn = it->pb->i.verifiedLink->k.linkDev->key.local;
-	IDM_T new = ((AGGREG_SQN_T) (nn->ogm_aggreg_max - aggSqn)) < nn->ogm_aggreg_size && !bit_get(nn->ogm_aggreg_sqns, AGGREG_SQN_CACHE_RANGE, aggSqn);
+	IDM_T new = ((AGGREG_SQN_T) (nn->ogm_aggreg_max - aggSqn)) < nn->ogm_aggreg_size && !wbit_get(nn->ogm_aggreg_sqns, AGGREG_SQN_CACHE_RANGE, aggSqn);
 	int32_t processed;
 
 	dbgf_track(DBGT_INFO, "new=%d neigh=%s aggSqn=%d/%d/%d size=%d",
@@ -691,7 +874,7 @@ int32_t rx_frame_ogm_aggreg_advs(struct rx_frame_iterator *it)
 
 	if (new) {
 
-		bit_set(nn->ogm_aggreg_sqns, AGGREG_SQN_CACHE_RANGE, aggSqn, 1);
+		wbit_set(nn->ogm_aggreg_sqns, AGGREG_SQN_CACHE_RANGE, aggSqn, 1);
 
 		if (!it->f_msg || !it->f_msgs_len)
 			return TLV_RX_DATA_PROCESSED;
@@ -767,6 +950,9 @@ STATIC_FUNC
 	struct opt_type ogm_options[] ={
 	{ODI, 0, ARG_OGM_IFACTOR, 0, 9, 1, A_PS1, A_ADM, A_DYI, A_CFA, A_ANY, &maxMyOgmIFactor, MIN_OGM_IFACTOR, MAX_OGM_IFACTOR, DEF_OGM_IFACTOR, 0, 0,
 		ARG_VALUE_FORM, "set factor (relative to ogmInterval) for max delay of own ogms" },
+	{ODI, 0, ARG_OGM_AGGREG_DELAY, 0, 9, 1, A_PS1, A_ADM, A_DYI, A_CFA, A_ANY, &ogmAggregDelay, MIN_OGM_AGGREG_DELAY, MAX_OGM_AGGREG_DELAY, DEF_OGM_AGGREG_DELAY, 0, 0,
+		ARG_VALUE_FORM, "set time in ms a partially filled ogm aggregation is kept open for further ogms\n"
+		"	and ogms wait for room in a full aggregation window, 0 disables both" },
 #ifdef WITH_DEVEL
 	{ODI, 0, "fakeOgmAggSqn", 0, 9, 0, A_PS1, A_ADM, A_DYN, A_ARG, A_ANY, NULL, 0, ((AGGREG_SQN_T) - 1), 0, 0, opt_fake_agg_sqns,
 		NULL, "exceed ogm aggregation sqn range" },
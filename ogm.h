@@ -39,10 +39,24 @@ extern int32_t my_ogmInterval;
 #define DEF_OGM_AGGREG_HISTORY 20
 #define ARG_OGM_AGGREG_HISTORY "ogmAggregHistory"
 
+#define ARG_OGM_AGGREG_DELAY "ogmAggregDelay"
+#define DEF_OGM_AGGREG_DELAY 0
+#define MIN_OGM_AGGREG_DELAY 0
+#define MAX_OGM_AGGREG_DELAY 2000
+
 extern AGGREG_SQN_T ogm_aggreg_sqn_max;
 extern AGGREG_SQN_T ogm_aggreg_sqn_max_window_size;
 extern AGGREG_SQN_T ogm_aggreg_sqn_send;
 
+struct ogm_aggreg_stats {
+	uint32_t aggregs;     // sent ogm aggregations
+	uint32_t packets;     // sent packets containing ogm aggregations
+	uint32_t backlogged;  // ogms deferred because the aggregation window was full
+	uint32_t dropped;     // ogms removed from the aggregation window before being replaced
+};
+
+extern struct ogm_aggreg_stats ogm_aggreg_stats;
+
 
 #define FRM_SIGN_VERS_SIZE_MAX_XXX (FRM_SIGN_VERS_SIZE_MIN + XMAX(cryptRsaKeyLenByType(MAX_LINK_RSA_TX_TYPE), (MAX_MAX_DHM_NEIGHS*sizeof(struct frame_msg_dhMac112))))
 
@@ -126,7 +140,17 @@ struct OgmAggreg_node {
 struct OgmAggreg_node *getOgmAggregNode(AGGREG_SQN_T aggSqn);
 
 
+struct route_eval_stats {
+	uint32_t evals;   // evaluated neighbor references
+	uint32_t cached;  // evaluations answered from the reference's cached best path
+	uint32_t algos;   // applied path-metric algorithms
+	uint32_t ranked;  // re-evaluations of the best ranked alternative neighbor
+};
+
+uint32_t ogm_backlog_items(void);
 void remove_ogm(struct orig_node *on);
+void neighRef_unrank(struct NeighRef_node *ref);
+struct route_eval_stats *get_route_eval_stats(void);
 void process_ogm_metric(void *voidRef);
 
 int32_t init_ogm(void);
@@ -27,6 +27,12 @@
 #include "avl.h"
 #include "node.h"
 #include "ip.h"
+#include "iptools.h"
+#include "metrics.h"
+#include "key.h"
+#include "sec.h"
+#include "msg.h"
+#include "content.h"
 #include "plugin.h"
 #include "schedule.h"
 #include "tools.h"
@@ -44,11 +50,33 @@ LIST_SIMPEL(cb_fd_list, struct cb_fd_node, list, list);
 
 int32_t plugin_data_registries[PLUGIN_DATA_SIZE];
 
+STATIC_FUNC
+void ctrl_event_plugin_hooks(int32_t cb_id, void* data)
+{
+	if (cb_id == PLUGIN_CB_DESCRIPTION_CREATED || cb_id == PLUGIN_CB_DESCRIPTION_DESTROY) {
+
+		struct orig_node *on = data;
+
+		ctrl_event(CTRL_EVENT_DESCS, "desc %s id=%s name=%s sqn=%d",
+			cb_id == PLUGIN_CB_DESCRIPTION_CREATED ? "add" : "del",
+			cryptShaAsString(&on->k.nodeId), on->k.hostname, on->dc ? (int) on->dc->descSqn : -1);
+
+	} else if (cb_id == PLUGIN_CB_BMX_DEV_EVENT) {
+
+		struct dev_node *dev = data;
+
+		ctrl_event(CTRL_EVENT_DEVS, "dev %s name=%s idx=%d llip=%s",
+			dev->active ? "up" : "down", dev->ifname_label.str, dev->llipKey.devIdx, dev->ip_llocal_str);
+	}
+}
+
 void cb_plugin_hooks(int32_t cb_id, void* data)
 {
 	struct list_node *list_pos;
 	struct plugin_node *pn, *prev_pn = NULL;
 
+	ctrl_event_plugin_hooks(cb_id, data);
+
 	list_for_each(list_pos, &plugin_list)
 	{
 		pn = list_entry(list_pos, struct plugin_node, list);
@@ -130,6 +158,11 @@ void cb_route_change_hooks(uint8_t del, struct orig_node *dest)
 
 	assertion(-501320, (local_router->orig_routes >= 0 && local_router->orig_routes < (int) orig_tree.items));
 
+	ctrl_event(CTRL_EVENT_ROUTES, "route %s id=%s name=%s ip=%s via=%s dev=%s metric=%s",
+		del ? "del" : "add", cryptShaAsString(&dest->k.nodeId), dest->k.hostname, ip6AsStr(&dest->primary_ip),
+		ip6AsStr(&dest->neighPath.link->k.linkDev->key.llocal_ip), dest->neighPath.link->k.myDev->ifname_label.str,
+		umetric_to_human(dest->neighPath.um));
+
 	list_for_each(list_pos, &cb_route_change_list)
 	{
 		con = list_entry(list_pos, struct cb_route_change_node, list);
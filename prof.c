@@ -82,13 +82,16 @@ void prof_free(struct prof_ctx *p)
 
 }
 
-static uint8_t prof_check_disabled = 0;
+struct prof_ctx *prof_iterate(struct avl_node **it)
+{
+	return avl_iterate_item(&prof_tree, it);
+}
+
 
 STATIC_FUNC
 int prof_check(struct prof_ctx *p, int childs)
 {
-	if (prof_check_disabled ||
-		!p || (p->active_prof && !!p->active_childs == childs && prof_check(p->parent, 1) == SUCCESS))
+	if (!p || (p->active_prof && !!p->active_childs == childs && prof_check(p->parent, 1) == SUCCESS))
 		return SUCCESS;
 
 	dbgf_sys(DBGT_ERR, "func=%d name=%s parent_func=%d neigh=%p orig=%p parent_active_childs=%d childs=%d",
@@ -97,15 +100,35 @@ int prof_check(struct prof_ctx *p, int childs)
 	return FAILURE;
 }
 
+// CLOCK_MONOTONIC is served by the vdso, so reading it costs no syscall
+uint64_t prof_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (((uint64_t) ts.tv_sec) * 1000000000) + ts.tv_nsec;
+}
+
+STATIC_FUNC
+uint64_t prof_cpu_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+	return (((uint64_t) ts.tv_sec) * 1000000000) + ts.tv_nsec;
+}
+
 void prof_start_(struct prof_ctx *p)
 {
-	assertion_dbg(-502122, (!p->active_prof && !p->clockBeforePStart && !p->active_childs),
-		"func=%s %d %ju %d", p->name, p->active_prof, (uintmax_t) p->clockBeforePStart, p->active_childs);
+	assertion_dbg(-502122, (!p->active_prof && !p->nsBeforePStart && !p->active_childs),
+		"func=%s %d %ju %d", p->name, p->active_prof, (uintmax_t) p->nsBeforePStart, p->active_childs);
 
 	if (!p->initialized)
 		prof_init(p);
 
-	p->clockBeforePStart = (TIME_T) clock();
+	p->nsBeforePStart = prof_now();
+	p->cpuBeforePStart = prof_cpu_now();
+	p->cpuAccounted = 0;
 	p->active_prof = 1;
 
 	if (p->parent)
@@ -116,27 +139,32 @@ void prof_start_(struct prof_ctx *p)
 
 void prof_stop_(struct prof_ctx *p)
 {
-	TIME_T clockAfter = clock();
-	TIME_T clockPeriod = (clockAfter - p->clockBeforePStart);
+	uint64_t nsPeriod = prof_now() - p->nsBeforePStart;
+	uint64_t cpuPeriod = prof_cpu_now() - p->cpuBeforePStart;
+	uint8_t b = nsPeriod ? (63 - __builtin_clzll(nsPeriod)) : 0;
 
 	assertion_dbg(-502126, (p->active_prof && !p->active_childs),
-		"func=%s %d %d %ju %d %d", p->name, p->active_prof, p->active_childs, (uintmax_t) p->clockBeforePStart, clockAfter, clockPeriod);
+		"func=%s %d %d %ju %ju", p->name, p->active_prof, p->active_childs, (uintmax_t) p->nsBeforePStart, (uintmax_t) nsPeriod);
 
 	ASSERTION(-502127, (prof_check(p, 0) == SUCCESS));
 
-//	IDM_T TODO_Fix_this_for_critical_system_time_drifts;
-//	assertion(-502128, (clockPeriod < ((~((TIME_T)0))>>1)) ); //this wraps around some time..
+	p->cpuRunningPeriod += (cpuPeriod - XMIN(cpuPeriod, p->cpuAccounted));
+	p->nsTotal += nsPeriod;
+	p->nsMin = (!p->calls || nsPeriod < p->nsMin) ? nsPeriod : p->nsMin;
+	p->nsMax = XMAX(p->nsMax, nsPeriod);
+	p->hist[XMIN(b, PROF_HIST_SIZE - 1)]++;
+	p->calls++;
 
-	if (clockPeriod < ((~((TIME_T) 0)) >> 1))
-		p->clockRunningPeriod += clockPeriod;
-
-	p->clockBeforePStart = 0;
+	p->nsBeforePStart = 0;
+	p->cpuBeforePStart = 0;
+	p->cpuAccounted = 0;
 	p->active_prof = 0;
 
 	if (p->parent)
 		p->parent->active_childs--;
 }
 
+static uint64_t timeProfStart = 0;
 static uint64_t durationPrevPeriod = 0;
 static uint64_t timeAfterPrevPeriod = 0;
 
@@ -147,42 +175,51 @@ void prof_update_all(void *unused)
 	struct avl_node *an = NULL;
 	struct prof_ctx *pn;
 
-	struct timeval tvAfterRunningPeriod;
-	upd_time(&tvAfterRunningPeriod);
-	uint64_t timeAfterRunningPeriod = (((uint64_t) tvAfterRunningPeriod.tv_sec) * 1000000) + tvAfterRunningPeriod.tv_usec;
+	uint64_t timeAfterRunningPeriod = prof_now();
+	uint64_t cpuAfterRunningPeriod = prof_cpu_now();
 
 	durationPrevPeriod = (timeAfterRunningPeriod - timeAfterPrevPeriod);
 
 	assertion(-502129, (durationPrevPeriod > 0));
-	assertion(-502130, (durationPrevPeriod < 10 * 1000000));
-
-	prof_check_disabled = YES;
+	assertion(-502130, (durationPrevPeriod < ((uint64_t) 10) * 1000000000));
 
 	while ((pn = avl_iterate_item(&prof_tree, &an))) {
 
-		uint8_t active = pn->active_prof;
-
-		dbgf_all(DBGT_INFO, "updating %s active=%d", pn->name, active);
+		dbgf_all(DBGT_INFO, "updating %s active=%d", pn->name, pn->active_prof);
 
-		if (active)
-			prof_stop_(pn);
-
-		pn->clockPrevPeriod = pn->clockRunningPeriod;
-		pn->clockPrevTotal += pn->clockRunningPeriod;
+		// account the elapsed part of still running calls without counting them as finished:
+		if (pn->active_prof) {
+			uint64_t cpuElapsed = cpuAfterRunningPeriod - pn->cpuBeforePStart;
+			pn->cpuRunningPeriod += (cpuElapsed - XMIN(cpuElapsed, pn->cpuAccounted));
+			pn->cpuAccounted = cpuElapsed;
+		}
 
-		pn->clockRunningPeriod = 0;
+		pn->cpuPrevPeriod = pn->cpuRunningPeriod;
+		pn->cpuPrevTotal += pn->cpuRunningPeriod;
 
-		if (active)
-			prof_start_(pn);
+		pn->cpuRunningPeriod = 0;
 	}
 
-	prof_check_disabled = NO;
-
 	timeAfterPrevPeriod = timeAfterRunningPeriod;
 
 	task_register(5000, prof_update_all, NULL, -300648);
 }
 
+STATIC_FUNC
+char *prof_ns2str(char *buff, uint64_t ns)
+{
+	if (ns < 1000)
+		sprintf(buff, "%juns", (uintmax_t) ns);
+	else if (ns < 1000000)
+		sprintf(buff, "%juus", (uintmax_t) (ns / 1000));
+	else if (ns < 1000000000)
+		sprintf(buff, "%jums", (uintmax_t) (ns / 1000000));
+	else
+		sprintf(buff, "%jus", (uintmax_t) (ns / 1000000000));
+
+	return buff;
+}
+
 struct prof_status {
 	GLOBAL_ID_T *neighId;
 	GLOBAL_ID_T *origId;
@@ -193,7 +230,11 @@ struct prof_status {
 	char relCurrCpu[10];
 	char sysAvgCpu[10];
 	char relAvgCpu[10];
-
+	char calls[22];
+	char avgUs[16];
+	char minUs[16];
+	char maxUs[16];
+	char histogram[PROF_HIST_SIZE * 20];
 };
 
 static const struct field_format prof_status_format[] = {
@@ -206,6 +247,11 @@ static const struct field_format prof_status_format[] = {
         FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       prof_status, relCurrCpu,    1, FIELD_RELEVANCE_HIGH),
         FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       prof_status, sysAvgCpu,     1, FIELD_RELEVANCE_HIGH),
         FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       prof_status, relAvgCpu,     1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       prof_status, calls,         1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       prof_status, avgUs,         1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       prof_status, minUs,         1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       prof_status, maxUs,         1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,       prof_status, histogram,     1, FIELD_RELEVANCE_MEDI),
 	FIELD_FORMAT_END
 };
 
@@ -222,41 +268,49 @@ struct prof_status *prof_status_iterate(struct prof_ctx *pn, struct prof_status
 	sprintf(status->relCurrCpu, DBG_NIL);
 	sprintf(status->sysAvgCpu, DBG_NIL);
 	sprintf(status->relAvgCpu, DBG_NIL);
+	sprintf(status->calls, "%ju", (uintmax_t) pn->calls);
+	sprintf(status->avgUs, DBG_NIL);
+	sprintf(status->minUs, DBG_NIL);
+	sprintf(status->maxUs, DBG_NIL);
+
+	if (pn->calls) {
+		uint8_t b;
+		uint32_t pos = 0;
+		char bound[12];
+
+		snprintf(status->avgUs, sizeof(status->avgUs), "%.3f", ((double) pn->nsTotal) / pn->calls / 1000);
+		snprintf(status->minUs, sizeof(status->minUs), "%.3f", ((double) pn->nsMin) / 1000);
+		snprintf(status->maxUs, sizeof(status->maxUs), "%.3f", ((double) pn->nsMax) / 1000);
+
+		for (b = 0; b < PROF_HIST_SIZE; b++) {
+			if (pn->hist[b])
+				pos += snprintf(status->histogram + pos, sizeof(status->histogram) - pos, "%s<%s:%u",
+				pos ? " " : "", b < PROF_HIST_SIZE - 1 ? prof_ns2str(bound, ((uint64_t) 1) << (b + 1)) : "inf", pn->hist[b]);
+		}
+	}
 
-	if (!durationPrevPeriod || !timeAfterPrevPeriod)
+	if (!durationPrevPeriod || timeAfterPrevPeriod <= timeProfStart)
 		goto prof_status_iterate_childs;
 
-	uint32_t loadPrevPeriod = (((uint64_t) pn->clockPrevPeriod)*
-		((((uint64_t) 100)*1000 * 1000000) / ((uint64_t) CLOCKS_PER_SEC))) /
-		durationPrevPeriod;
+	double loadPrevPeriod = (((double) pn->cpuPrevPeriod) * 100) / durationPrevPeriod;
 
-	snprintf(status->sysCurrCpu, sizeof(status->sysCurrCpu), "%8.4f", ((float) loadPrevPeriod) / 1000);
+	snprintf(status->sysCurrCpu, sizeof(status->sysCurrCpu), "%8.4f", loadPrevPeriod);
 
-	uint32_t loadPrevTotal = (((uint64_t) pn->clockPrevTotal)*
-		((((uint64_t) 100)*1000 * 1000000) / ((uint64_t) CLOCKS_PER_SEC))) /
-		timeAfterPrevPeriod;
+	double loadPrevTotal = (((double) pn->cpuPrevTotal) * 100) / (timeAfterPrevPeriod - timeProfStart);
 
-	snprintf(status->sysAvgCpu, sizeof(status->sysAvgCpu), "%8.4f", ((float) loadPrevTotal) / 1000);
+	snprintf(status->sysAvgCpu, sizeof(status->sysAvgCpu), "%8.4f", loadPrevTotal);
 
 	if (!pn->parent)
 		goto prof_status_iterate_childs;
 
-	uint32_t loadParentPrevPeriod = (((uint64_t) pn->parent->clockPrevPeriod)*
-		((((uint64_t) 100)*1000 * 1000000) / ((uint64_t) CLOCKS_PER_SEC))) /
-		durationPrevPeriod;
-
-	if (loadParentPrevPeriod)
-		snprintf(status->relCurrCpu, sizeof(status->relCurrCpu), "%8.4f", ((((float) loadPrevPeriod)*100) / ((float) loadParentPrevPeriod)));
-	else if (!loadParentPrevPeriod && loadPrevPeriod)
+	if (pn->parent->cpuPrevPeriod)
+		snprintf(status->relCurrCpu, sizeof(status->relCurrCpu), "%8.4f", (((double) pn->cpuPrevPeriod) * 100) / pn->parent->cpuPrevPeriod);
+	else if (pn->cpuPrevPeriod)
 		sprintf(status->relCurrCpu, "ERR");
 
-	uint32_t loadParentPrevTotal = (((uint64_t) pn->parent->clockPrevTotal)*
-		((((uint64_t) 100)*1000 * 1000000) / ((uint64_t) CLOCKS_PER_SEC))) /
-		timeAfterPrevPeriod;
-
-	if (loadParentPrevTotal)
-		snprintf(status->relAvgCpu, sizeof(status->relAvgCpu), "%8.4f", ((((float) loadPrevTotal)*100) / ((float) loadParentPrevTotal)));
-	else if (!loadParentPrevTotal && loadPrevTotal)
+	if (pn->parent->cpuPrevTotal)
+		snprintf(status->relAvgCpu, sizeof(status->relAvgCpu), "%8.4f", (((double) pn->cpuPrevTotal) * 100) / pn->parent->cpuPrevTotal);
+	else if (pn->cpuPrevTotal)
 		sprintf(status->relAvgCpu, "ERR");
 
 
@@ -292,11 +346,58 @@ int32_t prof_status_creator(struct status_handl *handl, void *data)
 	return status_size;
 }
 
+#define PROF_STACK_SIZE 1024
+
+/*
+ * Print one "parent;child;... selfTime" line per context with its exclusive cpu time
+ * in us. This is the folded stack format consumed by flamegraph.pl and speedscope.
+ */
+STATIC_FUNC
+void prof_folded_iterate(struct ctrl_node *cn, struct prof_ctx *pn, char *stack, uint32_t len)
+{
+	struct avl_node *an = NULL;
+	struct prof_ctx *cp;
+	uint64_t self = pn->cpuPrevTotal + pn->cpuRunningPeriod;
+	int n = snprintf(stack + len, PROF_STACK_SIZE - len, "%s%s", len ? ";" : "", pn->name);
+
+	if (n < 0 || len + n >= PROF_STACK_SIZE)
+		return;
+
+	while ((cp = avl_iterate_item(&pn->childs_tree, &an))) {
+		uint64_t child = cp->cpuPrevTotal + cp->cpuRunningPeriod;
+		self -= XMIN(self, child);
+		prof_folded_iterate(cn, cp, stack, len + n);
+		stack[len + n] = 0;
+	}
+
+	if (self >= 1000)
+		dbg_printf(cn, "%s %ju\n", stack, (uintmax_t) (self / 1000));
+}
+
+STATIC_FUNC
+int32_t opt_prof_folded(uint8_t cmd, uint8_t _save, struct opt_type *opt, struct opt_parent *patch, struct ctrl_node *cn)
+{
+	if (cmd == OPT_APPLY) {
+
+		char stack[PROF_STACK_SIZE];
+		struct avl_node *an = NULL;
+		struct prof_ctx *pn;
+
+		while ((pn = avl_iterate_item(&prof_tree, &an))) {
+			if (!pn->parent)
+				prof_folded_iterate(cn, pn, stack, 0);
+		}
+	}
+
+	return SUCCESS;
+}
 
 static struct opt_type prof_options[] ={
 //       ord parent long_name          shrt Attributes				*ival		min		max		default		*func,*syntax,*help
 	{ODI,0,ARG_CPU_PROFILING,      0,  9,1,A_PS0N,A_USR,A_DYN,A_ARG,A_ANY,	0,		0, 		0,		0,0, 		opt_status,
-			0,		"show cpu usage of relevant functions\n"}
+			0,		"show cpu usage, calls, latencies and log2 latency histogram of relevant functions\n"},
+	{ODI,0,ARG_CPU_FOLDED,         0,  9,1,A_PS0,A_USR,A_DYN,A_ARG,A_ANY,	0,		0, 		0,		0,0, 		opt_prof_folded,
+			0,		"show exclusive cpu time (in us) of relevant functions as folded stacks for flamegraph tools\n"}
 };
 
 void init_prof(void)
@@ -304,6 +405,8 @@ void init_prof(void)
 	register_status_handl(sizeof(struct prof_status), 1, prof_status_format, ARG_CPU_PROFILING, prof_status_creator);
 	register_options_array(prof_options, sizeof( prof_options), CODE_CATEGORY_NAME);
 
+	timeProfStart = timeAfterPrevPeriod = prof_now();
+
 	task_register(5000, prof_update_all, NULL, -300649);
 
 }
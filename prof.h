@@ -15,6 +15,9 @@
  * 02110-1301, USA
  */
 #define ARG_CPU_PROFILING "cpu"
+#define ARG_CPU_FOLDED "cpuFolded"
+
+#define PROF_HIST_SIZE 32 // log2(ns) buckets of call durations, the last one also collects all longer calls
 
 struct prof_ctx_key {
 	struct neigh_node *neigh;
@@ -35,17 +38,26 @@ struct prof_ctx {
 	int8_t active_childs;
 	int8_t active_prof;
 
-	clock_t clockBeforePStart;
+	uint64_t nsBeforePStart;  // wall time, for call durations
+	uint64_t cpuBeforePStart; // process cpu time, for load
+	uint64_t cpuAccounted;    // part of the active call already accounted by prof_update_all()
 
 	// updated by prof_stop():
-	clock_t clockRunningPeriod;
-	clock_t clockPrevPeriod;
-	uint64_t clockPrevTotal;
+	uint64_t cpuRunningPeriod;
+	uint64_t cpuPrevPeriod;
+	uint64_t cpuPrevTotal;
+	uint64_t calls;
+	uint64_t nsTotal;
+	uint64_t nsMin;
+	uint64_t nsMax;
+	uint32_t hist[PROF_HIST_SIZE];
 };
 
 //void prof_init( struct prof_ctx *sp);
 
+uint64_t prof_now(void);
 void prof_free(struct prof_ctx *p);
+struct prof_ctx *prof_iterate(struct avl_node **it);
 
 void prof_start_(struct prof_ctx *p);
 void prof_stop_(struct prof_ctx *p);
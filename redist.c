@@ -68,145 +68,242 @@ void update_tunXin6_net_adv_list(struct avl_tree *redist_out_tree, struct tunXin
 
 	struct avl_node *ran = NULL;
 	struct redist_out_node *routn;
-	struct tunXin6_net_adv_node *p = (*tunXin6_net_adv_list = debugRealloc(*tunXin6_net_adv_list, redist_out_tree->items * sizeof(struct tunXin6_net_adv_node), -300790));
+	struct tunXin6_net_adv_node *p;
+	uint32_t items = 0;
 
+	// only advertise (old) nodes, referenced but covered or aggregated ones remain in the tree:
+	while ((routn = avl_iterate_item(redist_out_tree, &ran)))
+		items += routn->old;
+
+	if (*tunXin6_net_adv_list)
+		debugFree(*tunXin6_net_adv_list, -300878);
+
+	*tunXin6_net_adv_list = p = items ? debugMalloc(items * sizeof(struct tunXin6_net_adv_node), -300790) : NULL;
+
+	for (ran = NULL; items && (routn = avl_iterate_item(redist_out_tree, &ran));) {
+
+		if (!routn->old)
+			continue;
 
-	for (; (routn = avl_iterate_item(redist_out_tree, &ran)); p++) {
 		memset(p, 0, sizeof(*p));
-		p->more = (ran->right ? YES : NO);
+		p->more = (--items) ? YES : NO;
 		p->af = routn->k.net.af;
 		p->adv.bandwidth = routn->k.bandwidth;
 		p->adv.proto_type = routn->k.proto_type;
 		p->adv.network = routn->k.net.ip;
 		p->adv.networkLen = routn->k.net.mask;
 		p->tunInDev = strlen(routn->k.tunInDev.str) ? routn->k.tunInDev.str : NULL;
+		p++;
 	}
 
 	my_description_changed = YES;
 	prof_stop();
 }
 
+/*
+ * Overlap removal and aggregation of redist_out_tree in a single pass per
+ * (tunInDev, proto_type, bandwidth, af) group:
+ * The new routes of a group are sorted by (ip, mask), which is the pre-order of their
+ * binary prefix trie. Walking this order with a stack of surviving ancestors first drops
+ * all routes covered by a surviving ancestor with mask >= minAggregatePrefixLen. Walking
+ * the survivors again with a stack of pending prefixes then merges neighboring
+ * siblings bottom-up into their parent prefix for as long as both exceed their
+ * minAggregatePrefixLen. Intermediate aggregates only live on the stack; only
+ * the final result is written back into redist_out_tree.
+ */
+struct redist_aggr_node {
+	struct net_key net;
+	uint8_t minAggregatePrefixLen;
+	uint8_t alive;
+	struct redist_out_node *routn;
+};
+
 STATIC_FUNC
-void redist_rm_overlapping(struct avl_tree *redist_out_tree)
+int redist_aggr_cmp(const void *a, const void *b)
 {
-	prof_start(redist_rm_overlapping, redistribute_routes);
+	const struct redist_aggr_node *na = a, *nb = b;
+	int cmp = memcmp(&na->net.ip, &nb->net.ip, sizeof(IPX_T));
 
-	dbgf_track(DBGT_INFO, " ");
+	return cmp ? cmp : ((int) na->net.mask - (int) nb->net.mask);
+}
 
-	struct redist_out_node *routn;
-	struct avl_node *an = NULL;
+STATIC_FUNC
+IDM_T redist_net_covers(const struct net_key *a, const struct net_key *b)
+{
+	uint16_t bits = a->mask + (a->af == AF_INET ? 96 : 0);
+	const uint8_t *ia = (const uint8_t*) &a->ip, *ib = (const uint8_t*) &b->ip;
 
-	while ((routn = avl_iterate_item(redist_out_tree, &an))) {
+	if (a->mask > b->mask || memcmp(ia, ib, bits / 8))
+		return NO;
 
-		if (!routn->new)
-			continue;
+	return !(bits % 8) || !((ia[bits / 8] ^ ib[bits / 8]) & (0xFF << (8 - (bits % 8))));
+}
 
-		// find overlapping route entry:
-		if (routn->minAggregatePrefixLen != MAX_REDIST_AGGREGATE) {
-			struct redist_out_node *ovlp = NULL;
-			struct redist_out_node t = { .k =
-				{.bandwidth = routn->k.bandwidth, .tunInDev = routn->k.tunInDev,
-					.proto_type = routn->k.proto_type, .net =
-					{.af = routn->k.net.af } } };
-
-			while ((ovlp = avl_next_item(redist_out_tree, ovlp ? &ovlp->k : &t.k))) {
-
-				dbgf_all(DBGT_INFO, "checking overlapping net=%s rtype=%d bw=%d tunIndev=%s, min=%d new=%d in favor of net=%s rtype=%d bw=%d tunInDev=%s min=%d new=%d",
-					netAsStr(&routn->k.net), routn->k.proto_type, routn->k.bandwidth.val.u8, routn->k.tunInDev.str, routn->minAggregatePrefixLen, routn->new,
-					netAsStr(&ovlp->k.net), ovlp->k.proto_type, ovlp->k.bandwidth.val.u8, ovlp->k.tunInDev.str, ovlp->minAggregatePrefixLen, ovlp->new);
-
-				if (memcmp(&ovlp->k.tunInDev, &routn->k.tunInDev, sizeof(IFNAME_T)) ||
-					ovlp->k.bandwidth.val.u8 != routn->k.bandwidth.val.u8 ||
-					ovlp->k.proto_type != routn->k.proto_type ||
-					ovlp->k.net.af != routn->k.net.af ||
-					ovlp->k.net.mask >= routn->k.net.mask)
-					break;
+STATIC_FUNC
+IDM_T redist_aggr_mergeable(const struct redist_aggr_node *n)
+{
+	return (n->net.mask && n->net.mask > n->minAggregatePrefixLen);
+}
 
-				if (!ovlp->new || ovlp->k.net.mask < routn->minAggregatePrefixLen)
-					continue;
+STATIC_FUNC
+void redist_aggr_group(struct avl_tree *redist_out_tree, struct redist_aggr_node *arr, uint32_t *anc, uint32_t n, struct redist_out_node *group)
+{
+	uint32_t i, j, sp, w;
 
-				if (is_ip_net_equal(&ovlp->k.net.ip, &routn->k.net.ip, ovlp->k.net.mask, routn->k.net.af)) {
-					routn->new = 0;
-					ovlp->minAggregatePrefixLen = XMAX(ovlp->minAggregatePrefixLen, routn->minAggregatePrefixLen);
-					dbgf_all(DBGT_INFO, "disable overlapping net=%s in favor of net=%s",
-						netAsStr(&routn->k.net), netAsStr(&ovlp->k.net));
-					break;
-				}
+	qsort(arr, n, sizeof(struct redist_aggr_node), redist_aggr_cmp);
+
+	// remove overlapping: anc[] holds the chain of surviving ancestors of arr[i]:
+	for (sp = 0, i = 0; i < n; i++) {
+
+		while (sp && !redist_net_covers(&arr[anc[sp - 1]].net, &arr[i].net))
+			sp--;
+
+		arr[i].alive = YES;
+
+		for (j = 0; j < sp && arr[i].minAggregatePrefixLen != MAX_REDIST_AGGREGATE; j++) {
+
+			struct redist_aggr_node *ovlp = &arr[anc[j]];
+
+			if (ovlp->net.mask >= arr[i].minAggregatePrefixLen) {
+				arr[i].alive = NO;
+				ovlp->minAggregatePrefixLen = XMAX(ovlp->minAggregatePrefixLen, arr[i].minAggregatePrefixLen);
+				dbgf_all(DBGT_INFO, "disable overlapping net=%s in favor of net=%s",
+					netAsStr(&arr[i].net), netAsStr(&ovlp->net));
+				break;
 			}
 		}
+
+		if (arr[i].alive)
+			anc[sp++] = i;
+		else if (arr[i].routn)
+			arr[i].routn->new = 0;
 	}
 
-	prof_stop();
-}
+	// aggregate neighboring: arr[0..w) is the stack of pending prefixes:
+	for (w = 0, i = 0; i < n; i++) {
 
-STATIC_FUNC
-void redist_rm_aggregatable(struct avl_tree *redist_out_tree)
-{
-	prof_start(redist_rm_aggregatable, redistribute_routes);
+		if (!arr[i].alive)
+			continue;
 
-	struct redist_out_node *r1;
-	struct avl_node *an = NULL;
+		struct redist_aggr_node cur = arr[i];
+		uint8_t v4 = (cur.net.af == AF_INET);
 
-	struct redist_out_node rtn;
-	memset(&rtn, 0, sizeof(rtn));
+		while (redist_aggr_mergeable(&cur)) {
 
-	uint8_t more = YES;
+			struct net_key parent = cur.net;
+			struct net_key sibling = cur.net;
+			uint32_t k;
 
-	while (more) {
+			parent.mask--;
+			bit_set((uint8_t*) &parent.ip, 128, parent.mask + (v4 ? 96 : 0), 0);
+			bit_set((uint8_t*) &sibling.ip, 128, sibling.mask + (v4 ? 96 : 0) - 1,
+				!bit_get((uint8_t*) &cur.net.ip, 128, cur.net.mask + (v4 ? 96 : 0) - 1));
 
-		dbgf_track(DBGT_INFO, " ");
+			for (k = w; k-- && redist_net_covers(&parent, &arr[k].net);) {
+				if (arr[k].net.mask == sibling.mask && !memcmp(&arr[k].net.ip, &sibling.ip, sizeof(IPX_T)))
+					break;
+			}
 
-		more = NO;
+			if (k == UINT32_MAX || !redist_net_covers(&parent, &arr[k].net) || !redist_aggr_mergeable(&arr[k]))
+				break;
 
-		while ((r1 = avl_iterate_item(redist_out_tree, &an))) {
+			dbgf_track(DBGT_INFO, "aggregate neighboring net0=%s net1=%s into new=%s",
+				netAsStr(&arr[k].net), netAsStr(&cur.net), netAsStr(&parent));
 
-			uint8_t v4 = (r1->k.net.af == AF_INET);
-			uint8_t b1 = bit_get((uint8_t*)&(r1->k.net.ip), 128, r1->k.net.mask + (v4 ? 96 : 0) - 1);
+			if (arr[k].routn)
+				arr[k].routn->new = 0;
+			if (cur.routn)
+				cur.routn->new = 0;
 
-			dbgf_all(DBGT_INFO, "checking aggregation for net=%s rtype=%d bw=%d tunInDev=%s min=%d new=%d lastBit=%d %s",
-				netAsStr(&r1->k.net), r1->k.proto_type, r1->k.bandwidth.val.u8, r1->k.tunInDev.str, r1->minAggregatePrefixLen,
-				r1->new, b1, memAsHexStringSep(&r1->k.net.ip, 16, 2, NULL));
+			cur.minAggregatePrefixLen = XMAX(cur.minAggregatePrefixLen, arr[k].minAggregatePrefixLen);
+			cur.net = parent;
+			cur.routn = NULL;
 
-			if (!r1->new || !r1->k.net.mask || r1->k.net.mask <= r1->minAggregatePrefixLen || !b1)
-				continue;
+			memmove(&arr[k], &arr[k + 1], (--w - k) * sizeof(struct redist_aggr_node));
+		}
 
+		arr[w++] = cur;
+	}
 
-			struct redist_out_node s0 = *r1;
-			bit_set((uint8_t*)&(s0.k.net.ip), 128, s0.k.net.mask + (v4 ? 96 : 0) - 1, 0);
+	for (i = 0; i < w; i++) {
 
-			struct redist_out_node *r0 = avl_find_item(redist_out_tree, &s0.k);
+		struct redist_out_node *routn = arr[i].routn;
 
-			dbgf_all(DBGT_INFO, "                    with net=%s rtype=%d bw=%d tunInDev=%s min=%d new=%d %s",
-				netAsStr(&s0.k.net), s0.k.proto_type, s0.k.bandwidth.val.u8, s0.k.tunInDev.str, s0.minAggregatePrefixLen,
-				s0.new, memAsHexStringSep(&s0.k.net.ip, 16, 2, NULL));
+		if (!routn) {
+			struct redist_out_node s = *group;
+			s.k.net = arr[i].net;
 
-			if (r0 && r0->new && r0->k.net.mask > r0->minAggregatePrefixLen) {
+			if ((routn = avl_find_item(redist_out_tree, &s.k))) {
+				assertion(-501426, (!routn->new));
+			} else {
+				routn = debugMalloc(sizeof(s), -300503);
+				*routn = s;
+				routn->old = 0;
+				routn->refs = 0;
+				routn->refsAggregatePrefixLen = 0;
+				avl_insert(redist_out_tree, routn, -300504);
+			}
+		}
+
+		routn->new = 1;
+		routn->minAggregatePrefixLen = arr[i].minAggregatePrefixLen;
+	}
+}
 
-				struct redist_out_node *ra;
+STATIC_FUNC
+void redist_aggregate(struct avl_tree *redist_out_tree)
+{
+	prof_start(redist_aggregate, redistribute_routes);
 
-				s0.k.net.mask--;
+	dbgf_track(DBGT_INFO, " ");
 
-				if ((ra = avl_find_item(redist_out_tree, &s0.k))) {
-					assertion(-501426, (!ra->new));
-				} else {
-					ra = debugMalloc(sizeof(s0), -300503);
-					*ra = s0;
-					avl_insert(redist_out_tree, ra, -300504);
-				}
+	uint32_t items = redist_out_tree->items;
+	struct redist_aggr_node *arr;
+	uint32_t *anc;
+	struct redist_out_node *routn = NULL, *group = NULL;
+	struct redist_out_key zero_key;
+	uint32_t n = 0;
 
-				ra->new = 1;
-				r0->new = 0;
-				r1->new = 0;
-				ra->minAggregatePrefixLen = XMAX(r0->minAggregatePrefixLen, r1->minAggregatePrefixLen);
-				more = YES;
+	if (!items) {
+		prof_stop();
+		return;
+	}
 
-				dbgf_track(DBGT_INFO, "                    aggregate neighboring net0=%s net1=%s into new=%s",
-					netAsStr(&r0->k.net), netAsStr(&r1->k.net), netAsStr(&ra->k.net));
+	arr = debugMalloc(items * sizeof(struct redist_aggr_node), -300874);
+	anc = debugMalloc(items * sizeof(uint32_t), -300875);
 
-			}
+	memset(&zero_key, 0, sizeof(zero_key));
 
+	do {
+		// key based iteration because aggregates are inserted into the already passed group:
+		routn = avl_next_item(redist_out_tree, routn ? &routn->k : &zero_key);
+
+		if (group && (!routn ||
+			memcmp(&routn->k.tunInDev, &group->k.tunInDev, sizeof(IFNAME_T)) ||
+			routn->k.proto_type != group->k.proto_type ||
+			routn->k.bandwidth.val.u8 != group->k.bandwidth.val.u8 ||
+			routn->k.net.af != group->k.net.af)) {
+
+			redist_aggr_group(redist_out_tree, arr, anc, n, group);
+			group = NULL;
+			n = 0;
+		}
+
+		if (routn && routn->new) {
+
+			if (!group)
+				group = routn;
+
+			arr[n].net = routn->k.net;
+			arr[n].minAggregatePrefixLen = routn->minAggregatePrefixLen;
+			arr[n].routn = routn;
+			n++;
 		}
-	}
+
+	} while (routn);
+
+	debugFree(anc, -300876);
+	debugFree(arr, -300877);
 
 	prof_stop();
 }
@@ -258,66 +355,86 @@ struct redistr_opt_node *matching_redist_opt(struct redist_in_node *rin, struct
 	return NULL;
 }
 
-IDM_T redistribute_routes(struct avl_tree *redist_out_tree, struct avl_tree *redist_in_tree, struct avl_tree *redist_opt_tree)
+/*
+ * Maps a changed redist_in_node onto the reference count of its (unaggregated)
+ * redist_out_node. Returns YES if the set of referenced keys changed and a
+ * redistribute_routes() run is needed.
+ */
+IDM_T redist_in_update(struct avl_tree *redist_out_tree, struct redist_in_node *rin, int8_t del)
 {
+	struct redistr_opt_node *roptn = rin->roptn;
+	struct redist_out_node *routn;
+	struct redist_out_node routf;
 
-	prof_start(redistribute_routes, main);
-
-	dbgf_track(DBGT_INFO, " ");
-	IDM_T redist_changed = NO;
+	assertion(-502803, (roptn));
 
+	memset(&routf, 0, sizeof(routf));
 
-	struct redist_in_node *rin;
-	struct avl_node *rii;
+	routf.k.proto_type = roptn->advProto;
+	routf.k.net = roptn->net.mask >= rin->k.net.mask ? roptn->net : rin->k.net;
+	routf.k.bandwidth = roptn->bandwidth;
+	if (roptn->tunInDev)
+		strcpy(routf.k.tunInDev.str, roptn->tunInDev);
+	routf.k.must_be_one = 1; // to let alv_next_item find the first one
 
-	struct redistr_opt_node *roptn;
+	if (!(routn = avl_find_item(redist_out_tree, &routf.k))) {
 
-	struct redist_out_node *routn;
-	struct avl_node *routi;
+		assertion(-502804, (!del));
 
-	struct redist_out_node routf;
+		*(routn = debugMalloc(sizeof(routf), -300505)) = routf;
+		avl_insert(redist_out_tree, routn, -300506);
+	}
 
-	for (routi = NULL; (routn = avl_iterate_item(redist_out_tree, &routi));) {
-		routn->new = 0;
-		routn->minAggregatePrefixLen = 0;
+	if (__dbgf_track()) {
+		redist_dbg(DBGL_CHANGES, DBGT_INFO, __func__, rin, del ? "del" : "add", routn->refs ? "reusing" : "adding");
 	}
 
-	for (rii = NULL; (rin = avl_iterate_item(redist_in_tree, &rii));) {
+	if (del) {
 
-		ASSERTION(-502479, IMPLIES(rin->roptn, rin->roptn == matching_redist_opt(rin, redist_opt_tree)));
+		assertion(-502805, (routn->refs));
 
-		if ((roptn = rin->roptn ? rin->roptn : matching_redist_opt(rin, redist_opt_tree))) {
+		if (--(routn->refs))
+			return NO;
 
-			memset(&routf, 0, sizeof(routf));
+		routn->refsAggregatePrefixLen = 0;
+		return YES;
+	}
 
-			routf.k.proto_type = roptn->advProto;
-			routf.k.net = roptn->net.mask >= rin->k.net.mask ? roptn->net : rin->k.net;
-			routf.k.bandwidth = roptn->bandwidth;
-			if (roptn->tunInDev)
-				strcpy(routf.k.tunInDev.str, roptn->tunInDev);
-			routf.k.must_be_one = 1; // to let alv_next_item find the first one
-			routf.minAggregatePrefixLen = roptn->minAggregatePrefixLen;
+	routn->refsAggregatePrefixLen = XMAX(routn->refsAggregatePrefixLen, roptn->minAggregatePrefixLen);
 
-			if (!(routn = avl_find_item(redist_out_tree, &routf.k))) {
-				*(routn = debugMalloc(sizeof(routf), -300505)) = routf;
-				avl_insert(redist_out_tree, routn, -300506);
-				if (__dbgf_track()) {
-					redist_dbg(DBGL_CHANGES, DBGT_INFO, __func__, rin, "parsing", "adding");
-				}
-			} else {
-				if (__dbgf_track()) {
-					redist_dbg(DBGL_CHANGES, DBGT_INFO, __func__, rin, "parsing", "reusing");
-				}
-			}
+	return !(routn->refs++);
+}
 
-			routn->new = 1;
-			routn->minAggregatePrefixLen = XMAX(routn->minAggregatePrefixLen, roptn->minAggregatePrefixLen);
-		}
+void redist_in_flush(struct avl_tree *redist_out_tree)
+{
+	struct redist_out_node *routn;
+	struct avl_node *an = NULL;
+
+	while ((routn = avl_iterate_item(redist_out_tree, &an))) {
+		routn->refs = 0;
+		routn->refsAggregatePrefixLen = 0;
 	}
+}
+
+IDM_T redistribute_routes(struct avl_tree *redist_out_tree)
+{
+
+	prof_start(redistribute_routes, main);
 
-	redist_rm_overlapping(redist_out_tree);
+	dbgf_track(DBGT_INFO, " ");
+	IDM_T redist_changed = NO;
+
+	struct redist_out_node *routn;
+	struct avl_node *routi;
+
+	struct redist_out_node routf;
 
-	redist_rm_aggregatable(redist_out_tree);
+	for (routi = NULL; (routn = avl_iterate_item(redist_out_tree, &routi));) {
+		routn->new = !!routn->refs;
+		routn->minAggregatePrefixLen = routn->refsAggregatePrefixLen;
+	}
+
+	redist_aggregate(redist_out_tree);
 
 
 	// remove_old_routes:
@@ -334,6 +451,13 @@ IDM_T redistribute_routes(struct avl_tree *redist_out_tree, struct avl_tree *red
 
 
 		if (!routn->new) {
+
+			if (routn->refs) {
+				// still referenced but currently covered or aggregated:
+				routn->old = 0;
+				continue;
+			}
+
 			avl_remove(redist_out_tree, &routn->k, -300507);
 			debugFree(routn, -300508);
 			continue;
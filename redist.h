@@ -96,6 +96,8 @@ struct redist_out_key {
 
 struct redist_out_node {
 	struct redist_out_key k;
+	uint32_t refs; // redist_in_nodes currently mapped to this key
+	uint8_t refsAggregatePrefixLen;
 	uint8_t minAggregatePrefixLen;
 	uint8_t old;
 	uint8_t new;
@@ -116,6 +118,7 @@ struct redist_in_node {
 	uint8_t flags;
 	uint8_t message;
 	uint8_t old;
+	uint8_t dirty;
 	uint8_t distance;
 	uint32_t metric;
 	TIME_T stamp;
@@ -138,7 +141,9 @@ struct redistr_opt_node {
 
 void redist_dbg(int8_t dbgl, int8_t dbgt, const char *func, struct redist_in_node *zrn, char* misc1, char* misc2);
 void update_tunXin6_net_adv_list(struct avl_tree *redist_out_tree, struct tunXin6_net_adv_node **tunXin6_net_adv_list);
-IDM_T redistribute_routes(struct avl_tree *redist_out_tree, struct avl_tree *zroute_tree, struct avl_tree *redist_opt_tree);
+IDM_T redist_in_update(struct avl_tree *redist_out_tree, struct redist_in_node *rin, int8_t del);
+void redist_in_flush(struct avl_tree *redist_out_tree);
+IDM_T redistribute_routes(struct avl_tree *redist_out_tree);
 
 int32_t opt_redist(uint8_t cmd, uint8_t _save, struct opt_type *opt, struct opt_parent *patch, struct ctrl_node *cn, struct avl_tree *redist_opt_tree, uint8_t *changed);
 struct redistr_opt_node *matching_redist_opt(struct redist_in_node *rin, struct avl_tree *redist_opt_tree);
@@ -38,12 +38,38 @@
 #include "schedule.h"
 #include "allocate.h"
 #include "key.h"
+#include "prof.h"
+
+#define CODE_CATEGORY_NAME "schedule"
 
 
 
 
 static LIST_SIMPEL(task_list, struct task_node, list, list);
 
+static AVL_TREE(task_stats_tree, struct task_stats, task);
+
+static struct sched_stats {
+	uint64_t wakeups;      // select() returned ready fds
+	uint64_t timerWakeups; // select() timed out as requested
+	uint64_t earlyWakeups; // select() timed out too early
+	uint64_t spuriousWakeups; // select() returned without timeout or ready fds
+	uint64_t msCheated;    // bmx_time advanced to the requested wakeup after early timeouts
+	uint64_t fds;
+	uint32_t fdsMax;
+	uint64_t packets;
+	uint32_t packetsMax;
+	uint64_t nsIdle;       // blocked in select()
+	uint64_t nsRx;         // processing received packets
+	uint64_t nsFds;        // processing all ready fds (including nsRx)
+	uint64_t nsTasks;      // executing expired tasks (excluding nsTx)
+	uint64_t nsTx;         // executing tx_packets()
+	uint64_t nsBusyMax;    // longest time between two select() calls
+	uint32_t busyHist[SCHED_HIST_SIZE];
+} sched_stats;
+
+static uint64_t bmx_time_ns = 0; // monotonic time of last bmx_time update
+
 static int32_t receive_max_sock = 0;
 static fd_set receive_wait_set;
 
@@ -99,6 +125,7 @@ void upd_bmx_time(struct timeval *tv)
 
 		bmx_time = ((tv->tv_sec * 1000) + (tv->tv_usec / 1000));
 		bmx_time_sec = tv->tv_sec;
+		bmx_time_ns = prof_now();
 
 		if (bmx_time)
 			break;
@@ -171,7 +198,7 @@ static void check_selects(void)
 	}
 }
 
-void task_register(TIME_T timeout, void (* task) (void *), void *data, int32_t tag)
+void task_register_(TIME_T timeout, void (* task) (void *), void *data, int32_t tag, const char *name)
 {
 
 	assertion(-500475, (task_remove(task, data) == FAILURE));
@@ -188,6 +215,13 @@ void task_register(TIME_T timeout, void (* task) (void *), void *data, int32_t t
 	tn->task = task;
 	tn->data = data;
 
+	if (!(tn->stats = avl_find_item(&task_stats_tree, &task))) {
+		tn->stats = debugMallocReset(sizeof(struct task_stats), -300911);
+		tn->stats->task = task;
+		tn->stats->name = name;
+		avl_insert(&task_stats_tree, tn->stats, -300912);
+	}
+
 	list_for_each(list_pos, &task_list)
 	{
 
@@ -240,6 +274,39 @@ IDM_T task_remove(void (* task) (void *), void *data)
 	return ret;
 }
 
+STATIC_FUNC
+void sched_rx_packet(struct packet_buff *pb, uint32_t *packets)
+{
+	uint64_t nsBefore = prof_now();
+
+	rx_packet(pb);
+
+	sched_stats.nsRx += (prof_now() - nsBefore);
+	(*packets)++;
+}
+
+// account the fd processing of the last select() wakeup
+STATIC_FUNC
+void sched_wakeup_done(uint64_t *nsDispatch, uint32_t *packets)
+{
+	if (*nsDispatch) {
+		sched_stats.nsFds += (prof_now() - *nsDispatch);
+		sched_stats.packets += *packets;
+		sched_stats.packetsMax = XMAX(sched_stats.packetsMax, *packets);
+	}
+
+	*nsDispatch = 0;
+	*packets = 0;
+}
+
+STATIC_FUNC
+uint8_t sched_hist_bucket(uint64_t ms)
+{
+	uint8_t b = ms ? (64 - __builtin_clzll(ms)) : 0;
+
+	return XMIN(b, SCHED_HIST_SIZE - 1);
+}
+
 TIME_T task_next(void)
 {
 	struct list_node *list_pos, *tmp_pos, *prev_pos;
@@ -256,12 +323,30 @@ task_next_again:
 
 			void (* task) (void *fpara) = tn->task;
 			void *data = tn->data;
+			struct task_stats *ts = tn->stats;
+			uint64_t nsBefore = prof_now();
+			uint64_t usLate = ((uint64_t) ((TIME_T) (bmx_time - tn->expire))) * 1000;
 
+			usLate += (nsBefore - bmx_time_ns) / 1000; // bmx_time is not updated while tasks are executed
 			list_del_next(&task_list, prev_pos);
 			debugFree(tn, -300081); // remove before executing because otherwise we get memory leak if taks causes an assertion
 
 			(*(task)) (data);
 
+			uint64_t nsPeriod = prof_now() - nsBefore;
+
+			ts->calls++;
+			ts->nsTotal += nsPeriod;
+			ts->nsMax = XMAX(ts->nsMax, nsPeriod);
+			ts->usLateTotal += usLate;
+			ts->usLateMax = XMAX(ts->usLateMax, usLate);
+			ts->lateHist[sched_hist_bucket(usLate / 1000)]++;
+
+			if (task == tx_packets)
+				sched_stats.nsTx += nsPeriod;
+			else
+				sched_stats.nsTasks += nsPeriod;
+
 			CHECK_INTEGRITY();
 
 			//dbgf_track(DBGT_INFO, "executed %p", task );
@@ -284,16 +369,24 @@ void wait4Event(TIME_T timeout)
 
 	static uint32_t addr_len = sizeof(pb.i.addr);
 
+	static uint64_t nsAwake = 0;
+
 	TIME_T return_time = bmx_time + timeout;
 	struct timeval tv;
 	struct list_node *list_pos;
 	int selected;
+	int32_t write_max_sock;
 	fd_set tmp_wait_set;
+	fd_set tmp_write_set;
+	uint64_t nsBefore, nsDispatch = 0;
+	uint32_t packets = 0;
 
 	keyNode_fixTimeouts();
 
 loop4Event:
 
+	sched_wakeup_done(&nsDispatch, &packets);
+
 	while (U32_GT(return_time, bmx_time)) {
 
 
@@ -301,10 +394,36 @@ loop4Event:
 
 		memcpy(&tmp_wait_set, &receive_wait_set, sizeof(fd_set));
 
+		// control clients with queued output wait for their fd to become writable
+		FD_ZERO(&tmp_write_set);
+		write_max_sock = 0;
+
+		list_for_each(list_pos, &ctrl_list)
+		{
+			struct ctrl_node *client = list_entry(list_pos, struct ctrl_node, list);
+
+			if (client->buffered && client->outLen && client->fd > 0) {
+				write_max_sock = XMAX(write_max_sock, client->fd);
+				FD_SET(client->fd, &tmp_write_set);
+			}
+		}
+
 		tv.tv_sec = (return_time - bmx_time) / 1000;
 		tv.tv_usec = ((return_time - bmx_time) % 1000) * 1000;
 
-		selected = select(receive_max_sock + 1, &tmp_wait_set, NULL, NULL, &tv);
+		nsBefore = prof_now();
+
+		if (nsAwake) {
+			uint64_t nsBusy = nsBefore - nsAwake;
+			sched_stats.nsBusyMax = XMAX(sched_stats.nsBusyMax, nsBusy);
+			sched_stats.busyHist[sched_hist_bucket(nsBusy / 1000000)]++;
+		}
+
+		selected = select(XMAX(receive_max_sock, write_max_sock) + 1, &tmp_wait_set,
+			write_max_sock ? &tmp_write_set : NULL, NULL, &tv);
+
+		nsAwake = prof_now();
+		sched_stats.nsIdle += (nsAwake - nsBefore);
 
 		upd_bmx_time(&(pb.i.tv_stamp));
 
@@ -336,12 +455,18 @@ loop4Event:
 			//Often select returns just a few milliseconds before being scheduled
 			if (U32_LT(return_time, (bmx_time + 10))) {
 
+				sched_stats.timerWakeups += !U32_GT(return_time, bmx_time);
+				sched_stats.earlyWakeups += U32_GT(return_time, bmx_time);
+				sched_stats.msCheated += U32_GT(return_time, bmx_time) ? (return_time - bmx_time) : 0;
+
 				//cheating time :-)
 				bmx_time = return_time;
 
 				goto wait4Event_end;
 			}
 
+			sched_stats.spuriousWakeups++;
+
 			//if ( LESS_U32( return_time, bmx_time ) )
 			dbgf_track(DBGT_WARN, "select() returned %d without reason!! return_time %d, curr_time %d",
 				selected, return_time, bmx_time);
@@ -349,6 +474,12 @@ loop4Event:
 			goto loop4Event;
 		}
 
+		sched_stats.wakeups++;
+		sched_stats.fds += selected;
+		sched_stats.fdsMax = XMAX(sched_stats.fdsMax, (uint32_t) selected);
+
+		nsDispatch = nsAwake;
+
 		keyNodes_block_and_sync(0, YES);
 
 		// check for received packets...
@@ -377,7 +508,7 @@ loop4Event:
 
 				ioctl(pb.i.iif->rx_mcast_sock, SIOCGSTAMP, &(pb.i.tv_stamp));
 
-				rx_packet(&pb);
+				sched_rx_packet(&pb, &packets);
 
 				if (--selected == 0)
 					goto loop4Event;
@@ -403,7 +534,7 @@ loop4Event:
 
 				ioctl(pb.i.iif->rx_fullbrc_sock, SIOCGSTAMP, &(pb.i.tv_stamp));
 
-				rx_packet(&pb);
+				sched_rx_packet(&pb, &packets);
 
 				if (--selected == 0)
 					goto loop4Event;
@@ -456,7 +587,7 @@ loop4Event:
 				else
 					timercpy(&(pb.i.tv_stamp), tv_stamp);
 
-				rx_packet(&pb);
+				sched_rx_packet(&pb, &packets);
 
 				if (--selected == 0)
 					goto loop4Event;
@@ -526,6 +657,27 @@ loop4ActiveClients:
 
 		}
 
+loop4WritableClients:
+		// drain queued output of control clients...
+		list_for_each(list_pos, &ctrl_list)
+		{
+
+			struct ctrl_node *client = list_entry(list_pos, struct ctrl_node, list);
+
+			if (write_max_sock && client->fd > 0 && FD_ISSET(client->fd, &tmp_write_set)) {
+
+				FD_CLR(client->fd, &tmp_write_set);
+
+				handle_ctrl_node_output(client);
+
+				--selected;
+
+				// return straight because client might be removed and list might have changed.
+				goto loop4WritableClients;
+			}
+
+		}
+
 
 
 		if (selected) {
@@ -538,6 +690,8 @@ loop4ActiveClients:
 
 wait4Event_end:
 
+	sched_wakeup_done(&nsDispatch, &packets);
+
 	keyNodes_block_and_sync(0, YES);
 
 	dbgf_all(DBGT_INFO, "end of function");
@@ -560,12 +714,160 @@ IDM_T doNowOrLater(TIME_T *nextScheduled, TIME_T interval, IDM_T now)
 	}
 }
 
+STATIC_FUNC
+char *sched_hist2str(char *buff, uint32_t size, uint32_t *hist)
+{
+	uint8_t b;
+	uint32_t pos = 0;
+
+	buff[0] = 0;
+
+	for (b = 0; b < SCHED_HIST_SIZE && pos < size; b++) {
+		if (hist[b] && b < SCHED_HIST_SIZE - 1)
+			pos += snprintf(buff + pos, size - pos, "%s<%ums:%u", pos ? " " : "", (1U << b), hist[b]);
+		else if (hist[b])
+			pos += snprintf(buff + pos, size - pos, "%sinf:%u", pos ? " " : "", hist[b]);
+	}
+
+	return buff;
+}
+
+struct sched_status {
+	char wakeups[22];
+	char timerWakeups[22];
+	char earlyWakeups[22];
+	char spuriousWakeups[22];
+	char cheatedMs[22];
+	char avgFds[12];
+	uint32_t maxFds;
+	char packets[22];
+	uint32_t maxPackets;
+	char idleMs[22];
+	char rxMs[22];
+	char fdsMs[22];
+	char tasksMs[22];
+	char txMs[22];
+	char busyMaxMs[16];
+	char busyHist[SCHED_HIST_SIZE * 16];
+};
+
+static const struct field_format sched_status_format[] = {
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR, sched_status, wakeups,      1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR, sched_status, timerWakeups, 1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR, sched_status, earlyWakeups, 1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR, sched_status, spuriousWakeups, 1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR, sched_status, cheatedMs,    1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR, sched_status, avgFds,       1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT,        sched_status, maxFds,       1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR, sched_status, packets,      1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_UINT,        sched_status, maxPackets,   1, FIELD_RELEVANCE_MEDI),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR, sched_status, idleMs,       1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR, sched_status, rxMs,         1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR, sched_status, fdsMs,        1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR, sched_status, tasksMs,      1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR, sched_status, txMs,         1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR, sched_status, busyMaxMs,    1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR, sched_status, busyHist,     1, FIELD_RELEVANCE_HIGH),
+	FIELD_FORMAT_END
+};
+
+STATIC_FUNC
+int32_t sched_status_creator(struct status_handl *handl, void *data)
+{
+	struct sched_status *status = (struct sched_status *) (handl->data = debugRealloc(handl->data, sizeof(struct sched_status), -300913));
+	memset(status, 0, sizeof(struct sched_status));
+
+	sprintf(status->wakeups, "%ju", (uintmax_t) sched_stats.wakeups);
+	sprintf(status->timerWakeups, "%ju", (uintmax_t) sched_stats.timerWakeups);
+	sprintf(status->earlyWakeups, "%ju", (uintmax_t) sched_stats.earlyWakeups);
+	sprintf(status->spuriousWakeups, "%ju", (uintmax_t) sched_stats.spuriousWakeups);
+	sprintf(status->cheatedMs, "%ju", (uintmax_t) sched_stats.msCheated);
+	snprintf(status->avgFds, sizeof(status->avgFds), "%.2f", sched_stats.wakeups ? ((double) sched_stats.fds) / sched_stats.wakeups : 0);
+	status->maxFds = sched_stats.fdsMax;
+	sprintf(status->packets, "%ju", (uintmax_t) sched_stats.packets);
+	status->maxPackets = sched_stats.packetsMax;
+	sprintf(status->idleMs, "%ju", (uintmax_t) (sched_stats.nsIdle / 1000000));
+	sprintf(status->rxMs, "%ju", (uintmax_t) (sched_stats.nsRx / 1000000));
+	sprintf(status->fdsMs, "%ju", (uintmax_t) (sched_stats.nsFds / 1000000));
+	sprintf(status->tasksMs, "%ju", (uintmax_t) (sched_stats.nsTasks / 1000000));
+	sprintf(status->txMs, "%ju", (uintmax_t) (sched_stats.nsTx / 1000000));
+	snprintf(status->busyMaxMs, sizeof(status->busyMaxMs), "%.3f", ((double) sched_stats.nsBusyMax) / 1000000);
+	sched_hist2str(status->busyHist, sizeof(status->busyHist), sched_stats.busyHist);
+
+	return sizeof(struct sched_status);
+}
+
+struct task_status {
+	const char *name;
+	char calls[22];
+	char avgUs[16];
+	char maxUs[16];
+	char lateAvgMs[16];
+	char lateMaxMs[16];
+	char lateHist[SCHED_HIST_SIZE * 16];
+};
+
+static const struct field_format task_status_format[] = {
+        FIELD_FORMAT_INIT(FIELD_TYPE_POINTER_CHAR, task_status, name,      1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,  task_status, calls,     1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,  task_status, avgUs,     1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,  task_status, maxUs,     1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,  task_status, lateAvgMs, 1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,  task_status, lateMaxMs, 1, FIELD_RELEVANCE_HIGH),
+        FIELD_FORMAT_INIT(FIELD_TYPE_STRING_CHAR,  task_status, lateHist,  1, FIELD_RELEVANCE_MEDI),
+	FIELD_FORMAT_END
+};
+
+STATIC_FUNC
+int32_t task_status_creator(struct status_handl *handl, void *data)
+{
+	struct avl_node *an = NULL;
+	struct task_stats *ts;
+	uint32_t status_size = task_stats_tree.items * sizeof(struct task_status);
+	struct task_status *status = (struct task_status *) (handl->data = debugRealloc(handl->data, status_size, -300914));
+	memset(status, 0, status_size);
+
+	for (; (ts = avl_iterate_item(&task_stats_tree, &an)); status++) {
+
+		status->name = ts->name;
+		sprintf(status->calls, "%ju", (uintmax_t) ts->calls);
+		sprintf(status->avgUs, DBG_NIL);
+		sprintf(status->maxUs, DBG_NIL);
+		sprintf(status->lateAvgMs, DBG_NIL);
+		sprintf(status->lateMaxMs, DBG_NIL);
+
+		if (ts->calls) {
+			snprintf(status->avgUs, sizeof(status->avgUs), "%.3f", ((double) ts->nsTotal) / ts->calls / 1000);
+			snprintf(status->maxUs, sizeof(status->maxUs), "%.3f", ((double) ts->nsMax) / 1000);
+			snprintf(status->lateAvgMs, sizeof(status->lateAvgMs), "%.3f", ((double) ts->usLateTotal) / ts->calls / 1000);
+			snprintf(status->lateMaxMs, sizeof(status->lateMaxMs), "%.3f", ((double) ts->usLateMax) / 1000);
+		}
+
+		sched_hist2str(status->lateHist, sizeof(status->lateHist), ts->lateHist);
+	}
+
+	return status_size;
+}
+
+static struct opt_type schedule_options[] ={
+//       ord parent long_name          shrt Attributes				*ival		min		max		default		*func,*syntax,*help
+	{ODI,0,ARG_SCHEDULER,          0,  9,1,A_PS0N,A_USR,A_DYN,A_ARG,A_ANY,	0,		0, 		0,		0,0, 		opt_status,
+			0,		"show event-loop wakeups, ready fds, received packets, time spent idle, in rx, fds, tasks, and tx,\n"
+		"	and the longest and log2 histogram of event-loop iterations between two select() calls\n"},
+	{ODI,0,ARG_TASKS,              0,  9,1,A_PS0N,A_USR,A_DYN,A_ARG,A_ANY,	0,		0, 		0,		0,0, 		opt_status,
+			0,		"show calls, execution time, and lateness (average, max, log2 histogram) of scheduled task functions\n"}
+};
+
 void init_schedule(void)
 {
 	gettimeofday(&start_time_tv, NULL);
 	curr_tv = start_time_tv;
 
 	upd_bmx_time(NULL);
+
+	register_status_handl(sizeof(struct sched_status), 0, sched_status_format, ARG_SCHEDULER, sched_status_creator);
+	register_status_handl(sizeof(struct task_status), 1, task_status_format, ARG_TASKS, task_status_creator);
+	register_options_array(schedule_options, sizeof( schedule_options), CODE_CATEGORY_NAME);
 }
 
 void cleanup_schedule(void)
@@ -577,4 +879,9 @@ void cleanup_schedule(void)
 	while ((tn = list_del_head(&task_list)))
 		debugFree(tn, -300082);
 
+	struct task_stats *ts;
+
+	while ((ts = avl_remove_first_item(&task_stats_tree, -300915)))
+		debugFree(ts, -300916);
+
 }
@@ -18,11 +18,28 @@
 
 #define REGISTER_TASK_TIMEOUT_MAX ((~((TIME_T)0))>>2)  //100000
 
+#define ARG_SCHEDULER "scheduler"
+#define ARG_TASKS "tasks"
+
+#define SCHED_HIST_SIZE 16 // buckets: <1ms, <2ms, <4ms, ..., the last one also collects all longer durations
+
+struct task_stats {
+	void (* task) (void *fpara);
+	const char *name;
+	uint64_t calls;
+	uint64_t nsTotal;
+	uint64_t nsMax;
+	uint64_t usLateTotal;
+	uint64_t usLateMax;
+	uint32_t lateHist[SCHED_HIST_SIZE];
+};
+
 struct task_node {
 	struct list_node list;
 	TIME_T expire;
 	void (* task) (void *fpara); // pointer to the function to be executed
 	void *data; //NULL or pointer to data to be given to function. Data will be freed after functio is called.
+	struct task_stats *stats;
 };
 
 
@@ -31,7 +48,8 @@ void upd_time(struct timeval *precise_tv);
 void init_schedule(void);
 void change_selects(void);
 void cleanup_schedule(void);
-void task_register(TIME_T timeout, void (* task) (void *), void *data, int32_t tag);
+void task_register_(TIME_T timeout, void (* task) (void *), void *data, int32_t tag, const char *name);
+#define task_register(timeout, task, data, tag) task_register_((timeout), (task), (data), (tag), #task)
 IDM_T task_remove(void (* task) (void *), void *data);
 TIME_T task_next(void);
 void wait4Event(TIME_T timeout);
@@ -467,6 +467,92 @@ char* bits_print(uint8_t *array, uint32_t array_bit_size, uint32_t beg_bit, uint
 	return output;
 }
 
+uint8_t wbit_get(const uint64_t *array, const uint32_t array_bit_size, uint32_t bit)
+{
+	bit = bit % array_bit_size;
+
+	return(array[bit / WBITS_WORD_SIZE] & (((uint64_t) 1) << (bit % WBITS_WORD_SIZE))) ? 1 : 0;
+}
+
+void wbit_set(uint64_t *array, uint32_t array_bit_size, uint32_t bit, IDM_T value)
+{
+	bit = bit % array_bit_size;
+
+	if (value)
+		array[bit / WBITS_WORD_SIZE] |= (((uint64_t) 1) << (bit % WBITS_WORD_SIZE));
+	else
+		array[bit / WBITS_WORD_SIZE] &= ~(((uint64_t) 1) << (bit % WBITS_WORD_SIZE));
+}
+
+// counts and optionally clears the bit range between and including begin and end, one masked word at a time
+
+STATIC_FUNC
+uint32_t wbits_range(uint64_t *array, uint32_t array_bit_size, uint32_t beg_bit, uint32_t end_bit, uint32_t range_mask, IDM_T clear)
+{
+	assertion(-502793, (array_bit_size % WBITS_WORD_SIZE == 0));
+	assertion(-502794, ((range_mask & (end_bit - beg_bit)) < array_bit_size));
+
+	uint32_t len = (range_mask & (end_bit - beg_bit)) + 1;
+	uint32_t pos = beg_bit % array_bit_size;
+	uint32_t counted = 0;
+
+	while (len) {
+
+		uint32_t offs = pos % WBITS_WORD_SIZE;
+		uint32_t bits = XMIN(len, WBITS_WORD_SIZE - offs);
+		uint64_t mask = ((bits == WBITS_WORD_SIZE) ? ((uint64_t) - 1) : ((((uint64_t) 1) << bits) - 1)) << offs;
+		uint64_t *word = &array[pos / WBITS_WORD_SIZE];
+
+		counted += __builtin_popcountll(*word & mask);
+
+		if (clear)
+			*word &= ~mask;
+
+		len -= bits;
+		pos = (pos + bits) % array_bit_size;
+	}
+
+	return counted;
+}
+
+uint32_t wbits_count(uint64_t *array, uint32_t array_bit_size, uint32_t beg_bit, uint32_t end_bit, uint32_t range_mask)
+{
+	return wbits_range(array, array_bit_size, beg_bit, end_bit, range_mask, NO);
+}
+
+// clears bit range between and including begin and end and returns the number of bits that were set
+
+uint32_t wbits_clear(uint64_t *array, uint32_t array_bit_size, uint32_t beg_bit, uint32_t end_bit, uint32_t range_mask)
+{
+	return wbits_range(array, array_bit_size, beg_bit, end_bit, range_mask, YES);
+}
+
+char* wbits_print(uint64_t *array, uint32_t array_bit_size, uint32_t beg_bit, uint32_t end_bit, uint32_t range_mask)
+{
+	assertion(-502795, ((range_mask & (end_bit - beg_bit)) < array_bit_size));
+
+	uint16_t c = 0;
+	static char output[BITS_PRINT_MAX + 4];
+
+	uint32_t pos = (beg_bit % array_bit_size);
+
+	do {
+		output[c] = wbit_get(array, array_bit_size, pos) ? '1' : '0';
+		if ((++c) >= BITS_PRINT_MAX) {
+			sprintf(&output[c], "..");
+			c = c + 2;
+			break;
+		}
+
+		pos = (pos + 1) % array_bit_size;
+
+	} while (pos != ((end_bit + 1) % array_bit_size));
+
+	output[c] = 0;
+
+	return output;
+}
+
 uint8_t is_zero(void *data, int32_t len)
 {
 	int32_t i;
@@ -80,6 +80,18 @@ void bits_clear(uint8_t *array, uint32_t array_bit_size, uint32_t beg_bit, uint3
 
 char* bits_print(uint8_t *array, uint32_t array_bit_size, uint32_t beg_bit, uint32_t end_bit, uint32_t range_mask);
 
+// word-wise (64-bit) variants of above for circular sqn windows, array_bit_size must be a multiple of WBITS_WORD_SIZE:
+
+uint8_t wbit_get(const uint64_t *array, const uint32_t array_bit_size, uint32_t bit);
+
+void wbit_set(uint64_t *array, uint32_t array_bit_size, uint32_t bit, IDM_T value);
+
+uint32_t wbits_count(uint64_t *array, uint32_t array_bit_size, uint32_t beg_bit, uint32_t end_bit, uint32_t range_mask);
+
+uint32_t wbits_clear(uint64_t *array, uint32_t array_bit_size, uint32_t beg_bit, uint32_t end_bit, uint32_t range_mask);
+
+char* wbits_print(uint64_t *array, uint32_t array_bit_size, uint32_t beg_bit, uint32_t end_bit, uint32_t range_mask);
+
 void bit_xor(void *out, void *a, void *b, uint32_t size);
 
 uint8_t is_zero(void *data, int len);
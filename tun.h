@@ -324,8 +324,14 @@ struct tun_bit_key {
 	struct tun_bit_key_nodes keyNodes;
 } __attribute__((packed));
 
+struct tun_class_key {
+	struct net_key net; // masked route of an active tun_bit_node
+	struct tun_bit_node *tbn;
+} __attribute__((packed));
+
 struct tun_bit_node {
 	struct tun_bit_key tunBitKey;
+	struct tun_class_key classKey; // set while indexed in tun_class_tree
 
 	//uint8_t active; //REMOVE
 	struct tun_dev_node *active_tdn;